@@ -32,6 +32,7 @@
 #include "Systems/Base/GraphicsSystem.hpp"
 #include "Systems/Base/Surface.hpp"
 #include "Systems/Base/System.hpp"
+#include "Systems/Base/TextSystem.hpp"
 
 // -----------------------------------------------------------------------
 // Effect
@@ -42,7 +43,8 @@ Effect::Effect(RLMachine& machine, boost::shared_ptr<Surface> src,
                Size size, int time)
     : screen_size_(size), duration_(time),
       start_time_(machine.system().event().getTicks()),
-      machine_(machine), src_surface_(src), dst_surface_(dst) {
+      machine_(machine), src_surface_(src), dst_surface_(dst),
+      built_while_skipping_(machine.system().text().renderingSuppressed()) {
   machine.system().graphics().setIsResponsibleForUpdate(false);
 }
 
@@ -56,7 +58,7 @@ bool Effect::operator()(RLMachine& machine) {
 
   bool fastForward = machine.system().fastForward();
 
-  if (currentFrame >= duration_ || fastForward) {
+  if (currentFrame >= duration_ || fastForward || built_while_skipping_) {
     return true;
   } else {
     GraphicsSystem& graphics = machine.system().graphics();
@@ -113,6 +113,11 @@ class Effect : public LongOperation {
 
   // The destination surface (previously known as DC0)
   boost::shared_ptr<Surface> dst_surface_;
+
+  // Whether we were built while skipping read text. Our surfaces are then
+  // blank placeholders (see GraphicsSystem::renderToSurface()), so we finish
+  // on our first tick even if skipping stops before then.
+  bool built_while_skipping_;
 };
 
 
@@ -37,13 +37,18 @@
 #include "Encodings/codepage.h"
 
 #include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <cstring>
+#include <iterator>
 
 // Supported codepages
 #include "Encodings/cp932.h"
 #include "Encodings/cp936.h"
 #include "Encodings/cp949.h"
 #include "Encodings/western.h"
+#include "utf8cpp/utf8.h"
 
 // -----------------------------------------------------------------------
 // Codepage
@@ -84,6 +89,13 @@ uint16_t Codepage::Convert(uint16_t ch) const {
   return ch;
 }
 
+std::string Codepage::ConvertStringToUTF8(const std::string& s) const {
+  std::wstring ws = ConvertString(s);
+  std::string out;
+  utf8::utf16to8(ws.begin(), ws.end(), std::back_inserter(out));
+  return out;
+}
+
 bool Codepage::DbcsDelim(char* str) const {
   return false;
 }
@@ -92,27 +104,75 @@ bool Codepage::IsItalic(uint16_t ch) const {
   return false;
 }
 
-boost::scoped_ptr<Codepage> Cp::instance_;
-int Cp::codepage = -1;
-int Cp::scenario = -1;
+// static
+void Codepage::AppendUTF8(uint16_t ch, std::string& out) {
+  if (ch < 0x80) {
+    out += static_cast<char>(ch);
+  } else if (ch < 0x800) {
+    out += static_cast<char>(0xc0 | (ch >> 6));
+    out += static_cast<char>(0x80 | (ch & 0x3f));
+  } else {
+    // The tables map unassigned characters to 0xffff. Reject those the
+    // same way utf8::utf16to8() does, so callers see the same error from
+    // either path.
+    if (ch >= 0xfffe || (ch >= 0xd800 && ch <= 0xdfff))
+      throw utf8::invalid_code_point(ch);
+
+    out += static_cast<char>(0xe0 | (ch >> 12));
+    out += static_cast<char>(0x80 | ((ch >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (ch & 0x3f));
+  }
+}
+
+// static
+const char* Codepage::CopyAsciiRun(const char* s, const char* end,
+                                   std::string& out) {
+  const char* start = s;
+#if defined(__SSE2__)
+  // The high bit of each byte lands in the mask, so a non-zero mask means
+  // the block has a non-ASCII byte somewhere in it.
+  while (end - s >= 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    if (_mm_movemask_epi8(block))
+      break;
+    s += 16;
+  }
+#endif
+  while (end - s >= 8) {
+    uint64_t word;
+    std::memcpy(&word, s, sizeof(word));
+    if (word & 0x8080808080808080ULL)
+      break;
+    s += 8;
+  }
+
+  while (s != end && static_cast<unsigned char>(*s) < 0x80)
+    ++s;
 
+  out.append(start, s);
+  return s;
+}
+
+// -----------------------------------------------------------------------
+// Cp
+// -----------------------------------------------------------------------
 Codepage& Cp::instance(int desired) {
-  // Desired codepage known.
-  if (desired != codepage) {
-    codepage = desired;
-    switch (desired) {
-      case 1:
-        instance_.reset(new Cp936());
-        break;
-      case 2:
-        instance_.reset(new Cp1252());
-        break;
-      case 3:
-        instance_.reset(new Cp949());
-        break;
-      default:
-        instance_.reset(new Cp932());
+  switch (desired) {
+    case 1: {
+      static Cp936 cp936;
+      return cp936;
+    }
+    case 2: {
+      static Cp1252 cp1252;
+      return cp1252;
+    }
+    case 3: {
+      static Cp949 cp949;
+      return cp949;
+    }
+    default: {
+      static Cp932 cp932;
+      return cp932;
     }
   }
-  return *instance_;
 }
@@ -47,22 +47,36 @@ struct Codepage {
   virtual void JisEncodeString(const char* s, char* buf, size_t buflen) const;
   virtual unsigned short Convert(unsigned short ch) const = 0;
   virtual std::wstring ConvertString(const std::string& s) const = 0;
+  // Converts |s| straight to UTF-8. The default goes through
+  // ConvertString(); codepages can override it to skip the wide string.
+  virtual std::string ConvertStringToUTF8(const std::string& s) const;
   virtual bool DbcsDelim(char* str) const;
   virtual bool IsItalic(unsigned short ch) const;
 
   int UseUnicode;
   int DesirableCharset;
   bool NoTransforms;
+
+ protected:
+  // Appends the UTF-8 encoding of the BMP codepoint |ch| to |out|. Throws
+  // utf8::invalid_code_point for surrogates and non-characters.
+  static void AppendUTF8(unsigned short ch, std::string& out);
+
+  // Copies the run of ASCII characters at the start of [s, end) to |out|,
+  // testing sixteen bytes at a time with SSE2 where the compiler targets
+  // it and a machine word at a time otherwise, and returns where the run
+  // stopped.
+  // Every supported codepage maps ASCII to itself.
+  static const char* CopyAsciiRun(const char* s, const char* end,
+                                  std::string& out);
 };
 
 class Cp {
  public:
-  // Singleton constructor
+  // Returns the shared instance of codepage |desired|. Each codepage is
+  // created once and never replaced, so callers on different threads (or
+  // asking for different codepages) can hold on to the reference.
   static Codepage& instance(int desired);
- private:
-  static boost::scoped_ptr<Codepage> instance_;
-  static int codepage;
-  static int scenario;
 };
 
 #endif
@@ -71,6 +71,7 @@
 #include "Encodings/cp932.h"
 
 #include <stdint.h>
+#include <cstring>
 #include <string>
 
 #include "Utilities/StringUtilities.hpp"
@@ -1598,6 +1599,30 @@ std::wstring Cp932::ConvertString(const std::string& in_string) const {
   return rv;
 }
 
+// -----------------------------------------------------------------------
+
+std::string Cp932::ConvertStringToUTF8(const std::string& in_string) const {
+  std::string rv;
+  rv.reserve(in_string.size() * 3 / 2);
+
+  const char* s = in_string.c_str();
+  const char* end = s + std::strlen(s);
+  while (s != end) {
+    s = CopyAsciiRun(s, end, rv);
+    if (s == end)
+      break;
+
+    if (shiftjis_lead_byte(s[0]) && s + 1 != end) {
+      AppendUTF8(Cp932::Convert((s[0] << 8) | s[1]), rv);
+      s += 2;
+    } else {
+      AppendUTF8(Cp932::Convert(*s++), rv);
+    }
+  }
+
+  return rv;
+}
+
 #else
 
 uint16_t Cp932::Convert(uint16_t ch) const {
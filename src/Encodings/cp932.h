@@ -42,6 +42,9 @@
 struct Cp932 : public Codepage {
   virtual unsigned short Convert(unsigned short ch) const;
   virtual std::wstring ConvertString(const std::string& s) const;
+#ifndef NO_CP932_CONVERSION
+  virtual std::string ConvertStringToUTF8(const std::string& s) const;
+#endif
   Cp932();
 };
 
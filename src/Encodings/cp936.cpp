@@ -3166,6 +3166,24 @@ std::wstring Cp936::ConvertString(const std::string& in_string) const {
   return rv;
 }
 
+std::string Cp936::ConvertStringToUTF8(const std::string& in_string) const {
+  std::string rv;
+  rv.reserve(in_string.size() * 3 / 2);
+
+  const char* s = in_string.c_str();
+  const char* end = s + std::strlen(s);
+  while (s != end) {
+    s = CopyAsciiRun(s, end, rv);
+    if (s == end || s + 1 == end)
+      break;
+
+    AppendUTF8(Cp936::Convert((s[0] << 8) | s[1]), rv);
+    s += 2;
+  }
+
+  return rv;
+}
+
 #else
 uint16_t Cp936::Convert(uint16_t ch) const {
   return ch;
@@ -1966,6 +1966,24 @@ std::wstring Cp949::ConvertString(const std::string& in_string) const {
   return rv;
 }
 
+std::string Cp949::ConvertStringToUTF8(const std::string& in_string) const {
+  std::string rv;
+  rv.reserve(in_string.size() * 3 / 2);
+
+  const char* s = in_string.c_str();
+  const char* end = s + std::strlen(s);
+  while (s != end) {
+    s = CopyAsciiRun(s, end, rv);
+    if (s == end || s + 1 == end)
+      break;
+
+    AppendUTF8(Cp949::Convert((s[0] << 8) | s[1]), rv);
+    s += 2;
+  }
+
+  return rv;
+}
+
 #else
 
 uint16_t Cp949::JisDecode(uint16_t ch) const {
@@ -44,6 +44,9 @@ struct Cp949 : public Codepage {
   void JisEncodeString(const char* s, char* buf, size_t buflen) const;
   unsigned short Convert(unsigned short ch) const;
   std::wstring ConvertString(const std::string& s) const;
+#ifndef NO_CP949_CONVERSION
+  std::string ConvertStringToUTF8(const std::string& s) const;
+#endif
   Cp949();
 };
 
@@ -37,6 +37,7 @@
 #include "Encodings/western.h"
 
 #include <stdint.h>
+#include <cstring>
 #include <string>
 
 bool Cp1252::IsItalic(uint16_t ch) const {
@@ -128,3 +129,18 @@ std::wstring Cp1252::ConvertString(const std::string& in_string) const {
 
   return rv;
 }
+
+std::string Cp1252::ConvertStringToUTF8(const std::string& in_string) const {
+  std::string rv;
+  rv.reserve(in_string.size() + in_string.size() / 4);
+
+  const char* s = in_string.c_str();
+  const char* end = s + std::strlen(s);
+  while (s != end) {
+    s = CopyAsciiRun(s, end, rv);
+    if (s != end)
+      AppendUTF8(Cp1252::Convert(*s++), rv);
+  }
+
+  return rv;
+}
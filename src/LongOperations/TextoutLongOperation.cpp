@@ -97,11 +97,21 @@ bool TextoutLongOperation::keyStateChanged(KeyCode keyCode, bool pressed) {
 
 bool TextoutLongOperation::displayAsMuchAsWeCanThenPause(RLMachine& machine) {
   bool paused = false;
-  while (!displayOneMoreCharacter(machine, paused))
+  while (true) {
+    // Names and stray NULLs still go one at a time.
+    bool done;
+    if (current_codepoint_ == 0x3010 || current_char_.empty() ||
+        current_char_[0] == '\0') {
+      done = displayOneMoreCharacter(machine, paused);
+    } else {
+      done = displayRunOfCharacters(machine, paused);
+    }
+
+    if (done)
+      return true;
     if (paused)
       return false;
-
-  return true;
+  }
 }
 
 bool TextoutLongOperation::displayName(RLMachine& machine) {
@@ -193,6 +203,46 @@ bool TextoutLongOperation::displayOneMoreCharacter(RLMachine& machine,
   }
 }
 
+bool TextoutLongOperation::displayRunOfCharacters(RLMachine& machine,
+                                                  bool& paused) {
+  // |current_char_| always sits directly before |current_position_|.
+  string::size_type begin =
+      (current_position_ - m_utf8string.begin()) - current_char_.size();
+  string::size_type end = m_utf8string.find('\0', begin);
+  if (end == string::npos)
+    end = m_utf8string.size();
+
+  TextPage& page = machine.system().text().currentPage();
+  string::size_type printed = page.characters(m_utf8string, begin, end);
+
+  if (printed == end) {
+    // Skip over any embedded NULLs the same way displayOneMoreCharacter()
+    // does.
+    while (printed != m_utf8string.size() && m_utf8string[printed] == '\0')
+      printed++;
+
+    if (printed == m_utf8string.size())
+      return true;
+  }
+
+  // Make the first character we didn't display the current one.
+  current_position_ = m_utf8string.begin() + printed;
+  string::iterator it = current_position_;
+  utf8::next(it, m_utf8string.end());
+  current_char_ = string(current_position_, it);
+  current_position_ = it;
+
+  // Call the pause operation if we've filled up the current page.
+  if (page.isFull()) {
+    paused = true;
+    machine.system().graphics().markScreenAsDirty(GUT_TEXTSYS);
+    machine.pushLongOperation(
+        new NewPageAfterLongop(new PauseLongOperation(machine)));
+  }
+
+  return false;
+}
+
 bool TextoutLongOperation::operator()(RLMachine& machine) {
   // Check to make sure we're not trying to do a textout (impossible!)
   if (!machine.system().text().systemVisible())
@@ -58,6 +58,11 @@ class TextoutLongOperation : public LongOperation {
   bool displayName(RLMachine& machine);
   bool displayOneMoreCharacter(RLMachine& machine, bool& paused);
 
+  // Lays out every character from |current_char_| up to the next embedded
+  // NULL (or the end of the string) in one call. Used when we aren't waiting
+  // between characters.
+  bool displayRunOfCharacters(RLMachine& machine, bool& paused);
+
   std::string m_utf8string;
 
   int current_codepoint_;
@@ -95,11 +95,11 @@ MultiDispatch::~MultiDispatch() {
 }
 
 void MultiDispatch::parseParameters(
-    const std::vector<std::string>& input,
+    const libReallive::ParameterSpans& input,
     boost::ptr_vector<ExpressionPiece>& output) {
-  for (vector<string>::const_iterator it = input.begin(); it != input.end();
+  for (ParameterSpans::const_iterator it = input.begin(); it != input.end();
        ++it) {
-    const char* src = it->c_str();
+    const char* src = it->data();
     output.push_back(get_complex_param(src));
   }
 }
@@ -173,8 +173,9 @@ void UndefinedFunction::dispatchFunction(RLMachine& machine,
   throw rlvm::UnimplementedOpcode(machine, name_, f);
 }
 
-void UndefinedFunction::parseParameters(const std::vector<std::string>& input,
-                                        ExpressionPiecesVector& output) {
+void UndefinedFunction::parseParameters(
+    const libReallive::ParameterSpans& input,
+    ExpressionPiecesVector& output) {
   throw rlvm::UnimplementedOpcode(name_, modtype_, module_, opcode_, overload_);
 }
 
@@ -137,7 +137,7 @@ class MultiDispatch : public RLOp_SpecialCase {
   explicit MultiDispatch(RLOperation* op);
   ~MultiDispatch();
 
-  void parseParameters(const std::vector<std::string>& input,
+  void parseParameters(const libReallive::ParameterSpans& input,
                        boost::ptr_vector<libReallive::ExpressionPiece>& output);
 
   virtual void operator()(RLMachine& machine,
@@ -187,7 +187,7 @@ class UndefinedFunction : public RLOp_SpecialCase {
                         const ExpressionPiecesVector& parameters);
   virtual void dispatchFunction(RLMachine& machine,
                                 const libReallive::CommandElement& f);
-  virtual void parseParameters(const std::vector<std::string>& input,
+  virtual void parseParameters(const libReallive::ParameterSpans& input,
                                ExpressionPiecesVector& output);
   virtual void operator()(RLMachine&, const libReallive::CommandElement&);
 
@@ -128,6 +128,12 @@ void Memory::connectIntVarPointers() {
   original_int_var[7] = NULL;
 }
 
+int* Memory::intBank(int index) {
+  if (index == libReallive::INTL_LOCATION)
+    return machine_.currentIntLBank();
+  return int_var[index];
+}
+
 const std::string& Memory::getStringValue(int type, int location) {
   if (location > (SIZE_OF_MEM_BANK -1))
     throw rlvm::Exception(
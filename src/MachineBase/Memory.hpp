@@ -28,6 +28,7 @@
 #ifndef SRC_MACHINEBASE_MEMORY_HPP_
 #define SRC_MACHINEBASE_MEMORY_HPP_
 
+#include <algorithm>
 #include <boost/dynamic_bitset.hpp>
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/version.hpp>
@@ -70,6 +71,12 @@ struct GlobalMemory {
   // boost::serialization
   template<class Archive>
   void serialize(Archive & ar, unsigned int version) {
+    if (Archive::is_loading::value) {
+      // See LocalMemory::load().
+      std::fill(strM, strM + SIZE_OF_MEM_BANK, std::string());
+      std::fill(global_names, global_names + SIZE_OF_NAME_BANK, std::string());
+    }
+
     ar & intG & intZ & strM;
 
     // Starting in version 1, \#NAME variable storage were added.
@@ -153,6 +160,13 @@ struct LocalMemory {
 
   template<class Archive>
   void load(Archive& ar, unsigned int version) {
+    // Operations get their string parameters as references into this memory
+    // and may keep copies of them. With a copy-on-write std::string those
+    // copies share our buffers, which boost::serialization writes into
+    // without unsharing them, so let go of every buffer before loading.
+    std::fill(strS, strS + SIZE_OF_MEM_BANK, std::string());
+    std::fill(local_names, local_names + SIZE_OF_NAME_BANK, std::string());
+
     ar & intA & intB & intC & intD & intE & intF & strS;
 
     // Starting in version 2, we no longer have the intL and strK in
@@ -215,6 +229,11 @@ class Memory {
   // Sets the value of a certain memory location
   void setIntValue(const libReallive::IntMemRef& ref, int value);
 
+  // Returns the raw integer bank |index| (as in IntMemRef::bank()), where
+  // INTL_LOCATION is the current stack frame's intL[]. Used by compiled
+  // expressions to read memory without decoding an IntMemRef per access.
+  int* intBank(int index);
+
   // Returns the string value of a string memory bank
   const std::string& getStringValue(int type, int location);
 
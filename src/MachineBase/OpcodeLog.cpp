@@ -31,8 +31,12 @@
 #include <iomanip>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 #include <boost/bind.hpp>
 
+#include "Utilities/AllocationCounter.hpp"
+
 using namespace std;
 
 // -----------------------------------------------------------------------
@@ -45,6 +49,93 @@ void OpcodeLog::increment(const std::string& name) {
   storage_[name]++;
 }
 
+void OpcodeLog::recordAllocations(const std::string& name, long allocations) {
+  storage_[name]++;
+  allocations_[name] += allocations;
+}
+
+long OpcodeLog::allocations(const std::string& name) const {
+  std::map<std::string, long>::const_iterator it = allocations_.find(name);
+  return it != allocations_.end() ? it->second : 0;
+}
+
+bool OpcodeLog::hasAllocations() const {
+  return !allocations_.empty();
+}
+
+void OpcodeLog::recordCall(const std::string& name, long long microseconds,
+                           long allocations) {
+  recordAllocations(name, allocations);
+
+  Timing& timing = times_[name];
+  timing.total += microseconds;
+  timing.max = std::max(timing.max, microseconds);
+}
+
+long long OpcodeLog::totalTime(const std::string& name) const {
+  std::map<std::string, Timing>::const_iterator it = times_.find(name);
+  return it != times_.end() ? it->second.total : 0;
+}
+
+long long OpcodeLog::maxTime(const std::string& name) const {
+  std::map<std::string, Timing>::const_iterator it = times_.find(name);
+  return it != times_.end() ? it->second.max : 0;
+}
+
+static bool totalTimeGreaterThan(
+    const std::pair<long long, std::string>& lhs,
+    const std::pair<long long, std::string>& rhs) {
+  return lhs.first > rhs.first;
+}
+
+void OpcodeLog::printFlatProfile(std::ostream& os, size_t limit) const {
+  vector<pair<long long, string> > by_time;
+  long long total = 0;
+  for (std::map<std::string, Timing>::const_iterator it = times_.begin();
+       it != times_.end(); ++it) {
+    by_time.push_back(make_pair(it->second.total, it->first));
+    total += it->second.total;
+  }
+  sort(by_time.begin(), by_time.end(), totalTimeGreaterThan);
+  if (by_time.size() > limit)
+    by_time.resize(limit);
+
+  ios_base::fmtflags old_flags = os.flags();
+  streamsize old_precision = os.precision();
+
+  // Without a counting build every entry would read zero allocations.
+  bool show_allocations = allocation_counter::available();
+
+  os << setw(7) << right << "% time" << "  " << setw(10) << "Total ms"
+     << "  " << setw(9) << "Calls" << "  " << setw(9) << "Max us" << "  ";
+  if (show_allocations)
+    os << setw(9) << "Allocs" << "  ";
+  os << "Name" << endl;
+
+  for (vector<pair<long long, string> >::const_iterator it = by_time.begin();
+       it != by_time.end(); ++it) {
+    const string& name = it->second;
+    os << setw(7) << right << fixed << setprecision(2)
+       << (total ? 100.0 * it->first / total : 0.0) << "  "
+       << setw(10) << setprecision(1) << it->first / 1000.0 << "  "
+       << setw(9) << storage_.find(name)->second << "  "
+       << setw(9) << maxTime(name) << "  ";
+    if (show_allocations)
+      os << setw(9) << allocations(name) << "  ";
+    os << name << endl;
+  }
+
+  os.flags(old_flags);
+  os.precision(old_precision);
+}
+
+void OpcodeLog::writeCollapsedStacks(std::ostream& os) const {
+  for (std::map<std::string, Timing>::const_iterator it = times_.begin();
+       it != times_.end(); ++it) {
+    os << it->first << " " << it->second.total << endl;
+  }
+}
+
 static bool nameLessThan(const OpcodeLog::Storage::value_type& lhs,
                          const OpcodeLog::Storage::value_type& rhs) {
   return lhs.first.size() < rhs.first.size();
@@ -55,19 +146,31 @@ std::ostream& operator<<(std::ostream& os, const OpcodeLog& log) {
     int max_function_name_len =
         max_element(log.begin(), log.end(), nameLessThan)->first.size();
 
-    os << setw(max_function_name_len) << left << "Name" << "  " << "Count"
-       << endl;
+    bool show_allocations = log.hasAllocations();
+
+    os << setw(max_function_name_len) << left << "Name" << "  " << "Count";
+    if (show_allocations)
+      os << "  " << setw(10) << left << "Allocs" << "  " << "Per call";
+    os << endl;
 
     for (int i = 0; i < max_function_name_len; ++i)
       os << "-";
 
-    os << "  " << "-----" << endl;
+    os << "  " << "-----";
+    if (show_allocations)
+      os << "  " << "----------" << "  " << "--------";
+    os << endl;
 
     for (OpcodeLog::Storage::const_iterator it = log.begin(); it != log.end();
         ++it) {
       os << setw(max_function_name_len) << left <<  it->first << "  "
-         << it->second
-         << endl;
+         << setw(show_allocations ? 5 : 0) << it->second;
+      if (show_allocations) {
+        long allocations = log.allocations(it->first);
+        os << "  " << setw(10) << allocations << "  "
+           << (double(allocations) / it->second);
+      }
+      os << endl;
     }
   } else {
     os << "No undefined opcodes called!";
@@ -75,3 +178,22 @@ std::ostream& operator<<(std::ostream& os, const OpcodeLog& log) {
 
   return os;
 }
+
+// -----------------------------------------------------------------------
+// OpcodeProfile
+// -----------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream& os, const OpcodeProfile& profile) {
+  static const size_t kFlatProfileLimit = 40;
+
+  os << endl << "Opcodes:" << endl;
+  profile.opcodes.printFlatProfile(os, kFlatProfileLimit);
+  os << endl << "LongOperations (per tick):" << endl;
+  profile.long_operations.printFlatProfile(os, kFlatProfileLimit);
+  os << endl << "Scenarios:" << endl;
+  profile.seens.printFlatProfile(os, kFlatProfileLimit);
+  os << endl << "Lines:" << endl;
+  profile.lines.printFlatProfile(os, kFlatProfileLimit);
+
+  return os;
+}
@@ -48,6 +48,32 @@ class OpcodeLog {
   // Increments the number of times we've encountered "name".
   void increment(const std::string& name);
 
+  // Increments the count for "name" and adds |allocations| heap allocations
+  // to its running total.
+  void recordAllocations(const std::string& name, long allocations);
+
+  // Total heap allocations recorded for "name".
+  long allocations(const std::string& name) const;
+  bool hasAllocations() const;
+
+  // Increments the count for "name" and adds a call that took |microseconds|
+  // of wall time and made |allocations| heap allocations.
+  void recordCall(const std::string& name, long long microseconds,
+                  long allocations);
+
+  // Total and longest single call wall time recorded for "name", in
+  // microseconds.
+  long long totalTime(const std::string& name) const;
+  long long maxTime(const std::string& name) const;
+
+  // Prints up to |limit| entries, most total wall time first.
+  void printFlatProfile(std::ostream& os, size_t limit) const;
+
+  // Writes one "name total_microseconds" line per entry. When names are
+  // frames joined with ';', this is the collapsed stack format read by
+  // flamegraph.pl.
+  void writeCollapsedStacks(std::ostream& os) const;
+
   Storage::const_iterator begin() const { return storage_.begin(); }
   Storage::const_iterator end() const { return storage_.end(); }
   size_t size() const { return storage_.size(); }
@@ -55,8 +81,40 @@ class OpcodeLog {
  private:
   // Counts the instances of an opcode encountered.
   Storage storage_;
+
+  // Heap allocations attributed to each opcode. Empty unless
+  // recordAllocations() has been called.
+  std::map<std::string, long> allocations_;
+
+  // Wall time spent in each opcode. Empty unless recordCall() has been
+  // called.
+  struct Timing {
+    Timing() : total(0), max(0) {}
+    long long total;
+    long long max;
+  };
+  std::map<std::string, Timing> times_;
 };
 
+// Everything an RLMachine records while profiling, each keyed differently.
+struct OpcodeProfile {
+  // By operation: "name<modtype:module:opcode, overload>".
+  OpcodeLog opcodes;
+
+  // By scenario ("SEEN0010") and by source line ("SEEN0010:123").
+  OpcodeLog seens;
+  OpcodeLog lines;
+
+  // By LongOperation subclass, one call per tick.
+  OpcodeLog long_operations;
+
+  // By call stack, outermost frame first: "SEEN0010;SEEN0412;name".
+  OpcodeLog stacks;
+};
+
+// Prints the flat profiles in an OpcodeProfile.
+std::ostream& operator<<(std::ostream& os, const OpcodeProfile& profile);
+
 // Pretty prints the contents of an OpcodeLog.
 std::ostream& operator<<(std::ostream& os, const OpcodeLog& log);
 
@@ -29,7 +29,11 @@
 
 enum Properties {
   P_FGBG = 1,
-  P_PARENTOBJ
+  P_PARENTOBJ,
+
+  // Set on modules whose constant string parameters name image files, so
+  // that RLMachine can look ahead for them and have them decoded early.
+  P_LOADS_IMAGES
 };
 
 #endif  // SRC_MACHINEBASE_PROPERTIES_HPP_
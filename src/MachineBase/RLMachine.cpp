@@ -31,14 +31,19 @@
 
 #include "MachineBase/RLMachine.hpp"
 
+#include <cstdlib>
 #include <string>
 #include <sstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <set>
+#include <typeinfo>
 #include <vector>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/assign.hpp>
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/lexical_cast.hpp>
@@ -48,16 +53,19 @@
 #include "MachineBase/LongOperation.hpp"
 #include "MachineBase/Memory.hpp"
 #include "MachineBase/OpcodeLog.hpp"
+#include "MachineBase/Properties.hpp"
 #include "MachineBase/RLModule.hpp"
 #include "MachineBase/RLOperation.hpp"
 #include "MachineBase/RealLiveDLL.hpp"
 #include "MachineBase/Serialization.hpp"
 #include "MachineBase/StackFrame.hpp"
+#include "Systems/Base/EventSystem.hpp"
 #include "Systems/Base/GraphicsSystem.hpp"
 #include "Systems/Base/System.hpp"
 #include "Systems/Base/SystemError.hpp"
 #include "Systems/Base/TextPage.hpp"
 #include "Systems/Base/TextSystem.hpp"
+#include "Utilities/AllocationCounter.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/StringUtilities.hpp"
 #include "Utilities/algoplus.hpp"
@@ -69,6 +77,10 @@
 #include "libReallive/intmemref.h"
 #include "libReallive/scenario.h"
 
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
 namespace fs = boost::filesystem;
 
 using namespace std;
@@ -79,6 +91,8 @@ using boost::bind;
 using boost::function;
 using boost::lexical_cast;
 using boost::shared_ptr;
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
 
 // -----------------------------------------------------------------------
 
@@ -96,12 +110,51 @@ static const char seen_end[] = {
 
 static const std::string SeenEnd(seen_end, 14);
 
+// How many bytecode elements ahead of the instruction pointer
+// prefetchUpcomingImages() scans, and how many instructions run between
+// scans. Each scan overlaps the last, so nothing in the window is missed.
+static const int kImageLookaheadElements = 64;
+static const int kImageLookaheadInterval = 16;
+
+// Reading the clock costs more than most instructions, so
+// executeInstructionSlice() only checks it this often.
+static const int kInstructionsPerClockCheck = 32;
+
+// Name used for |op| in the allocation log and the profiler.
+static std::string operationName(const RLOperation& op,
+                                 const CommandElement& f) {
+  ostringstream oss;
+  oss << (op.name() ? op.name() : "opcode") << "<" << f.modtype() << ":"
+      << f.module() << ":" << f.opcode() << ", " << f.overload() << ">";
+  return oss.str();
+}
+
+// Readable class name of |op|, for the profiler.
+static std::string longOperationName(const LongOperation& op) {
+  const char* mangled = typeid(op).name();
+#if defined(__GNUC__)
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(mangled, NULL, NULL, &status);
+  if (demangled) {
+    std::string name(demangled);
+    free(demangled);
+    return name;
+  }
+#endif
+  return mangled;
+}
+
+/// Source of RLMachine::dispatch_generation_ values. Zero is reserved to mean
+/// "never resolved" in CommandElement.
+static unsigned int next_dispatch_generation = 1;
+
 // -----------------------------------------------------------------------
 // RLMachine
 // -----------------------------------------------------------------------
 
 RLMachine::RLMachine(System& in_system, Archive& in_archive)
     : memory_(new Memory(*this, in_system.gameexe())),
+      dispatch_generation_(next_dispatch_generation++),
       halted_(false),
       print_undefined_opcodes_(false),
       halt_on_exception_(true),
@@ -110,7 +163,9 @@ RLMachine::RLMachine(System& in_system, Archive& in_archive)
       system_(in_system),
       mark_savepoints_(true),
       delay_stack_modifications_(false),
-      replaying_graphics_stack_(false) {
+      replaying_graphics_stack_(false),
+      scenario_changed_(false),
+      image_lookahead_countdown_(0) {
   // Search in the Gameexe for #SEEN_START and place us there
   Gameexe& gameexe = in_system.gameexe();
   libReallive::Scenario* scenario = NULL;
@@ -131,6 +186,7 @@ RLMachine::RLMachine(System& in_system, Archive& in_archive)
     throw rlvm::Exception("Invalid scenario file");
   pushStackFrame(StackFrame(scenario, scenario->begin(),
                             StackFrame::TYPE_ROOT));
+  archive_.prefetchJumpTargets(scenario->sceneNumber());
 
   // Initial value of the savepoint
   markSavepoint();
@@ -154,6 +210,24 @@ RLMachine::RLMachine(System& in_system, Archive& in_archive)
 RLMachine::~RLMachine() {
   if (undefined_log_)
     cerr << *undefined_log_;
+
+  if (allocation_log_) {
+    allocation_counter::setEnabled(false);
+    cerr << *allocation_log_;
+  }
+
+  if (profile_) {
+    allocation_counter::setEnabled(false);
+    cerr << *profile_;
+
+    fs::ofstream stacks(profile_stack_path_);
+    if (stacks) {
+      profile_->stacks.writeCollapsedStacks(stacks);
+    } else {
+      cerr << "Couldn't write profile stacks to " << profile_stack_path_
+           << endl;
+    }
+  }
 }
 
 void RLMachine::attachModule(RLModule* module) {
@@ -175,6 +249,8 @@ void RLMachine::attachModule(RLModule* module) {
   }
 
   modules_.insert(packed_module, module);
+  dispatch_generation_ = next_dispatch_generation++;
+  image_names_.clear();
 }
 
 int RLMachine::getIntValue(const libReallive::IntMemRef& ref) {
@@ -252,6 +328,23 @@ void RLMachine::executeNextInstruction() {
   if (halted() == true) {
     return;
   } else {
+    // Where we are has to be noted before running the instruction, since it
+    // may jump, return or finish a LongOperation.
+    string profile_stack, profile_long_op;
+    int profile_seen = 0, profile_line = 0;
+    long profile_allocations = 0;
+    ptime profile_start;
+    if (profile_) {
+      profile_stack = profileStack();
+      if (call_stack_.back().frame_type == StackFrame::TYPE_LONGOP)
+        profile_long_op = longOperationName(*call_stack_.back().long_op);
+      profile_seen = sceneNumber();
+      profile_line = line_;
+      profile_operation_.clear();
+      profile_allocations = allocation_counter::count();
+      profile_start = microsec_clock::universal_time();
+    }
+
     try {
       if (call_stack_.back().frame_type == StackFrame::TYPE_LONGOP) {
         delay_stack_modifications_ = true;
@@ -312,6 +405,67 @@ void RLMachine::executeNextInstruction() {
       cout << "(SEEN" << call_stack_.back().scenario->sceneNumber()
            << ")(Line " << line_ << "):  " << e.what() << endl;
     }
+
+    if (profile_) {
+      long long microseconds =
+          (microsec_clock::universal_time() - profile_start).
+          total_microseconds();
+      long allocations = allocation_counter::count() - profile_allocations;
+
+      ostringstream seen;
+      seen << "SEEN" << setw(4) << setfill('0') << profile_seen;
+      profile_->seens.recordCall(seen.str(), microseconds, allocations);
+      seen << ":" << profile_line;
+      profile_->lines.recordCall(seen.str(), microseconds, allocations);
+
+      if (!profile_long_op.empty()) {
+        profile_->long_operations.recordCall(profile_long_op, microseconds,
+                                             allocations);
+      }
+
+      if (!profile_operation_.empty())
+        profile_stack += ";" + profile_operation_;
+      profile_->stacks.recordCall(profile_stack, microseconds, allocations);
+    }
+
+    if (--image_lookahead_countdown_ <= 0 || scenario_changed_)
+      prefetchUpcomingImages();
+
+    // Only now that the instruction which jumped has finished running is it
+    // safe to free the scenario that it was part of.
+    if (scenario_changed_)
+      evictUnusedScenarios();
+  }
+}
+
+void RLMachine::executeInstructionSlice(unsigned int time_slice_ms) {
+  EventSystem& event = system_.event();
+  unsigned int start = event.getTicks();
+
+  for (int count = 1; ; ++count) {
+    executeNextInstruction();
+
+    // LongOperations expect the rest of the system to run between each of
+    // their ticks.
+    if (halted() || call_stack_.empty() ||
+        call_stack_.back().frame_type == StackFrame::TYPE_LONGOP) {
+      return;
+    }
+
+    // forceWait() means the bytecode asked for a refresh or is spinning on
+    // input, so the next tick should sleep. The tick doesn't sleep when
+    // we're forced to fast forward or skipping read text, so there's no
+    // reason to stop for it then.
+    if (system_.forceWait()) {
+      if (!system_.forceFastForward() && !system_.text().renderingSuppressed())
+        return;
+      system_.setForceWait(false);
+    }
+
+    if (count % kInstructionsPerClockCheck == 0 &&
+        event.getTicks() - start >= time_slice_ms) {
+      return;
+    }
   }
 }
 
@@ -336,12 +490,45 @@ void RLMachine::advanceInstructionPointer() {
 }
 
 void RLMachine::executeCommand(const CommandElement& f) {
-  ModuleMap::iterator it = modules_.find(packModuleNumber(f.modtype(),
-                                                          f.module()));
-  if (it != modules_.end()) {
-    it->second->dispatchFunction(*this, f);
-  } else {
-    throw rlvm::UnimplementedOpcode(*this, f);
+  RLOperation* op = f.cachedOperation(dispatch_generation_);
+  if (!op) {
+    ModuleMap::iterator it = modules_.find(packModuleNumber(f.modtype(),
+                                                            f.module()));
+    if (it != modules_.end())
+      op = it->second->findOperation(f.opcode(), f.overload());
+
+    if (!op)
+      throw rlvm::UnimplementedOpcode(*this, f);
+
+    f.setCachedOperation(dispatch_generation_, op);
+  }
+
+  bool measuring = allocation_log_ || profile_;
+  long allocations_before = measuring ? allocation_counter::count() : 0;
+  ptime start;
+  if (profile_)
+    start = microsec_clock::universal_time();
+
+  try {
+    op->dispatchFunction(*this, f);
+  } catch(rlvm::Exception& e) {
+    e.setOperation(op);
+    throw;
+  }
+
+  if (measuring) {
+    long allocations = allocation_counter::count() - allocations_before;
+    string name = operationName(*op, f);
+    if (allocation_log_)
+      allocation_log_->recordAllocations(name, allocations);
+
+    if (profile_) {
+      profile_->opcodes.recordCall(
+          name,
+          (microsec_clock::universal_time() - start).total_microseconds(),
+          allocations);
+      profile_operation_ = name;
+    }
   }
 }
 
@@ -373,6 +560,9 @@ void RLMachine::jump(int scenario_num, int entrypoint) {
     call_stack_.back().scenario = scenario;
     call_stack_.back().ip = scenario->findEntrypoint(entrypoint);
   }
+
+  archive_.prefetchJumpTargets(scenario_num);
+  scenario_changed_ = true;
 }
 
 void RLMachine::farcall(int scenario_num, int entrypoint) {
@@ -391,6 +581,8 @@ void RLMachine::farcall(int scenario_num, int entrypoint) {
     markSavepoint();
 
   pushStackFrame(StackFrame(scenario, it, StackFrame::TYPE_FARCALL));
+  archive_.prefetchJumpTargets(scenario_num);
+  scenario_changed_ = true;
 }
 
 void RLMachine::returnFromFarcall() {
@@ -554,27 +746,29 @@ int RLMachine::getProbableEncodingType() const {
 }
 
 void RLMachine::performTextout(const TextoutElement& e) {
-  std::string unparsed_text = e.text();
-  if (boost::starts_with(unparsed_text, SeenEnd)) {
-    unparsed_text = SeenEnd;
-    halt();
+  // Scenario text never changes, so the conversion to UTF-8 is kept on the
+  // element and only the names are filled in each time.
+  boost::shared_ptr<ParsedTextout> parsed = e.parsedText();
+  if (!parsed || parsed->encoding() != getTextEncoding()) {
+    std::string unparsed_text = e.text();
+    if (boost::starts_with(unparsed_text, SeenEnd)) {
+      halt();
+      performTextout(SeenEnd);
+      return;
+    }
+
+    parsed.reset(new ParsedTextout(unparsed_text, getTextEncoding()));
+    e.setParsedText(parsed);
   }
 
-  performTextout(unparsed_text);
+  displayText(parsed->render(*memory_));
 }
 
 void RLMachine::performTextout(const std::string& cp932str) {
-  std::string name_parsed_text;
-  try {
-    parseNames(*memory_, cp932str, name_parsed_text);
-  } catch(rlvm::Exception& e) {
-    // WEIRD: Sometimes rldev (and the official compiler?) will generate strings
-    // that aren't valid shift_jis. Fall back while I figure out how to handle
-    // this.
-    name_parsed_text = cp932str;
-  }
+  displayText(ParsedTextout(cp932str, getTextEncoding()).render(*memory_));
+}
 
-  std::string utf8str = cp932toUTF8(name_parsed_text, getTextEncoding());
+void RLMachine::displayText(const std::string& utf8str) {
   TextSystem& ts = system().text();
 
   // Display UTF-8 characters
@@ -586,6 +780,23 @@ void RLMachine::performTextout(const std::string& cp932str) {
   pushLongOperation(ptr.release());
 }
 
+std::string RLMachine::profileStack() const {
+  ostringstream oss;
+  for (vector<StackFrame>::const_iterator it = call_stack_.begin();
+       it != call_stack_.end(); ++it) {
+    if (it != call_stack_.begin())
+      oss << ";";
+
+    if (it->frame_type == StackFrame::TYPE_LONGOP) {
+      oss << longOperationName(*it->long_op);
+    } else {
+      oss << "SEEN" << setw(4) << setfill('0') << it->scenario->sceneNumber();
+    }
+  }
+
+  return oss.str();
+}
+
 void RLMachine::setKidokuMarker(int kidoku_number) {
   // Check to see if we mark savepoints on textout
   if (shouldSetMessageSavepoint() &&
@@ -657,6 +868,17 @@ void RLMachine::recordUndefinedOpcodeCounts() {
   undefined_log_.reset(new OpcodeLog);
 }
 
+void RLMachine::recordOpcodeAllocations() {
+  allocation_log_.reset(new OpcodeLog);
+  allocation_counter::setEnabled(true);
+}
+
+void RLMachine::recordOpcodeProfile(const std::string& collapsed_stack_path) {
+  profile_.reset(new OpcodeProfile);
+  profile_stack_path_ = collapsed_stack_path;
+  allocation_counter::setEnabled(true);
+}
+
 void RLMachine::halt() {
   halted_ = true;
 }
@@ -677,6 +899,96 @@ void RLMachine::setLineNumber(const int i) {
   }
 }
 
+void RLMachine::evictUnusedScenarios() {
+  scenario_changed_ = false;
+  if (archive_.memoryBudget() == 0)
+    return;
+
+  std::set<int> in_use;
+  for (vector<StackFrame>::const_iterator it = call_stack_.begin();
+       it != call_stack_.end(); ++it) {
+    in_use.insert(it->scenario->sceneNumber());
+  }
+  for (vector<StackFrame>::const_iterator it = savepoint_call_stack_.begin();
+       it != savepoint_call_stack_.end(); ++it) {
+    in_use.insert(it->scenario->sceneNumber());
+  }
+
+  archive_.evictUnused(in_use);
+}
+
+void RLMachine::prefetchUpcomingImages() {
+  image_lookahead_countdown_ = kImageLookaheadInterval;
+
+  GraphicsSystem& graphics = system_.graphics();
+  if (!graphics.canPrefetchImages() || call_stack_.empty() ||
+      call_stack_.back().frame_type == StackFrame::TYPE_LONGOP) {
+    return;
+  }
+
+  // Only commands from the scenario we're in are kept. This bounds the cache,
+  // and since scenarios are only evicted right after a change of scenario,
+  // it never holds the address of a command that has been freed.
+  if (scenario_changed_)
+    image_names_.clear();
+
+  // This is a straight line scan; it doesn't follow gotos. Scripts generally
+  // set up the next scene a few lines before displaying it, and a lookahead
+  // that runs into a jump catches up once the jump is taken.
+  Scenario::const_iterator it = call_stack_.back().ip;
+  Scenario::const_iterator end = call_stack_.back().scenario->end();
+  for (int i = 0; i < kImageLookaheadElements && it != end; ++i, ++it) {
+    const CommandElement* command = dynamic_cast<const CommandElement*>(&*it);
+    if (!command)
+      continue;
+
+    // Each pass overlaps the last, so the names are only worked out the first
+    // time a command comes into view.
+    ImageNameCache::iterator names = image_names_.find(command);
+    if (names == image_names_.end()) {
+      names = image_names_.insert(
+          make_pair(command, vector<string>())).first;
+      findImageNames(*command, names->second);
+    }
+
+    for (vector<string>::const_iterator name = names->second.begin();
+         name != names->second.end(); ++name) {
+      graphics.prefetchImage(*name);
+    }
+  }
+}
+
+void RLMachine::findImageNames(const CommandElement& command,
+                               vector<string>& names) {
+  ModuleMap::iterator module = modules_.find(
+      packModuleNumber(command.modtype(), command.module()));
+  int loads_images = 0;
+  if (module == modules_.end() ||
+      !module->second->getProperty(P_LOADS_IMAGES, loads_images) ||
+      !loads_images) {
+    return;
+  }
+
+  for (size_t j = 0; j < command.param_count(); ++j) {
+    // Integer expressions and memory references all start with '$'.
+    libReallive::DataSpan param = command.get_param_span(j);
+    if (param.empty() || param.data()[0] == '$')
+      continue;
+
+    try {
+      const char* src = param.data();
+      auto_ptr<ExpressionPiece> piece(get_data(src));
+      if (piece->expressionValueType() == libReallive::ValueTypeString &&
+          !piece->isMemoryReference()) {
+        names.push_back(piece->getStringValue(*this));
+      }
+    } catch (...) {
+      // Whatever is wrong with this parameter will be reported when the
+      // opcode actually runs.
+    }
+  }
+}
+
 void RLMachine::addLineAction(const int seen, const int line,
                               boost::function<void(void)> function) {
   if (!on_line_actions_)
@@ -36,6 +36,7 @@
 #include "libReallive/bytecode_fwd.h"
 #include "libReallive/scenario.h"
 
+#include <map>
 #include <string>
 #include <vector>
 #include <boost/shared_ptr.hpp>
@@ -48,6 +49,7 @@ class IntMemRef;
 class LongOperation;
 class Memory;
 class OpcodeLog;
+struct OpcodeProfile;
 class RLModule;
 class RealLiveDLL;
 class System;
@@ -261,6 +263,12 @@ class RLMachine {
   // Executes the next instruction in the bytecode in
   void executeNextInstruction();
 
+  // Executes instructions until |time_slice_ms| has passed or until the rest
+  // of the system needs to run: a LongOperation is on top of the stack, the
+  // bytecode asked for a refresh, or the machine halted. Always executes at
+  // least one instruction.
+  void executeInstructionSlice(unsigned int time_slice_ms);
+
   // Call executeNextInstruction() repeatedly until the RLMachine is
   // halted. This function is used in unit testing, and would never be
   // called during real usage of an RLMachine instance since other
@@ -296,6 +304,19 @@ class RLMachine {
   // results to stderr on machine destruction.
   void recordUndefinedOpcodeCounts();
 
+  // Starts counting the heap allocations made while dispatching each
+  // opcode. Will print the per opcode totals to stderr on machine
+  // destruction.
+  void recordOpcodeAllocations();
+
+  // Starts timing every opcode, LongOperation tick, scenario and line, and
+  // counting their heap allocations. Prints flat profiles to stderr on
+  // machine destruction and writes the time spent under each call stack to
+  // |collapsed_stack_path| in the format flamegraph.pl reads. Allocations are
+  // counted process wide, so callers should stop background work first (as
+  // RLVMInstance does with the scenario and image preloaders).
+  void recordOpcodeProfile(const std::string& collapsed_stack_path);
+
   // ---------------------------------------------------------------------
 
   // Force the machine to halt. This should terminate the execution of
@@ -339,6 +360,22 @@ class RLMachine {
   // stack, though it does clear the shadow save stack.
   void localReset();
 
+  // Lets the archive drop parsed scenarios that are over its memory budget,
+  // keeping every scenario referenced by the call stack or the savepoint call
+  // stack. Called after an instruction that jumped or farcalled finishes.
+  void evictUnusedScenarios();
+
+  // Scans the next few bytecode elements of the current scenario for opcodes
+  // that load images by constant name, and asks the graphics system to start
+  // decoding them.
+  void prefetchUpcomingImages();
+
+  // Appends the constant string parameters of |command| to |names| if its
+  // module loads images. Results are kept in |image_names_| by
+  // prefetchUpcomingImages().
+  void findImageNames(const libReallive::CommandElement& command,
+                      std::vector<std::string>& names);
+
   // Adds a programatic action triggered by a line marker in a specific SEEN
   // file. This is used both by luaRlvm to trigger actions specified in lua to
   // drive rlvm's playing certain games, but is also used for game specific
@@ -347,6 +384,13 @@ class RLMachine {
                      boost::function<void(void)>);
 
  private:
+  // Starts a TextoutLongOperation showing |utf8str|.
+  void displayText(const std::string& utf8str);
+
+  // The current call stack as profiler frames, outermost first: each
+  // scenario as "SEEN0010" and each LongOperation by class name.
+  std::string profileStack() const;
+
   // The Reallive VM's integer and string memory
   boost::scoped_ptr<Memory> memory_;
 
@@ -358,6 +402,12 @@ class RLMachine {
   // Mapping between the module_type:module pair and the module implementation
   ModuleMap modules_;
 
+  // Identifies the current set of |modules_|. CommandElements cache the
+  // RLOperation they resolve to along with this value; it is unique per
+  // machine and changes whenever a module is attached, so a stale cache entry
+  // from another machine (or from before an attach) is never used.
+  unsigned int dispatch_generation_;
+
   // States whether the RLMachine is in the halted state (and thus won't
   // execute more instructions)
   bool halted_;
@@ -389,6 +439,18 @@ class RLMachine {
   // undefined opcodes.
   boost::scoped_ptr<OpcodeLog> undefined_log_;
 
+  // (Optional) Heap allocations made by each opcode we dispatched.
+  boost::scoped_ptr<OpcodeLog> allocation_log_;
+
+  // (Optional) Wall time and allocations of everything we ran, and where to
+  // write its call stacks on destruction.
+  boost::scoped_ptr<OpcodeProfile> profile_;
+  std::string profile_stack_path_;
+
+  // The operation executeCommand() last dispatched; the innermost frame of
+  // the current instruction's profiler stack.
+  std::string profile_operation_;
+
   // Override defaults
   bool mark_savepoints_;
 
@@ -402,6 +464,20 @@ class RLMachine {
   // stuff.
   bool replaying_graphics_stack_;
 
+  // Set by jump() and farcall() so that executeNextInstruction() gives the
+  // archive a chance to evict scenarios once the instruction is done.
+  bool scenario_changed_;
+
+  // Instructions left until prefetchUpcomingImages() looks ahead again.
+  int image_lookahead_countdown_;
+
+  // The names findImageNames() found in each command of the current scenario
+  // that prefetchUpcomingImages() has looked at. Cleared when the scenario or
+  // the set of modules changes.
+  typedef std::map<const libReallive::CommandElement*,
+                   std::vector<std::string> > ImageNameCache;
+  ImageNameCache image_names_;
+
   /// The actions that were delayed when |delay_stack_modifications_| is on.
   std::vector<boost::function<void(void)> > delayed_modifications_;
 
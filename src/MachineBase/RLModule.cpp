@@ -123,13 +123,12 @@ RLModule::PropertyList::iterator RLModule::findProperty(int property) const {
 }
 
 void RLModule::dispatchFunction(RLMachine& machine, const CommandElement& f) {
-  OpcodeMap::iterator it =
-      stored_operations.find(packOpcodeNumber(f.opcode(), f.overload()));
-  if (it != stored_operations.end()) {
+  RLOperation* op = findOperation(f.opcode(), f.overload());
+  if (op) {
     try {
-      it->second->dispatchFunction(machine, f);
+      op->dispatchFunction(machine, f);
     } catch(rlvm::Exception& e) {
-      e.setOperation(it->second);
+      e.setOperation(op);
       throw;
     }
   } else {
@@ -137,6 +136,15 @@ void RLModule::dispatchFunction(RLMachine& machine, const CommandElement& f) {
   }
 }
 
+RLOperation* RLModule::findOperation(int opcode, unsigned char overload) {
+  OpcodeMap::iterator it =
+      stored_operations.find(packOpcodeNumber(opcode, overload));
+  if (it != stored_operations.end())
+    return it->second;
+
+  return NULL;
+}
+
 std::ostream& operator<<(std::ostream& os, const RLModule& module) {
   os << "mod<" << module.moduleName() << "," << module.moduleType()
      << ":" << module.moduleNumber() << ">";
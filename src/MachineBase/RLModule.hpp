@@ -119,6 +119,10 @@ class RLModule : public boost::noncopyable {
   void dispatchFunction(RLMachine& machine,
                         const libReallive::CommandElement& f);
 
+  // Returns the RLOperation registered for |opcode|/|overload|, or NULL if
+  // this module doesn't implement it.
+  RLOperation* findOperation(int opcode, unsigned char overload);
+
   OpcodeMap::iterator begin() { return stored_operations.begin(); }
   OpcodeMap::iterator end() { return stored_operations.end(); }
 
@@ -102,7 +102,8 @@ bool RLOperation::advanceInstructionPointer() {
 void RLOperation::dispatchFunction(RLMachine& machine,
                                    const CommandElement& ff) {
   if (!ff.areParametersParsed()) {
-    vector<string> unparsed = ff.getUnparsedParameters();
+    ParameterSpans unparsed;
+    ff.getParameterSpans(unparsed);
     ptr_vector<ExpressionPiece> output;
     parseParameters(unparsed, output);
     ff.setParsedParameters(output);
@@ -135,9 +136,9 @@ IntConstant_T::type IntConstant_T::getData(
 // Was working to change the verify_type to parse_parameters.
 void IntConstant_T::parseParameters(
   unsigned int& position,
-  const std::vector<std::string>& input,
+  const libReallive::ParameterSpans& input,
   boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-  const char* data = input.at(position).c_str();
+  const char* data = input.at(position).data();
   auto_ptr<ExpressionPiece> ep(get_data(data));
 
   if (ep->expressionValueType() != libReallive::ValueTypeInteger) {
@@ -158,9 +159,9 @@ IntReference_T::type IntReference_T::getData(
 
 void IntReference_T::parseParameters(
   unsigned int& position,
-  const std::vector<std::string>& input,
+  const libReallive::ParameterSpans& input,
   boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-  const char* data = input.at(position).c_str();
+  const char* data = input.at(position).data();
   auto_ptr<ExpressionPiece> ep(get_data(data));
 
   if (ep->expressionValueType() != libReallive::ValueTypeInteger) {
@@ -175,50 +176,19 @@ StrConstant_T::type StrConstant_T::getData(
     RLMachine& machine,
     const boost::ptr_vector<libReallive::ExpressionPiece>& p,
     unsigned int& position) {
-  // When I was trying to get P_BRIDE running in rlvm, I noticed that when
-  // loading a game, I would often crash with invalid iterators in the LRUCache
-  // library, in SDLGraphicsSystem where I cached recently used images. After
-  // adding some verification methods to it, it was obvious that it's internal
-  // state was entirely screwed up. There were duplicates in the std::list<>
-  // (it's a precondition that its elements are unique), there were entries in
-  // the std::list<> that didn't exist in the corresponding std::map<>; the
-  // data structure was a complete mess. I verified the datastructure before
-  // and after each operation...and found that it would almost always be
-  // corrupted in the check that happened at the beginning of each
-  // function. Printing out the c_str() pointers showed there was no change
-  // between the consistent data structure and the corrupted one; the
-  // underlying pointers were the same.
-  //
-  // Setting a few watch points, the internal c_str() buffers were being
-  // overwritten by a memcpy in libstdc++ which was called by boost::serialize
-  // during the loading of the RLMachine's local memory.  But that makes
-  // sense. Think about what happens when we execute the following kepago:
-  //
-  //   strS[0] = 'SOMEFILE'
-  //   grpOpenBg(0, strS[0])
-  //
-  // We are assigning a value into the RLMachine's string memory. We are then
-  // passing a copy-on-write string, backed by one memory buffer that contains
-  // 'SOMEFILE' around. LRUCache and string memory now point to the same char*
-  // buffer.
-  //
-  // boost::serialization appears to ignore the COW semantics of std::string
-  // and just writes into it during a serialization::load() no matter how many
-  // people hold references to the inner buffer. Now we have one screwed up
-  // LRUCache data structure, and probably screwed up other places.
-  //
-  // So to fix this, we break the COW semantics here by forcing a copy. I'd
-  // prefer to do this in RLMachine or Memory, but I can't because they return
-  // references.
-  string tmp = p[position++].getStringValue(machine);
-  return string(tmp.data(), tmp.size());
+  // This used to force a deep copy, because a copy-on-write string handed out
+  // here could end up sharing its buffer with string memory, which
+  // boost::serialization then wrote straight into while loading a save. The
+  // memory banks now drop their strings before loading instead; see
+  // LocalMemory::load().
+  return p[position++].getStringValue(machine);
 }
 
 void StrConstant_T::parseParameters(
   unsigned int& position,
-  const std::vector<std::string>& input,
+  const libReallive::ParameterSpans& input,
   boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-  const char* data = input.at(position).c_str();
+  const char* data = input.at(position).data();
   auto_ptr<ExpressionPiece> ep(get_data(data));
 
   if (ep->expressionValueType() != libReallive::ValueTypeString) {
@@ -239,9 +209,9 @@ StrReference_T::type StrReference_T::getData(
 
 void StrReference_T::parseParameters(
   unsigned int& position,
-  const std::vector<std::string>& input,
+  const libReallive::ParameterSpans& input,
   boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-  const char* data = input.at(position).c_str();
+  const char* data = input.at(position).data();
   auto_ptr<ExpressionPiece> ep(get_data(data));
 
   if (ep->expressionValueType() != libReallive::ValueTypeString) {
@@ -252,6 +222,17 @@ void StrReference_T::parseParameters(
   position++;
 }
 
+// -----------------------------------------------------------------------
+// StringParameter
+// -----------------------------------------------------------------------
+
+const std::string& StringParameter::emptyString() {
+  static const std::string empty;
+  return empty;
+}
+
+// -----------------------------------------------------------------------
+
 void RLOp_SpecialCase::dispatch(
   RLMachine& machine,
   const boost::ptr_vector<libReallive::ExpressionPiece>& parameters) {
@@ -260,11 +241,11 @@ void RLOp_SpecialCase::dispatch(
 }
 
 void RLOp_SpecialCase::parseParameters(
-  const std::vector<std::string>& input,
+  const libReallive::ParameterSpans& input,
   boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-  for (vector<string>::const_iterator it = input.begin(); it != input.end();
+  for (ParameterSpans::const_iterator it = input.begin(); it != input.end();
       ++it) {
-    const char* src = it->c_str();
+    const char* src = it->data();
     output.push_back(get_data(src));
   }
 }
@@ -273,7 +254,8 @@ void RLOp_SpecialCase::dispatchFunction(RLMachine& machine,
                                         const libReallive::CommandElement& ff) {
   // First try to run the default parse_parameters if we can.
   if (!ff.areParametersParsed()) {
-    vector<string> unparsed = ff.getUnparsedParameters();
+    ParameterSpans unparsed;
+    ff.getParameterSpans(unparsed);
     ptr_vector<ExpressionPiece> output;
     parseParameters(unparsed, output);
     ff.setParsedParameters(output);
@@ -33,8 +33,10 @@
 #include <vector>
 
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/type_traits/remove_const.hpp>
+#include <boost/type_traits/remove_reference.hpp>
 
-#include "libReallive/bytecode_fwd.h"
+#include "libReallive/bytecode.h"
 #include "libReallive/expression.h"
 
 class MappedRLModule;
@@ -124,9 +126,10 @@ class RLOperation {
     RLMachine& machine, const ExpressionPiecesVector& parameters) = 0;
 
   // Parses the parameters in the CommandElement passed in into an
-  // output ptr_vector that contains parsed ExpressionPieces for each
-  virtual void parseParameters(
-    const std::vector<std::string>& input, ExpressionPiecesVector& output) = 0;
+  // output ptr_vector that contains parsed ExpressionPieces for each. |input|
+  // points straight at the element's bytes.
+  virtual void parseParameters(const libReallive::ParameterSpans& input,
+                               ExpressionPiecesVector& output) = 0;
 
   // The public interface used by the RLModule; how a method is dispatched.
   virtual void dispatchFunction(RLMachine& machine,
@@ -174,7 +177,7 @@ struct IntConstant_T {
 
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output);
 
   enum {
@@ -188,9 +191,13 @@ struct IntConstant_T {
 // subclass, and should not be used directly. It should only be used
 // as a template parameter to one of those classes, or of another type
 // definition struct.
+//
+// The value is a reference straight into string memory or the parsed
+// constant, so no string is copied to call an operation. It is only valid
+// for the duration of the call; copy it to keep it.
 struct StrConstant_T {
   // The output type of this type struct
-  typedef std::string type;
+  typedef const std::string& type;
 
   // Convert the incoming parameter objects into the resulting type
   static type getData(RLMachine& machine,
@@ -200,7 +207,7 @@ struct StrConstant_T {
 
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output);
 
   enum {
@@ -208,6 +215,44 @@ struct StrConstant_T {
   };
 };
 
+// How composite type structs hold a StrConstant_T: a pointer to the string in
+// memory or the parsed constant that converts to a const std::string&. Like
+// StrConstant_T::type, it is only valid for the duration of the call; copy
+// the string to keep it.
+class StringParameter {
+ public:
+  StringParameter() : str_(&emptyString()) {}
+  StringParameter(const std::string& str) : str_(&str) {}
+
+  operator const std::string&() const { return *str_; }
+  const std::string& str() const { return *str_; }
+
+ private:
+  static const std::string& emptyString();
+
+  const std::string* str_;
+};
+
+// Maps a T::type to what composite type structs store for it.
+template<typename TYPE>
+struct StoredValue {
+  typedef typename boost::remove_const<
+    typename boost::remove_reference<TYPE>::type>::type type;
+};
+
+template<>
+struct StoredValue<const std::string&> {
+  typedef StringParameter type;
+};
+
+// The type that composite type structs (Argc_T, Complex2_T, Special_T...)
+// use to hold a T::type. Strings are held as a StringParameter so that
+// neither a tuple nor a Special_T copies them.
+template<typename T>
+struct StoredType {
+  typedef typename StoredValue<typename T::type>::type type;
+};
+
 struct empty_struct { };
 
 // Defines a null type for the Special parameter.
@@ -223,7 +268,7 @@ struct Empty_T {
 
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output) {
   }
 
@@ -255,7 +300,7 @@ class RLOp_SpecialCase : public RLOperation {
 
   // Default implementation that simply parses everything as data;
   // doesn't work in the case of complex expressions.
-  virtual void parseParameters(const std::vector<std::string>& input,
+  virtual void parseParameters(const libReallive::ParameterSpans& input,
                                ExpressionPiecesVector& output);
 
   // Method that is overridden by all subclasses to implement the
@@ -290,7 +335,7 @@ template<typename A = Empty_T, typename B = Empty_T, typename C = Empty_T,
          typename Y = Empty_T, typename Z = Empty_T>
 struct RLOp_NormalOperation : public RLOperation {
  public:
-  void parseParameters(const std::vector<std::string>& input,
+  void parseParameters(const libReallive::ParameterSpans& input,
                        ExpressionPiecesVector& output);
 };
 
@@ -302,7 +347,7 @@ inline void RLOp_NormalOperation<
   Empty_T, Empty_T, Empty_T, Empty_T, Empty_T, Empty_T, Empty_T,
   Empty_T, Empty_T, Empty_T, Empty_T, Empty_T, Empty_T, Empty_T,
   Empty_T, Empty_T, Empty_T, Empty_T, Empty_T>::
-parseParameters(const std::vector<std::string>& input,
+parseParameters(const libReallive::ParameterSpans& input,
                 ExpressionPiecesVector& output) {
 }
 
@@ -317,7 +362,7 @@ template<typename A, typename B, typename C,
          typename Y, typename Z>
 void RLOp_NormalOperation<A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P,
                           Q, R, S, T, U, V, W, X, Y, Z>::parseParameters(
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output) {
   unsigned int position = 0;
   A::parseParameters(position, input, output);
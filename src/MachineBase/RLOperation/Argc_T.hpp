@@ -36,7 +36,7 @@
 template<typename CON>
 struct Argc_T {
   // The output type of this type struct
-  typedef typename std::vector<typename CON::type> type;
+  typedef typename std::vector<typename StoredType<CON>::type> type;
 
   // Convert the incoming parameter objects into the resulting type.
   // Passes each parameter down to
@@ -47,7 +47,7 @@ struct Argc_T {
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output);
 
   enum {
@@ -70,7 +70,7 @@ getData(RLMachine& machine,
 template<typename CON>
 void Argc_T<CON>::
 parseParameters(unsigned int& position,
-                const std::vector<std::string>& input,
+                const libReallive::ParameterSpans& input,
                 boost::ptr_vector<libReallive::ExpressionPiece>& output) {
   for (; position < input.size(); ) {
     CON::parseParameters(position, input, output);
@@ -40,7 +40,8 @@
 template<typename A, typename B>
 struct Complex2_T {
   // The output type of this type struct
-  typedef boost::tuple<typename A::type, typename B::type> type;
+  typedef boost::tuple<typename StoredType<A>::type,
+                       typename StoredType<B>::type> type;
 
   // Convert the incoming parameter objects into the resulting type.
   static type getData(RLMachine& machine,
@@ -58,9 +59,9 @@ struct Complex2_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-    const char* data = input.at(position).c_str();
+    const char* data = input.at(position).data();
     std::auto_ptr<libReallive::ExpressionPiece> ep(
         libReallive::get_complex_param(data));
     output.push_back(ep.release());
@@ -79,8 +80,9 @@ struct Complex2_T {
 template<typename A, typename B, typename C>
 struct Complex3_T {
   // The output type of this type struct
-  typedef boost::tuple<typename A::type, typename B::type,
-                       typename C::type> type;
+  typedef boost::tuple<typename StoredType<A>::type,
+                       typename StoredType<B>::type,
+                       typename StoredType<C>::type> type;
 
   // Convert the incoming parameter objects into the resulting type.
   static type getData(RLMachine& machine,
@@ -100,9 +102,9 @@ struct Complex3_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-    const char* data = input.at(position).c_str();
+    const char* data = input.at(position).data();
     std::auto_ptr<libReallive::ExpressionPiece> ep(
         libReallive::get_complex_param(data));
     output.push_back(ep.release());
@@ -121,8 +123,10 @@ struct Complex3_T {
 template<typename A, typename B, typename C, typename D>
 struct Complex4_T {
   // The output type of this type struct
-  typedef boost::tuple<typename A::type, typename B::type,
-                       typename C::type, typename D::type> type;
+  typedef boost::tuple<typename StoredType<A>::type,
+                       typename StoredType<B>::type,
+                       typename StoredType<C>::type,
+                       typename StoredType<D>::type> type;
 
   // Convert the incoming parameter objects into the resulting type.
   static type getData(RLMachine& machine,
@@ -145,9 +149,9 @@ struct Complex4_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-    const char* data = input.at(position).c_str();
+    const char* data = input.at(position).data();
     std::auto_ptr<libReallive::ExpressionPiece> ep(
         libReallive::get_complex_param(data));
     output.push_back(ep.release());
@@ -167,10 +171,13 @@ template<typename A, typename B, typename C, typename D, typename E,
          typename F, typename G>
 struct Complex7_T {
   // The output type of this type struct
-  typedef boost::tuple<typename A::type, typename B::type,
-                       typename C::type, typename D::type,
-                       typename E::type, typename F::type,
-                       typename G::type> type;
+  typedef boost::tuple<typename StoredType<A>::type,
+                       typename StoredType<B>::type,
+                       typename StoredType<C>::type,
+                       typename StoredType<D>::type,
+                       typename StoredType<E>::type,
+                       typename StoredType<F>::type,
+                       typename StoredType<G>::type> type;
 
   // Convert the incoming parameter objects into the resulting type.
   static type getData(RLMachine& machine,
@@ -199,9 +206,9 @@ struct Complex7_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-    const char* data = input.at(position).c_str();
+    const char* data = input.at(position).data();
     std::auto_ptr<libReallive::ExpressionPiece> ep(
         libReallive::get_complex_param(data));
     output.push_back(ep.release());
@@ -221,10 +228,14 @@ template<typename A, typename B, typename C, typename D, typename E,
          typename F, typename G, typename H>
 struct Complex8_T {
   // The output type of this type struct
-  typedef boost::tuple<typename A::type, typename B::type,
-                       typename C::type, typename D::type,
-                       typename E::type, typename F::type,
-                       typename G::type, typename H::type> type;
+  typedef boost::tuple<typename StoredType<A>::type,
+                       typename StoredType<B>::type,
+                       typename StoredType<C>::type,
+                       typename StoredType<D>::type,
+                       typename StoredType<E>::type,
+                       typename StoredType<F>::type,
+                       typename StoredType<G>::type,
+                       typename StoredType<H>::type> type;
 
   // Convert the incoming parameter objects into the resulting type.
   static type getData(RLMachine& machine,
@@ -254,9 +265,9 @@ struct Complex8_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-    const char* data = input.at(position).c_str();
+    const char* data = input.at(position).data();
     std::auto_ptr<libReallive::ExpressionPiece> ep(
         libReallive::get_complex_param(data));
     output.push_back(ep.release());
@@ -47,7 +47,7 @@ struct DefaultIntValue_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
     if (position < input.size()) {
       IntConstant_T::parseParameters(position, input, output);
@@ -65,7 +65,7 @@ struct DefaultIntValue_T {
 // Typestruct that will return an empty string if there isn't a value.
 struct DefaultStrValue_T {
   // The output type of this type struct
-  typedef std::string type;
+  typedef const std::string& type;
 
   // Convert the incoming parameter objects into the resulting type
   static type getData(RLMachine& machine,
@@ -74,13 +74,14 @@ struct DefaultStrValue_T {
     if (position < p.size()) {
       return StrConstant_T::getData(machine, p, position);
     } else {
-      return std::string();
+      static const std::string empty;
+      return empty;
     }
   }
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
     if (position < input.size()) {
       StrConstant_T::parseParameters(position, input, output);
@@ -46,7 +46,7 @@ struct RGBColour_T {
   }
 
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output) {
     IntConstant_T::parseParameters(position, input, output);
     IntConstant_T::parseParameters(position, input, output);
@@ -80,7 +80,7 @@ struct RGBMaybeAColour_T {
   }
 
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output) {
     IntConstant_T::parseParameters(position, input, output);
     IntConstant_T::parseParameters(position, input, output);
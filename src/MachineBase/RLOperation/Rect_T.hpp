@@ -45,7 +45,7 @@ struct Point_T {
   }
 
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output) {
     IntConstant_T::parseParameters(position, input, output);
     IntConstant_T::parseParameters(position, input, output);
@@ -88,7 +88,7 @@ struct Rect_T {
 
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(unsigned int& position,
-                              const std::vector<std::string>& input,
+                              const libReallive::ParameterSpans& input,
                               ExpressionPiecesVector& output) {
     IntConstant_T::parseParameters(position, input, output);
     IntConstant_T::parseParameters(position, input, output);
@@ -49,7 +49,7 @@ struct IntReference_T {
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output);
 
   enum {
@@ -76,7 +76,7 @@ struct StrReference_T {
   // Parse the raw parameter string and put the results in ExpressionPiece
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output);
 
   enum {
@@ -46,11 +46,11 @@ struct Special_T {
     // 0 = A, 1 = B
     int type;
 
-    typename A::type first;
-    typename B::type second;
-    typename C::type third;
-    typename D::type fourth;
-    typename E::type fifth;
+    typename StoredType<A>::type first;
+    typename StoredType<B>::type second;
+    typename StoredType<C>::type third;
+    typename StoredType<D>::type fourth;
+    typename StoredType<E>::type fifth;
   };
 
   // Export our internal struct as our external type
@@ -117,9 +117,9 @@ struct Special_T {
 
   static void parseParameters(
       unsigned int& position,
-      const std::vector<std::string>& input,
+      const libReallive::ParameterSpans& input,
       boost::ptr_vector<libReallive::ExpressionPiece>& output) {
-    const char* data = input.at(position).c_str();
+    const char* data = input.at(position).data();
     std::auto_ptr<libReallive::ExpressionPiece> ep(libReallive::get_data(data));
     output.push_back(ep.release());
     position++;
@@ -28,6 +28,8 @@
 
 #include <iostream>
 
+#include <boost/thread/thread.hpp>
+
 #include "MachineBase/DumpScenario.hpp"
 #include "MachineBase/GameHacks.hpp"
 #include "MachineBase/Memory.hpp"
@@ -37,8 +39,10 @@
 #include "Modules/Module_Sys_Save.hpp"
 #include "Platforms/gcn/GCNPlatform.hpp"
 #include "Systems/Base/GraphicsSystem.hpp"
+#include "Systems/Base/SoundSystem.hpp"
 #include "Systems/Base/SystemError.hpp"
 #include "Systems/SDL/SDLSystem.hpp"
+#include "Utilities/AllocationCounter.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/File.hpp"
 #include "Utilities/findFontFile.h"
@@ -52,6 +56,11 @@ using namespace std;
 
 namespace fs = boost::filesystem;
 
+// How long bytecode runs between ticks of the event, text, sound and graphics
+// systems when nothing (a LongOperation, a refresh) needs them sooner. Well
+// under a frame, so input and animation don't notice.
+const unsigned int kInstructionTimeSliceMs = 2;
+
 // AVG32 file checks. We can't run AVG32 games.
 const char* avg32_exes[] = {
   "avg3216m.exe",
@@ -73,8 +82,15 @@ RLVMInstance::RLVMInstance()
       memory_(false),
       undefined_opcodes_(false),
       count_undefined_copcodes_(false),
+      count_allocations_(false),
       load_save_(-1),
-      dump_seen_(-1) {
+      dump_seen_(-1),
+      preparse_all_(false),
+      scenario_cache_mb_(0),
+      image_cache_mb_(0),
+      image_disk_cache_mb_(0),
+      software_compositor_threads_(-1),
+      cache_stats_(false) {
   srand(time(NULL));
 }
 
@@ -99,6 +115,18 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
     if (memory_)
       gameexe("MEMORY") = 1;
 
+    if (scenario_cache_mb_ > 0)
+      gameexe("__SCENARIO_CACHE_MB") = scenario_cache_mb_;
+
+    if (image_cache_mb_ > 0)
+      gameexe("__IMAGE_CACHE_MB") = image_cache_mb_;
+
+    if (image_disk_cache_mb_ > 0)
+      gameexe("__IMAGE_DISK_CACHE_MB") = image_disk_cache_mb_;
+
+    if (software_compositor_threads_ >= 0)
+      gameexe("__SOFTWARE_COMPOSITOR") = software_compositor_threads_;
+
     if (!custom_font_.empty()) {
       if (!fs::exists(custom_font_)) {
         throw rlvm::UserPresentableError(
@@ -117,8 +145,37 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
       return;
     }
 
+    if ((count_allocations_ || !profile_path_.empty()) &&
+        !allocation_counter::available()) {
+      cerr << "Heap allocations are only counted when rlvm is built with "
+           << "scons --count-allocations." << endl;
+      count_allocations_ = false;
+    }
+
+    // Parse scenarios on otherwise idle cores. We normally leave one core for
+    // the interpreter and only parse what it's likely to jump to next. The
+    // allocation counter is global, so the preloader stays off while counting
+    // to keep its allocations out of the per opcode totals.
+    int cores = boost::thread::hardware_concurrency();
+    bool counting_allocations = allocation_counter::available() &&
+        (count_allocations_ || !profile_path_.empty());
+    if (preparse_all_ && !counting_allocations) {
+      arc.enableBackgroundParsing(cores);
+      arc.preparseAll();
+    } else if (!counting_allocations) {
+      arc.enableBackgroundParsing(cores - 1);
+    }
+
+    int cache_mb = gameexe("__SCENARIO_CACHE_MB").to_int(0);
+    if (cache_mb > 0)
+      arc.setMemoryBudget(static_cast<size_t>(cache_mb) * 1024 * 1024);
+
     SDLSystem sdlSystem(gameexe);
     RLMachine rlmachine(sdlSystem, arc);
+
+    // The image preloader's thread allocates too, so it also stays off.
+    if (counting_allocations)
+      sdlSystem.graphics().disableImagePreloading();
     addAllModules(rlmachine);
     addGameHacks(rlmachine);
 
@@ -144,6 +201,12 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
     if (count_undefined_copcodes_)
       rlmachine.recordUndefinedOpcodeCounts();
 
+    if (count_allocations_)
+      rlmachine.recordOpcodeAllocations();
+
+    if (!profile_path_.empty())
+      rlmachine.recordOpcodeProfile(profile_path_);
+
     Serialization::loadGlobalMemory(rlmachine);
 
     // Now to preform a quick integrity check. If the user opened the Japanese
@@ -161,11 +224,22 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
       // etc.
       sdlSystem.run(rlmachine);
 
-      // Run the rlmachine through another instruction
-      rlmachine.executeNextInstruction();
+      // Run bytecode until it's time for the next system tick.
+      rlmachine.executeInstructionSlice(kInstructionTimeSliceMs);
     }
 
     Serialization::saveGlobalMemory(rlmachine);
+
+    if (cache_stats_) {
+      sdlSystem.graphics().printCacheStatistics(cerr);
+      sdlSystem.sound().printCacheStatistics(cerr);
+      sdlSystem.text().printCacheStatistics(cerr);
+      if (cache_mb > 0) {
+        cerr << "Scenario cache: " << arc.residentCount() << " scenarios, "
+             << arc.residentSize() / 1024 << " KB resident (budget "
+             << cache_mb << " MB)" << endl;
+      }
+    }
   } catch (rlvm::UserPresentableError& e) {
     ReportFatalError(e.message_text(), e.informative_text());
   } catch (rlvm::Exception& e) {
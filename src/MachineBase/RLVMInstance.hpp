@@ -47,10 +47,20 @@ class RLVMInstance {
   void set_memory() { memory_ = true; }
   void set_undefined_opcodes() { undefined_opcodes_ = true; }
   void set_count_undefined() { count_undefined_copcodes_ = true; }
+  void set_count_allocations() { count_allocations_ = true; }
+  void set_profile_path(const std::string& path) { profile_path_ = path; }
   void set_load_save(int in) { load_save_ = in; }
   void set_custom_font(const std::string& font) { custom_font_ = font; }
 
   void set_dump_seen(int in) { dump_seen_ = in; }
+  void set_preparse_all() { preparse_all_ = true; }
+  void set_scenario_cache_mb(int in) { scenario_cache_mb_ = in; }
+  void set_image_cache_mb(int in) { image_cache_mb_ = in; }
+  void set_image_disk_cache_mb(int in) { image_disk_cache_mb_ = in; }
+  void set_software_compositor_threads(int in) {
+    software_compositor_threads_ = in;
+  }
+  void set_cache_stats() { cache_stats_ = true; }
 
   // Optionally brings up a file selection dialog to get the game directory. In
   // case this isn't implemented or the user clicks cancel, returns an empty
@@ -100,11 +110,43 @@ class RLVMInstance {
   // used on exit.
   bool count_undefined_copcodes_;
 
+  // Whether we should print out a table of how many heap allocations each
+  // opcode made on exit.
+  bool count_allocations_;
+
+  // If not empty, profile every opcode, print flat profiles on exit and
+  // write collapsed call stacks to this file.
+  std::string profile_path_;
+
   // Loads the specified save file as soon as emulation starts if not -1.
   int load_save_;
 
   // Dumps psuedokepago of the current seen to stdout and exit if not -1.
   int dump_seen_;
+
+  // Whether we should parse every scenario in SEEN.TXT on all cores at
+  // startup instead of only prefetching likely jump targets.
+  bool preparse_all_;
+
+  // Megabytes of parsed scenarios to keep resident before evicting ones that
+  // aren't on the call stack. 0 means unbounded.
+  int scenario_cache_mb_;
+
+  // Megabytes of decoded images and their textures to cache. 0 means use the
+  // Gameexe's __IMAGE_CACHE_MB or the default.
+  int image_cache_mb_;
+
+  // Megabytes of decoded images to keep on disk between runs. 0 means use
+  // the Gameexe's __IMAGE_DISK_CACHE_MB, which defaults to off.
+  int image_disk_cache_mb_;
+
+  // Threads to composite the screen on the CPU with instead of OpenGL, 0
+  // meaning one per core. -1 means use OpenGL unless the Gameexe sets
+  // __SOFTWARE_COMPOSITOR.
+  int software_compositor_threads_;
+
+  // Whether we should print the image and sound caches' hit rates on exit.
+  bool cache_stats_;
 };
 
 #endif  // SRC_MACHINEBASE_RLVMINSTANCE_hpp_
@@ -34,6 +34,7 @@
 #include "Effects/Effect.hpp"
 #include "Effects/EffectFactory.hpp"
 #include "MachineBase/GeneralOperations.hpp"
+#include "MachineBase/Properties.hpp"
 #include "MachineBase/RLMachine.hpp"
 #include "MachineBase/RLOperation.hpp"
 #include "MachineBase/RLOperation/Argc_T.hpp"
@@ -84,7 +85,7 @@ struct bgrLoadHaikei_blank : public RLOp_Void_1<IntConstant_T> {
 };
 
 struct bgrLoadHaikei_main : RLOp_Void_2<StrConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, string filename, int sel) {
+  void operator()(RLMachine& machine, const string& filename, int sel) {
     System& system = machine.system();
     GraphicsSystem& graphics = system.graphics();
     graphics.setDefaultBgrName(filename);
@@ -130,7 +131,8 @@ struct bgrLoadHaikei_main : RLOp_Void_2<StrConstant_T, IntConstant_T> {
 
 struct bgrLoadHaikei_wtf
     : RLOp_Void_4<StrConstant_T, IntConstant_T, IntConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, string filename, int sel, int a, int b) {
+  void operator()(RLMachine& machine, const string& filename, int sel, int a,
+                  int b) {
     // cerr << "Filename: " << filename
     //      << "(a: " << a << ", b: " << b << ")" << endl;
     bgrLoadHaikei_main()(machine, filename, sel);
@@ -140,8 +142,8 @@ struct bgrLoadHaikei_wtf
 struct bgrLoadHaikei_wtf2
     : RLOp_Void_6<StrConstant_T, IntConstant_T, IntConstant_T, IntConstant_T,
                   IntConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, string filename, int sel, int a, int b,
-                  int c, int d) {
+  void operator()(RLMachine& machine, const string& filename, int sel, int a,
+                  int b, int c, int d) {
     // cerr << "Filename: " << filename
     //      << "(a: " << a << ", b: " << b << ", c: " << c << ", d: " << d << ")"
     //      << endl;
@@ -168,7 +170,7 @@ typedef Argc_T<
 struct bgrMulti_1 : public RLOp_Void_3<
   StrConstant_T, IntConstant_T, BgrMultiCommand> {
  public:
-  void operator()(RLMachine& machine, string filename, int effectNum,
+  void operator()(RLMachine& machine, const string& filename, int effectNum,
                   BgrMultiCommand::type commands) {
     GraphicsSystem& graphics = machine.system().graphics();
 
@@ -178,12 +180,12 @@ struct bgrMulti_1 : public RLOp_Void_3<
     graphics.setGraphicsBackground(BACKGROUND_HIK);
 
     // May need to use current background.
-    if (filename == "???")
-      filename = graphics.defaultBgrName();
+    const string& name =
+        filename == "???" ? graphics.defaultBgrName() : filename;
 
     // Load "filename" as the background.
     shared_ptr<const Surface> surface(
-        graphics.getSurfaceNamedAndMarkViewed(machine, filename));
+        graphics.getSurfaceNamedAndMarkViewed(machine, name));
     surface->blitToSurface(*graphics.getHaikei(),
                            surface->rect(), surface->rect(),
                            255, true);
@@ -261,7 +263,7 @@ struct bgrSetYOffset : public RLOp_Void_1< IntConstant_T > {
 };
 
 struct bgrPreloadScript : public RLOp_Void_2<IntConstant_T, StrConstant_T> {
-  void operator()(RLMachine& machine, int slot, string name) {
+  void operator()(RLMachine& machine, int slot, const string& name) {
     System& system = machine.system();
     fs::path path = system.findFile(name, HIK_FILETYPES);
     if (iends_with(path.string(), "hik")) {
@@ -294,4 +296,6 @@ BgrModule::BgrModule()
             callFunction(&GraphicsSystem::ClearPreloadedHIKScript));
   addOpcode(2002, 0, "bgrClearAllPreloadedScripts",
             callFunction(&GraphicsSystem::ClearAllPreloadedHIKScripts));
+
+  setProperty(P_LOADS_IMAGES, 1);
 }
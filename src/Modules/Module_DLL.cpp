@@ -38,7 +38,7 @@ using namespace libReallive;
 namespace {
 
 struct LoadDLL : public RLOp_Void_2<IntConstant_T, StrConstant_T> {
-  void operator()(RLMachine& machine, int slot, string name) {
+  void operator()(RLMachine& machine, int slot, const string& name) {
     machine.loadDLL(slot, name);
   }
 };
@@ -39,6 +39,7 @@
 #include "LongOperations/WaitLongOperation.hpp"
 #include "LongOperations/ZoomLongOperation.hpp"
 #include "MachineBase/GeneralOperations.hpp"
+#include "MachineBase/Properties.hpp"
 #include "MachineBase/RLMachine.hpp"
 #include "MachineBase/RLOperation.hpp"
 #include "MachineBase/RLOperation/Argc_T.hpp"
@@ -245,7 +246,8 @@ struct load_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
   bool use_alpha_;
   explicit load_1(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string filename, int dc, int opacity) {
+  void operator()(RLMachine& machine, const string& filename, int dc,
+                  int opacity) {
     GraphicsSystem& graphics = machine.system().graphics();
 
     shared_ptr<const Surface> surface(
@@ -273,7 +275,7 @@ struct load_3 : public RLOp_Void_5<
   bool use_alpha_;
   explicit load_3(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string filename, int dc,
+  void operator()(RLMachine& machine, const string& filename, int dc,
                   Rect srcRect, Point dest, int opacity) {
     GraphicsSystem& graphics = machine.system().graphics();
     shared_ptr<const Surface> surface(
@@ -389,7 +391,7 @@ struct open_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
   bool use_alpha_;
   explicit open_1(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string filename, int effectNum,
+  void operator()(RLMachine& machine, const string& filename, int effectNum,
                   int opacity) {
     Rect src;
     Point dest;
@@ -416,7 +418,7 @@ struct open_0 : public RLOp_Void_2<StrConstant_T, IntConstant_T> {
   open_1 delegate_;
   explicit open_0(bool in) : delegate_(in) {}
 
-  void operator()(RLMachine& machine, string filename, int effectNum) {
+  void operator()(RLMachine& machine, const string& filename, int effectNum) {
     vector<int> selEffect = getSELEffect(machine, effectNum);
     delegate_(machine, filename, effectNum, selEffect[14]);
   }
@@ -428,7 +430,7 @@ struct open_3 : public RLOp_Void_5<
   bool use_alpha_;
   explicit open_3(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string filename, int effectNum,
+  void operator()(RLMachine& machine, const string& filename, int effectNum,
                   Rect srcRect, Point dest, int opacity) {
     GraphicsSystem& graphics = machine.system().graphics();
 
@@ -456,7 +458,7 @@ struct open_2 : public RLOp_Void_4<
   open_3<SPACE> delegate_;
   explicit open_2(bool in) : delegate_(in) {}
 
-  void operator()(RLMachine& machine, string filename, int effectNum,
+  void operator()(RLMachine& machine, const string& filename, int effectNum,
                   Rect src, Point dest) {
     int opacity = getSELEffect(machine, effectNum).at(14);
     delegate_(machine, filename, effectNum, src, dest, opacity);
@@ -472,7 +474,7 @@ struct open_4 : public RLOp_Void_13<
   bool use_alpha_;
   explicit open_4(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string fileName,
+  void operator()(RLMachine& machine, const string& fileName,
                   Rect srcRect, Point dest,
                   int time, int style, int direction, int interpolation,
                   int xsize, int ysize, int a, int b, int opacity, int c) {
@@ -494,7 +496,7 @@ struct open_4 : public RLOp_Void_13<
 
 struct openBg_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
                                      IntConstant_T > {
-  void operator()(RLMachine& machine, string fileName, int effectNum,
+  void operator()(RLMachine& machine, const string& fileName, int effectNum,
                   int opacity) {
     GraphicsSystem& graphics = machine.system().graphics();
     Rect srcRect;
@@ -517,7 +519,7 @@ struct openBg_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
 struct openBg_0 : public RLOp_Void_2< StrConstant_T, IntConstant_T > {
   openBg_1 delegate_;
 
-  void operator()(RLMachine& machine, string filename, int effectNum) {
+  void operator()(RLMachine& machine, const string& filename, int effectNum) {
     vector<int> selEffect = getSELEffect(machine, effectNum);
     delegate_(machine, filename, effectNum, selEffect[14]);
   }
@@ -529,7 +531,7 @@ struct openBg_3 : public RLOp_Void_5<
   bool use_alpha_;
   explicit openBg_3(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string fileName, int effectNum,
+  void operator()(RLMachine& machine, const string& fileName, int effectNum,
                   Rect srcRect, Point destPt, int opacity) {
     GraphicsSystem& graphics = machine.system().graphics();
     OpenBgPrelude(machine, fileName);
@@ -552,7 +554,7 @@ struct openBg_2
   openBg_3<SPACE> delegate_;
   explicit openBg_2(bool in) : delegate_(in) {}
 
-  void operator()(RLMachine& machine, string fileName, int effectNum,
+  void operator()(RLMachine& machine, const string& fileName, int effectNum,
                   Rect srcRect, Point destPt) {
     vector<int> selEffect = getSELEffect(machine, effectNum);
     delegate_(machine, fileName, effectNum, srcRect, destPt, selEffect[14]);
@@ -568,7 +570,7 @@ struct openBg_4 : public RLOp_Void_13<
   bool use_alpha_;
   explicit openBg_4(bool in) : use_alpha_(in) {}
 
-  void operator()(RLMachine& machine, string fileName,
+  void operator()(RLMachine& machine, const string& fileName,
                   Rect srcRect, Point destPt,
                   int time, int style, int direction, int interpolation,
                   int xsize, int ysize, int a, int b, int opacity, int c) {
@@ -941,8 +943,8 @@ struct multi_str_1
     : public RLOp_Void_4<StrConstant_T, IntConstant_T, IntConstant_T,
                          MultiCommand>,
       public multi_command<SPACE> {
-  void operator()(RLMachine& machine, string filename, int effect, int alpha,
-                  MultiCommand::type commands) {
+  void operator()(RLMachine& machine, const string& filename, int effect,
+                  int alpha, MultiCommand::type commands) {
     load_1(false)(machine, filename, MULTI_TARGET_DC, 255);
     multi_command<SPACE>::handleMultiCommands(machine, commands);
     display_0()(machine, MULTI_TARGET_DC, effect);
@@ -954,7 +956,7 @@ struct multi_str_0
     : public RLOp_Void_3<StrConstant_T, IntConstant_T, MultiCommand> {
   multi_str_1<SPACE> delegate_;
 
-  void operator()(RLMachine& machine, string filename, int effect,
+  void operator()(RLMachine& machine, const string& filename, int effect,
                   MultiCommand::type commands) {
     delegate_(machine, filename, effect, 255, commands);
   }
@@ -1241,6 +1243,8 @@ GrpModule::GrpModule()
   addUnsupportedOpcode(1408, 0, "recSlide");
   addOpcode(1409, 0, "recMaskStretchBlt", new stretchBlit_1<REC>(true));
   addOpcode(1409, 1, "recMaskStretchBlt", new stretchBlit_1<REC>(true));
+
+  setProperty(P_LOADS_IMAGES, 1);
 }
 
 // @}
@@ -58,8 +58,7 @@ namespace {
 
 // Finds which case should be used in the *_case functions.
 int evaluateCase(RLMachine& machine, const CommandElement& gotoElement) {
-  string tmpval = gotoElement.get_param(0);
-  const char* location = tmpval.c_str();
+  const char* location = gotoElement.get_param_span(0).data();
 
   auto_ptr<ExpressionPiece> condition(get_expression(location));
   int value = condition->integerValue(machine);
@@ -188,9 +187,7 @@ struct goto_unless : public RLOp_SpecialCase {
 // TODO(erg): Figure out why I couldn't use cached expressions here.
 struct goto_on : public RLOp_SpecialCase {
   void operator()(RLMachine& machine, const CommandElement& gotoElement) {
-    // use a temporary object so that it is only destroyed at end of scope! --RT
-    string tmpval = gotoElement.get_param(0);
-    const char* location = tmpval.c_str();
+    const char* location = gotoElement.get_param_span(0).data();
     auto_ptr<ExpressionPiece> condition(get_expression(location));
     int value = condition->integerValue(machine);
 
@@ -232,8 +229,7 @@ struct gosub : public RLOp_SpecialCase {
 // true.
 struct gosub_if : public RLOp_SpecialCase {
   void operator()(RLMachine& machine, const CommandElement& gotoElement) {
-    string tmpval = gotoElement.get_param(0);
-    const char* location = tmpval.c_str();
+    const char* location = gotoElement.get_param_span(0).data();
     auto_ptr<ExpressionPiece> condition(get_expression(location));
 
     if (condition->integerValue(machine)) {
@@ -463,7 +459,7 @@ struct rtl_with_1 : public RLOp_Void_Void {
 // one. Used in the Little Busters battle system to return string values that
 // refer to people's faces. (See SEEN8700).
 struct push_string_value_up : public RLOp_Void_2<IntConstant_T, StrConstant_T> {
-  void operator()(RLMachine& machine, int index, std::string val) {
+  void operator()(RLMachine& machine, int index, const std::string& val) {
     machine.pushStringValueUp(index, val);
   }
 };
@@ -62,15 +62,14 @@ namespace {
 void setObjectDataToGan(
   RLMachine& machine,
   GraphicsObject& obj,
-  string& imgFilename,
+  const string& imgFilename,
   const string& ganFilename) {
   /// @todo This is a hack and probably a source of errors. Figure
   ///       out what '???' means when used as the first parameter to
   ///       objOfFileGan.
-  if (imgFilename == "???")
-    imgFilename = ganFilename;
+  const string& img = imgFilename == "???" ? ganFilename : imgFilename;
   obj.setObjectData(
-      new GanGraphicsObjectData(machine.system(), ganFilename, imgFilename));
+      new GanGraphicsObjectData(machine.system(), ganFilename, img));
 }
 
 typedef boost::function<void(RLMachine&, GraphicsObject& obj,
@@ -105,7 +104,7 @@ struct objGeneric_0 : public RLOp_Void_2<IntConstant_T, StrConstant_T> {
   DataFunction data_fun_;
   explicit objGeneric_0(const DataFunction& fun) : data_fun_(fun) {}
 
-  void operator()(RLMachine& machine, int buf, string filename) {
+  void operator()(RLMachine& machine, int buf, const string& filename) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     data_fun_(machine, obj, filename);
   }
@@ -116,7 +115,8 @@ struct objGeneric_1 : public RLOp_Void_3<IntConstant_T, StrConstant_T,
   DataFunction data_fun_;
   explicit objGeneric_1(const DataFunction& fun) : data_fun_(fun) {}
 
-  void operator()(RLMachine& machine, int buf, string filename, int visible) {
+  void operator()(RLMachine& machine, int buf, const string& filename,
+                  int visible) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     data_fun_(machine, obj, filename);
     obj.setVisible(visible);
@@ -129,8 +129,8 @@ struct objGeneric_2
   DataFunction data_fun_;
   explicit objGeneric_2(const DataFunction& fun) : data_fun_(fun) {}
 
-  void operator()(RLMachine& machine, int buf, string filename, int visible,
-                  int x, int y) {
+  void operator()(RLMachine& machine, int buf, const string& filename,
+                  int visible, int x, int y) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     data_fun_(machine, obj, filename);
     obj.setVisible(visible);
@@ -145,8 +145,8 @@ struct objGeneric_3 : public RLOp_Void_6<IntConstant_T, StrConstant_T,
   DataFunction data_fun_;
   explicit objGeneric_3(const DataFunction& fun) : data_fun_(fun) {}
 
-  void operator()(RLMachine& machine, int buf, string filename, int visible,
-                  int x, int y, int pattern) {
+  void operator()(RLMachine& machine, int buf, const string& filename,
+                  int visible, int x, int y, int pattern) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     data_fun_(machine, obj, filename);
     obj.setVisible(visible);
@@ -162,8 +162,9 @@ struct objGeneric_4 : public RLOp_Void_8<
   DataFunction data_fun_;
   explicit objGeneric_4(const DataFunction& fun) : data_fun_(fun) {}
 
-  void operator()(RLMachine& machine, int buf, string filename, int visible,
-                  int x, int y, int pattern, int scrollX, int scrollY) {
+  void operator()(RLMachine& machine, int buf, const string& filename,
+                  int visible, int x, int y, int pattern, int scrollX,
+                  int scrollY) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
 
     data_fun_(machine, obj, filename);
@@ -178,8 +179,8 @@ struct objGeneric_4 : public RLOp_Void_8<
 
 struct objOfFileGan_0
     : public RLOp_Void_3<IntConstant_T, StrConstant_T, StrConstant_T> {
-  void operator()(RLMachine& machine, int buf, string imgFilename,
-                  string ganFilename) {
+  void operator()(RLMachine& machine, int buf, const string& imgFilename,
+                  const string& ganFilename) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     setObjectDataToGan(machine, obj, imgFilename, ganFilename);
     obj.setVisible(true);
@@ -189,8 +190,8 @@ struct objOfFileGan_0
 struct objOfFileGan_1
     : public RLOp_Void_4<IntConstant_T, StrConstant_T, StrConstant_T,
                          IntConstant_T> {
-  void operator()(RLMachine& machine, int buf, string imgFilename,
-                  string ganFilename, int visible) {
+  void operator()(RLMachine& machine, int buf, const string& imgFilename,
+                  const string& ganFilename, int visible) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     setObjectDataToGan(machine, obj, imgFilename, ganFilename);
     obj.setVisible(visible);
@@ -200,8 +201,8 @@ struct objOfFileGan_1
 struct objOfFileGan_2
     : public RLOp_Void_6<IntConstant_T, StrConstant_T, StrConstant_T,
                          IntConstant_T, IntConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, int buf, string imgFilename,
-                  string ganFilename, int visible, int x, int y) {
+  void operator()(RLMachine& machine, int buf, const string& imgFilename,
+                  const string& ganFilename, int visible, int x, int y) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     setObjectDataToGan(machine, obj, imgFilename, ganFilename);
     obj.setVisible(visible);
@@ -214,8 +215,9 @@ struct objOfFileGan_3
     : public RLOp_Void_7<IntConstant_T, StrConstant_T, StrConstant_T,
                          IntConstant_T, IntConstant_T, IntConstant_T,
                          IntConstant_T> {
-  void operator()(RLMachine& machine, int buf, string imgFilename,
-                  string ganFilename, int visible, int x, int y, int pattern) {
+  void operator()(RLMachine& machine, int buf, const string& imgFilename,
+                  const string& ganFilename, int visible, int x, int y,
+                  int pattern) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     setObjectDataToGan(machine, obj, imgFilename, ganFilename);
     obj.setVisible(visible);
@@ -302,7 +304,7 @@ struct objOfRect_2 : public RLOp_Void_6<IntConstant_T, IntConstant_T,
 struct objOfChild_0 : public RLOp_Void_4<IntConstant_T, IntConstant_T,
                                          StrConstant_T, StrConstant_T> {
   void operator()(RLMachine& machine, int buf, int count,
-                  string imgFilename, string ganFilename) {
+                  const string& imgFilename, const string& ganFilename) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     obj.setObjectData(new ParentGraphicsObjectData(count));
     obj.setVisible(true);
@@ -313,7 +315,8 @@ struct objOfChild_1 : public RLOp_Void_5<IntConstant_T, IntConstant_T,
                                          StrConstant_T, StrConstant_T,
                                          IntConstant_T> {
   void operator()(RLMachine& machine, int buf, int count,
-                  string imgFilename, string ganFilename, int visible) {
+                  const string& imgFilename, const string& ganFilename,
+                  int visible) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     obj.setObjectData(new ParentGraphicsObjectData(count));
     obj.setVisible(visible);
@@ -325,8 +328,8 @@ struct objOfChild_2 : public RLOp_Void_7<IntConstant_T, IntConstant_T,
                                          IntConstant_T, IntConstant_T,
                                          IntConstant_T> {
   void operator()(RLMachine& machine, int buf, int count,
-                  string imgFilename, string ganFilename, int visible,
-                  int x, int y) {
+                  const string& imgFilename, const string& ganFilename,
+                  int visible, int x, int y) {
     GraphicsObject& obj = getGraphicsObject(machine, this, buf);
     obj.setObjectData(new ParentGraphicsObjectData(count));
     obj.setVisible(visible);
@@ -390,6 +393,7 @@ ObjFgCreationModule::ObjFgCreationModule()
     : RLModule("ObjFgCreation", 1, 71) {
   addObjectCreationFunctions(*this);
   setProperty(P_FGBG, OBJ_FG);
+  setProperty(P_LOADS_IMAGES, 1);
 }
 
 // -----------------------------------------------------------------------
@@ -398,6 +402,7 @@ ObjBgCreationModule::ObjBgCreationModule()
     : RLModule("ObjBgCreation", 1, 72) {
   addObjectCreationFunctions(*this);
   setProperty(P_FGBG, OBJ_BG);
+  setProperty(P_LOADS_IMAGES, 1);
 }
 
 // -----------------------------------------------------------------------
@@ -406,6 +411,7 @@ ChildObjFgCreationModule::ChildObjFgCreationModule()
     : MappedRLModule(childObjMappingFun, "ChildObjFgCreation", 2, 71) {
   addObjectCreationFunctions(*this);
   setProperty(P_FGBG, OBJ_FG);
+  setProperty(P_LOADS_IMAGES, 1);
 }
 
 // -----------------------------------------------------------------------
@@ -414,4 +420,5 @@ ChildObjBgCreationModule::ChildObjBgCreationModule()
     : MappedRLModule(childObjMappingFun, "ChildObjBgCreation", 2, 72) {
   addObjectCreationFunctions(*this);
   setProperty(P_FGBG, OBJ_BG);
+  setProperty(P_LOADS_IMAGES, 1);
 }
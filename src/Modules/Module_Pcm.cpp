@@ -50,27 +50,29 @@ void addPcmWait(RLMachine& machine, int channel) {
 }
 
 struct wavPlay_0 : public RLOp_Void_1<StrConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName) {
+  void operator()(RLMachine& machine, const std::string& fileName) {
     machine.system().sound().wavPlay(fileName, false);
   }
 };
 
 struct wavPlay_1 : public RLOp_Void_2<StrConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName, int channel) {
+  void operator()(RLMachine& machine, const std::string& fileName,
+                  int channel) {
     machine.system().sound().wavPlay(fileName, false, channel);
   }
 };
 
 struct wavPlay_2 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
                                       IntConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName, int channel,
+  void operator()(RLMachine& machine, const std::string& fileName, int channel,
                   int fadein) {
     machine.system().sound().wavPlay(fileName, false, channel, fadein);
   }
 };
 
 struct wavPlayEx_0 : public RLOp_Void_2<StrConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName, int channel) {
+  void operator()(RLMachine& machine, const std::string& fileName,
+                  int channel) {
     machine.system().sound().wavPlay(fileName, false, channel);
     addPcmWait(machine, channel);
   }
@@ -78,7 +80,7 @@ struct wavPlayEx_0 : public RLOp_Void_2<StrConstant_T, IntConstant_T> {
 
 struct wavPlayEx_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
                                         IntConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName, int channel,
+  void operator()(RLMachine& machine, const std::string& fileName, int channel,
                   int fadein) {
     machine.system().sound().wavPlay(fileName, false, channel, fadein);
     addPcmWait(machine, channel);
@@ -86,14 +88,15 @@ struct wavPlayEx_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
 };
 
 struct wavLoop_0 : public RLOp_Void_2<StrConstant_T, IntConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName, int channel) {
+  void operator()(RLMachine& machine, const std::string& fileName,
+                  int channel) {
     machine.system().sound().wavPlay(fileName, true, channel);
   }
 };
 
 struct wavLoop_1 : public RLOp_Void_3<StrConstant_T, IntConstant_T,
                                       IntConstant_T> {
-  void operator()(RLMachine& machine, std::string fileName, int channel,
+  void operator()(RLMachine& machine, const std::string& fileName, int channel,
                   int fadein) {
     machine.system().sound().wavPlay(fileName, true, channel, fadein);
   }
@@ -55,7 +55,7 @@ struct Sel_select : public RLOp_SpecialCase {
   // Prevent us from trying to parse the parameters to the CommandElement as
   // RealLive expressions (because they are not).
   virtual void parseParameters(
-    const std::vector<std::string>& input,
+    const libReallive::ParameterSpans& input,
     boost::ptr_vector<libReallive::ExpressionPiece>& output) {}
 
   void operator()(RLMachine& machine, const CommandElement& ce) {
@@ -72,7 +72,7 @@ struct Sel_select_s : public RLOp_SpecialCase {
   // Prevent us from trying to parse the parameters to the CommandElement as
   // RealLive expressions (because they are not).
   virtual void parseParameters(
-    const std::vector<std::string>& input,
+    const libReallive::ParameterSpans& input,
     boost::ptr_vector<libReallive::ExpressionPiece>& output) {}
 
   void operator()(RLMachine& machine, const CommandElement& ce) {
@@ -101,7 +101,7 @@ struct Sel_select_w : public RLOp_SpecialCase {
   // Prevent us from trying to parse the parameters to the CommandElement as
   // RealLive expressions (because they are not).
   virtual void parseParameters(
-    const std::vector<std::string>& input,
+    const libReallive::ParameterSpans& input,
     boost::ptr_vector<libReallive::ExpressionPiece>& output) {}
 
   void operator()(RLMachine& machine, const CommandElement& ce) {
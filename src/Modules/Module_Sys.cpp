@@ -70,7 +70,7 @@ using boost::shared_ptr;
 namespace {
 
 struct title : public RLOp_Void_1< StrConstant_T > {
-  void operator()(RLMachine& machine, std::string subtitle) {
+  void operator()(RLMachine& machine, const std::string& subtitle) {
     machine.system().graphics().setWindowSubtitle(
       subtitle, machine.getTextEncoding());
   }
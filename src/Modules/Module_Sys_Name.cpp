@@ -47,7 +47,7 @@ struct GetName : public RLOp_Void_2< IntConstant_T, StrReference_T > {
 };
 
 struct SetName : public RLOp_Void_2< IntConstant_T, StrConstant_T > {
-  void operator()(RLMachine& machine, int index, string name) {
+  void operator()(RLMachine& machine, int index, const string& name) {
     machine.memory().setName(index, name);
   }
 };
@@ -60,7 +60,7 @@ struct GetLocalName : public RLOp_Void_2< IntConstant_T, StrReference_T > {
 };
 
 struct SetLocalName : public RLOp_Void_2< IntConstant_T, StrConstant_T > {
-  void operator()(RLMachine& machine, int index, string name) {
+  void operator()(RLMachine& machine, int index, const string& name) {
     machine.memory().setLocalName(index, name);
   }
 };
@@ -103,7 +103,29 @@ int main(int argc, char* argv[]) {
       ("undefined-opcodes", "Display a message on undefined opcodes")
       ("count-undefined",
        "On exit, present a summary table about how many times each undefined "
-       "opcode was called");
+       "opcode was called")
+      ("count-allocations",
+       "On exit, present a summary table about how many heap allocations each "
+       "opcode made (needs a build with scons --count-allocations)")
+      ("profile", po::value<string>(),
+       "On exit, print the wall time and heap allocations of each opcode, "
+       "LongOperation, SEEN and line, and write time per call stack to the "
+       "given file for flamegraph.pl")
+      ("preparse-all",
+       "Parse every scenario in SEEN.TXT on all cores at startup")
+      ("scenario-cache-mb", po::value<int>(),
+       "Evict parsed scenarios that aren't on the call stack once they use "
+       "more than this many megabytes")
+      ("image-cache-mb", po::value<int>(),
+       "Megabytes of decoded images to keep cached")
+      ("image-disk-cache-mb", po::value<int>(),
+       "Keep up to this many megabytes of decoded images on disk so later "
+       "runs don't have to decode them again")
+      ("software-compositor", po::value<int>(),
+       "Draw the screen on the CPU with this many threads instead of with "
+       "OpenGL; 0 uses one thread per core")
+      ("cache-stats",
+       "On exit, print the size and hit rate of the image and sound caches");
 
   // Declare the final option to be game-root
   po::options_description hidden("Hidden");
@@ -208,6 +230,32 @@ int main(int argc, char* argv[]) {
   if (vm.count("count-undefined"))
     instance.set_count_undefined();
 
+  if (vm.count("count-allocations"))
+    instance.set_count_allocations();
+
+  if (vm.count("profile"))
+    instance.set_profile_path(vm["profile"].as<string>());
+
+  if (vm.count("preparse-all"))
+    instance.set_preparse_all();
+
+  if (vm.count("scenario-cache-mb"))
+    instance.set_scenario_cache_mb(vm["scenario-cache-mb"].as<int>());
+
+  if (vm.count("image-cache-mb"))
+    instance.set_image_cache_mb(vm["image-cache-mb"].as<int>());
+
+  if (vm.count("image-disk-cache-mb"))
+    instance.set_image_disk_cache_mb(vm["image-disk-cache-mb"].as<int>());
+
+  if (vm.count("software-compositor")) {
+    instance.set_software_compositor_threads(
+        vm["software-compositor"].as<int>());
+  }
+
+  if (vm.count("cache-stats"))
+    instance.set_cache_stats();
+
   if (vm.count("load-save"))
     instance.set_load_save(vm["load-save"].as<int>());
 
@@ -0,0 +1,117 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "Systems/Base/ColourTransforms.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using boost::uint32_t;
+
+const double MonoKernel::kRedWeight = 0.3;
+const double MonoKernel::kGreenWeight = 0.59;
+const double MonoKernel::kBlueWeight = 0.11;
+
+// -----------------------------------------------------------------------
+
+void TransformRow(uint32_t* pixel, int width, const PixelLayout& layout,
+                  const InvertKernel& kernel) {
+  uint32_t* end = pixel + width;
+#if defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi32(static_cast<int>(layout.colour_mask));
+  for (; end - pixel >= 4; pixel += 4) {
+    __m128i* block = reinterpret_cast<__m128i*>(pixel);
+    _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), mask));
+  }
+#endif
+  for (; pixel != end; ++pixel)
+    *pixel ^= layout.colour_mask;
+}
+
+// -----------------------------------------------------------------------
+
+#if defined(__SSE2__)
+namespace {
+
+// Weighs two pixels' channels, held in the low two lanes of |r|, |g| and
+// |b|, in double precision and in the same order as MonoKernel so that
+// both give the same grey.
+inline __m128 MonoSum(__m128i r, __m128i g, __m128i b) {
+  __m128d sum = _mm_add_pd(
+      _mm_add_pd(
+          _mm_mul_pd(_mm_cvtepi32_pd(r), _mm_set1_pd(MonoKernel::kRedWeight)),
+          _mm_mul_pd(_mm_cvtepi32_pd(g),
+                     _mm_set1_pd(MonoKernel::kGreenWeight))),
+      _mm_mul_pd(_mm_cvtepi32_pd(b), _mm_set1_pd(MonoKernel::kBlueWeight)));
+  return _mm_cvtpd_ps(sum);
+}
+
+// Swaps the high two lanes of |v| into the low two.
+inline __m128i HighPair(__m128i v) {
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+}  // namespace
+#endif
+
+void TransformRow(uint32_t* pixel, int width, const PixelLayout& layout,
+                  const MonoKernel& kernel) {
+  uint32_t* end = pixel + width;
+#if defined(__SSE2__)
+  // Four pixels at a time. There's no table lookup in SSE2, so the weights
+  // are multiplied in directly.
+  const __m128i r_shift = _mm_cvtsi32_si128(layout.r_shift);
+  const __m128i g_shift = _mm_cvtsi32_si128(layout.g_shift);
+  const __m128i b_shift = _mm_cvtsi32_si128(layout.b_shift);
+  const __m128i channel = _mm_set1_epi32(0xff);
+  const __m128i colour_mask =
+      _mm_set1_epi32(static_cast<int>(layout.colour_mask));
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 white = _mm_set1_ps(255.0f);
+  for (; end - pixel >= 4; pixel += 4) {
+    __m128i* block = reinterpret_cast<__m128i*>(pixel);
+    __m128i in = _mm_loadu_si128(block);
+    __m128i r = _mm_and_si128(_mm_srl_epi32(in, r_shift), channel);
+    __m128i g = _mm_and_si128(_mm_srl_epi32(in, g_shift), channel);
+    __m128i b = _mm_and_si128(_mm_srl_epi32(in, b_shift), channel);
+
+    __m128 grey = _mm_movelh_ps(
+        MonoSum(r, g, b), MonoSum(HighPair(r), HighPair(g), HighPair(b)));
+    grey = _mm_min_ps(_mm_max_ps(grey, zero), white);
+    __m128i level = _mm_cvttps_epi32(grey);
+
+    __m128i out = _mm_or_si128(
+        _mm_andnot_si128(colour_mask, in),
+        _mm_or_si128(_mm_sll_epi32(level, r_shift),
+                     _mm_or_si128(_mm_sll_epi32(level, g_shift),
+                                  _mm_sll_epi32(level, b_shift))));
+    _mm_storeu_si128(block, out);
+  }
+#endif
+  TransformRow<MonoKernel>(pixel, end - pixel, layout, kernel);
+}
@@ -0,0 +1,178 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_COLOURTRANSFORMS_HPP_
+#define SRC_SYSTEMS_BASE_COLOURTRANSFORMS_HPP_
+
+#include <boost/cstdint.hpp>
+
+#include <cstdlib>
+
+#include "Systems/Base/Colour.hpp"
+#include "Systems/Base/ToneCurve.hpp"
+#include "Utilities/Graphics.hpp"
+
+// Colour transforms for grpInvert, grpMono, grpColour and tone curves. Each
+// is a kernel that rewrites one pixel's colour channels in place; the
+// surface code instantiates its loops per kernel so the per pixel call is
+// inlined.
+
+// Maps each colour channel through its own table. Every transform but mono
+// treats the channels independently, so the per pixel work is built once per
+// call instead of once per pixel.
+class ChannelTableKernel {
+ public:
+  void operator()(boost::uint8_t& r, boost::uint8_t& g,
+                  boost::uint8_t& b) const {
+    r = r_[r];
+    g = g_[g];
+    b = b_[b];
+  }
+
+ protected:
+  boost::uint8_t r_[256];
+  boost::uint8_t g_[256];
+  boost::uint8_t b_[256];
+};
+
+class ToneCurveKernel : public ChannelTableKernel {
+ public:
+  explicit ToneCurveKernel(const ToneCurveRGBMap& colormap) {
+    for (int i = 0; i < 256; ++i) {
+      r_[i] = colormap[0][i];
+      g_[i] = colormap[1][i];
+      b_[i] = colormap[2][i];
+    }
+  }
+};
+
+class ApplyColourKernel : public ChannelTableKernel {
+ public:
+  explicit ApplyColourKernel(const RGBColour& colour) {
+    for (int i = 0; i < 256; ++i) {
+      r_[i] = compose(colour.r(), i);
+      g_[i] = compose(colour.g(), i);
+      b_[i] = compose(colour.b(), i);
+    }
+  }
+
+ private:
+  static int compose(int in_colour, int surface_colour) {
+    if (in_colour > 0) {
+      return 255 -
+          ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
+            (255 * 255)) * 255);
+    } else if (in_colour < 0) {
+      return (static_cast<float>(std::abs(in_colour) * surface_colour) /
+              (255 * 255)) * 255;
+    } else {
+      return surface_colour;
+    }
+  }
+};
+
+// Inverting a channel is flipping its bits, so on 32-bit surfaces
+// TransformRow() XORs whole pixels instead of calling this.
+class InvertKernel {
+ public:
+  void operator()(boost::uint8_t& r, boost::uint8_t& g,
+                  boost::uint8_t& b) const {
+    r = 255 - r;
+    g = 255 - g;
+    b = 255 - b;
+  }
+};
+
+class MonoKernel {
+ public:
+  static const double kRedWeight;
+  static const double kGreenWeight;
+  static const double kBlueWeight;
+
+  // Each channel's weighted contribution is looked up instead of multiplied,
+  // but summed in the same order so the result is unchanged.
+  MonoKernel() {
+    for (int i = 0; i < 256; ++i) {
+      r_[i] = kRedWeight * i;
+      g_[i] = kGreenWeight * i;
+      b_[i] = kBlueWeight * i;
+    }
+  }
+
+  void operator()(boost::uint8_t& r, boost::uint8_t& g,
+                  boost::uint8_t& b) const {
+    float grayscale = r_[r] + g_[g] + b_[b];
+    clamp(grayscale, 0, 255);
+    r = g = b = static_cast<boost::uint8_t>(grayscale);
+  }
+
+ private:
+  double r_[256];
+  double g_[256];
+  double b_[256];
+};
+
+// Where the colour channels sit in a 32-bit pixel with 8 bits per channel.
+struct PixelLayout {
+  PixelLayout(int r_shift, int g_shift, int b_shift,
+              boost::uint32_t colour_mask)
+      : r_shift(r_shift), g_shift(g_shift), b_shift(b_shift),
+        colour_mask(colour_mask) {
+  }
+
+  int r_shift;
+  int g_shift;
+  int b_shift;
+  boost::uint32_t colour_mask;
+};
+
+// Applies |kernel| to |width| pixels starting at |pixel|, one at a time.
+template<typename Kernel>
+void TransformRow(boost::uint32_t* pixel, int width, const PixelLayout& layout,
+                  const Kernel& kernel) {
+  for (boost::uint32_t* end = pixel + width; pixel != end; ++pixel) {
+    boost::uint32_t in = *pixel;
+    boost::uint8_t r = in >> layout.r_shift;
+    boost::uint8_t g = in >> layout.g_shift;
+    boost::uint8_t b = in >> layout.b_shift;
+    kernel(r, g, b);
+    *pixel = (in & ~layout.colour_mask) |
+        (boost::uint32_t(r) << layout.r_shift) |
+        (boost::uint32_t(g) << layout.g_shift) |
+        (boost::uint32_t(b) << layout.b_shift);
+  }
+}
+
+// Overloads that work on four pixels at a time with SSE2 when it's available
+// and finish the row with the template above. Both give the same result as
+// TransformRow<InvertKernel>() and TransformRow<MonoKernel>().
+void TransformRow(boost::uint32_t* pixel, int width, const PixelLayout& layout,
+                  const InvertKernel& kernel);
+void TransformRow(boost::uint32_t* pixel, int width, const PixelLayout& layout,
+                  const MonoKernel& kernel);
+
+#endif  // SRC_SYSTEMS_BASE_COLOURTRANSFORMS_HPP_
@@ -87,6 +87,8 @@ const Rect EMPTY_CLIP = Rect(Point(0, 0), Size(-1, -1));
 const boost::shared_ptr<GraphicsObject::Impl> GraphicsObject::s_empty_impl(
   new GraphicsObject::Impl);
 
+unsigned int GraphicsObject::s_render_list_generation = 0;
+
 // -----------------------------------------------------------------------
 // GraphicsObject::TextProperties
 // -----------------------------------------------------------------------
@@ -141,10 +143,12 @@ GraphicsObject::Impl::ButtonProperties::ButtonProperties()
 // -----------------------------------------------------------------------
 GraphicsObject::GraphicsObject()
     : impl_(s_empty_impl) {
+  s_render_list_generation++;
 }
 
 GraphicsObject::GraphicsObject(const GraphicsObject& rhs)
     : impl_(rhs.impl_) {
+  s_render_list_generation++;
   if (rhs.object_data_) {
     object_data_.reset(rhs.object_data_->clone());
     object_data_->setOwnedBy(*this);
@@ -156,10 +160,12 @@ GraphicsObject::GraphicsObject(const GraphicsObject& rhs)
 }
 
 GraphicsObject::~GraphicsObject() {
+  s_render_list_generation++;
   deleteObjectMutators();
 }
 
 GraphicsObject& GraphicsObject::operator=(const GraphicsObject& obj) {
+  s_render_list_generation++;
   deleteObjectMutators();
   impl_ = obj.impl_;
 
@@ -174,12 +180,15 @@ GraphicsObject& GraphicsObject::operator=(const GraphicsObject& obj) {
 }
 
 void GraphicsObject::setObjectData(GraphicsObjectData* obj) {
+  s_render_list_generation++;
   object_data_.reset(obj);
   object_data_->setOwnedBy(*this);
 }
 
 void GraphicsObject::setVisible(const int in) {
   makeImplUnique();
+  if (impl_->visible_ != bool(in))
+    s_render_list_generation++;
   impl_->visible_ = in;
 }
 
@@ -374,16 +383,22 @@ void GraphicsObject::setScrollRateY(const int y) {
 
 void GraphicsObject::setZOrder(const int in) {
   makeImplUnique();
+  if (impl_->z_order_ != in)
+    s_render_list_generation++;
   impl_->z_order_ = in;
 }
 
 void GraphicsObject::setZLayer(const int in) {
   makeImplUnique();
+  if (impl_->z_layer_ != in)
+    s_render_list_generation++;
   impl_->z_layer_ = in;
 }
 
 void GraphicsObject::setZDepth(const int in) {
   makeImplUnique();
+  if (impl_->z_depth_ != in)
+    s_render_list_generation++;
   impl_->z_depth_ = in;
 }
 
@@ -843,16 +858,19 @@ void GraphicsObject::render(int objNum,
 }
 
 void GraphicsObject::deleteObject() {
+  s_render_list_generation++;
   object_data_.reset();
   deleteObjectMutators();
 }
 
 void GraphicsObject::resetProperties() {
+  s_render_list_generation++;
   impl_ = s_empty_impl;
   deleteObjectMutators();
 }
 
 void GraphicsObject::clearObject() {
+  s_render_list_generation++;
   impl_ = s_empty_impl;
   deleteObjectMutators();
   object_data_.reset();
@@ -877,6 +895,7 @@ void GraphicsObject::execute(RLMachine& machine) {
 
 template<class Archive>
 void GraphicsObject::serialize(Archive& ar, unsigned int version) {
+  s_render_list_generation++;
   ar & impl_ & object_data_;
 }
 
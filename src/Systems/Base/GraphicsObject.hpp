@@ -292,6 +292,13 @@ class GraphicsObject {
   // Whether we have the default shared data. Only used in unit testing.
   bool isCleared() const { return impl_ == s_empty_impl; }
 
+  // Changes whenever a GraphicsObject is created, copied or destroyed, or
+  // its visibility, object data or z values change. GraphicsSystem only
+  // rebuilds its sorted list of objects to render when this moves.
+  static unsigned int renderListGeneration() {
+    return s_render_list_generation;
+  }
+
  private:
   // Makes the ineternal copy for our copy-on-write semantics. This function
   // checks to see if our Impl object has only one reference to it. If it
@@ -490,6 +497,9 @@ class GraphicsObject {
   // is cloned on write.
   static const boost::shared_ptr<GraphicsObject::Impl> s_empty_impl;
 
+  // See renderListGeneration().
+  static unsigned int s_render_list_generation;
+
   // Our actual implementation data
   boost::shared_ptr<GraphicsObject::Impl> impl_;
 
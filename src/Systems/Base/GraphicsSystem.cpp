@@ -88,6 +88,10 @@ using std::vector;
 
 namespace fs = boost::filesystem;
 
+// Default budget for the image cache. A 640x480 CG costs about 2.4MB with its
+// texture, a 1280x720 one about 7.4MB.
+static const int kDefaultImageCacheMB = 64;
+
 // -----------------------------------------------------------------------
 // GraphicsSystem::GraphicsObjectSettings
 // -----------------------------------------------------------------------
@@ -211,6 +215,19 @@ struct GraphicsSystem::GraphicsObjectImpl {
 
   // Old style graphics stack implementation.
   std::vector<GraphicsStackFrame> old_graphics_stack;
+
+  struct RenderListEntry {
+    int obj_num;
+    GraphicsObject* object;
+    ObjectSettings settings;
+  };
+
+  // Visible foreground objects with something to draw, in the order they're
+  // drawn. Only rebuilt when GraphicsObject::renderListGeneration() has moved
+  // on from |render_list_generation|.
+  std::vector<RenderListEntry> render_list;
+  bool render_list_valid;
+  unsigned int render_list_generation;
 };
 
 // -----------------------------------------------------------------------
@@ -220,7 +237,9 @@ GraphicsSystem::GraphicsObjectImpl::GraphicsObjectImpl(int size)
       background_objects(size),
       saved_foreground_objects(size),
       saved_background_objects(size),
-      use_old_graphics_stack(false) {
+      use_old_graphics_stack(false),
+      render_list_valid(false),
+      render_list_generation(0) {
 }
 
 // -----------------------------------------------------------------------
@@ -245,7 +264,10 @@ GraphicsSystem::GraphicsSystem(System& system, Gameexe& gameexe)
     system_(system),
     preloaded_hik_scripts_(32),
     preloaded_g00_(256),
-    image_cache_(10) {}
+    image_cache_(static_cast<size_t>(
+        gameexe("__IMAGE_CACHE_MB").to_int(kDefaultImageCacheMB)) *
+        1024 * 1024) {
+}
 
 // -----------------------------------------------------------------------
 
@@ -521,6 +543,15 @@ void GraphicsSystem::refresh(std::ostream* tree) {
 }
 
 boost::shared_ptr<Surface> GraphicsSystem::renderToSurface() {
+  if (system().text().renderingSuppressed()) {
+    if (!skipped_frame_ || skipped_frame_->size() != screenSize()) {
+      skipped_frame_ = buildSurface(screenSize());
+      skipped_frame_->fill(RGBAColour::Black());
+    }
+
+    return skipped_frame_;
+  }
+
   beginFrame();
   drawFrame(NULL);
   return endFrameToSurface();
@@ -648,10 +679,8 @@ boost::shared_ptr<HIKScript> GraphicsSystem::GetHIKScript(
 }
 
 void GraphicsSystem::PreloadG00(int slot, const std::string& name) {
-  // We first check our implicit cache just in case so we don't load it twice.
-  boost::shared_ptr<const Surface> surface = image_cache_.fetch(name);
-  if (!surface)
-    surface = loadSurfaceFromFile(name);
+  // We first check our implicit caches just in case so we don't load it twice.
+  boost::shared_ptr<const Surface> surface = loadSurfaceThroughCaches(name);
 
   if (surface)
     surface->EnsureUploaded();
@@ -702,19 +731,76 @@ boost::shared_ptr<const Surface> GraphicsSystem::getSurfaceNamed(
   if (cached_surface)
     return cached_surface;
 
-  // First check to see if this surface is already in our internal cache
-  cached_surface = image_cache_.fetch(short_filename);
-  if (cached_surface)
-    return cached_surface;
-
   boost::shared_ptr<const Surface> surface_to_ret =
-      loadSurfaceFromFile(short_filename);
-  image_cache_.insert(short_filename, surface_to_ret);
+      loadSurfaceThroughCaches(short_filename);
+  // Reinserting a cache hit refreshes its size, which grows once the surface
+  // has been uploaded to textures.
+  image_cache_.insert(short_filename, surface_to_ret,
+                      surface_to_ret->memoryUsage());
   return surface_to_ret;
 }
 
 // -----------------------------------------------------------------------
 
+boost::shared_ptr<const Surface> GraphicsSystem::loadSurfaceThroughCaches(
+    const std::string& short_filename) {
+  boost::shared_ptr<const Surface> surface = image_cache_.fetch(short_filename);
+  if (surface)
+    return surface;
+
+  if (image_preloader_) {
+    std::auto_ptr<DecodedImage> image = image_preloader_->take(short_filename);
+    if (image.get())
+      return surfaceFromDecodedImage(short_filename, *image);
+  }
+
+  return loadSurfaceFromFile(short_filename);
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::printCacheStatistics(std::ostream& os) const {
+  image_cache_.printStatistics(os, "Image cache");
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::prefetchImage(const std::string& short_filename) {
+  if (!image_preloader_ || image_cache_.exists(short_filename) ||
+      GetPreloadedG00(short_filename)) {
+    return;
+  }
+
+  // Looked up here rather than on the preloader thread, which mustn't touch
+  // the System.
+  boost::filesystem::path path =
+      system().findFile(short_filename, IMAGE_FILETYPES);
+  if (!path.empty())
+    image_preloader_->enqueue(short_filename, path);
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::enableImagePreloading(
+    const ImagePreloader::Decoder& decoder) {
+  image_preloader_.reset(new ImagePreloader(decoder));
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::disableImagePreloading() {
+  image_preloader_.reset();
+}
+
+// -----------------------------------------------------------------------
+
+boost::shared_ptr<const Surface> GraphicsSystem::surfaceFromDecodedImage(
+    const std::string& short_filename, DecodedImage& image) {
+  return loadSurfaceFromFile(short_filename);
+}
+
+// -----------------------------------------------------------------------
+
 /// @todo The looping constructs here totally defeat the purpose of
 ///       LazyArray, and make it a bit worse.
 void GraphicsSystem::clearAndPromoteObjects() {
@@ -847,26 +933,45 @@ void GraphicsSystem::clearAllDCs() {
 // -----------------------------------------------------------------------
 
 void GraphicsSystem::renderObjects(std::ostream* tree) {
+  GraphicsObjectImpl& impl = *graphics_object_impl_;
+  if (!impl.render_list_valid ||
+      impl.render_list_generation != GraphicsObject::renderListGeneration())
+    rebuildRenderList();
+
+  for (std::vector<GraphicsObjectImpl::RenderListEntry>::const_iterator it =
+           impl.render_list.begin(); it != impl.render_list.end(); ++it) {
+    const ObjectSettings& settings = it->settings;
+    if (settings.obj_on_off == 1 && showObject1() == false)
+      continue;
+    else if (settings.obj_on_off == 2 && showObject2() == false)
+      continue;
+    else if (settings.weather_on_off && showWeather() == false)
+      continue;
+    else if (settings.space_key && interfaceHidden())
+      continue;
+
+    it->object->render(it->obj_num, NULL, tree);
+  }
+}
+
+// -----------------------------------------------------------------------
+
+void GraphicsSystem::rebuildRenderList() {
   // The tuple is order, layer, depth, objid, GraphicsObject. Tuples are easy
   // to sort.
   typedef std::vector<boost::tuple<int, int, int, int, GraphicsObject*> >
       ToRenderVec;
   ToRenderVec to_render;
 
-  // Collate all objects that we might want to render.
+  // Collate all objects that we might want to render. Whether the player has
+  // hidden some of them is checked in renderObjects(), since that can change
+  // without touching any object.
   AllocatedLazyArrayIterator<GraphicsObject> it =
     graphics_object_impl_->foreground_objects.allocated_begin();
   AllocatedLazyArrayIterator<GraphicsObject> end =
     graphics_object_impl_->foreground_objects.allocated_end();
   for (; it != end; ++it) {
-    const ObjectSettings& settings = getObjectSettings(it.pos());
-    if (settings.obj_on_off == 1 && showObject1() == false)
-      continue;
-    else if (settings.obj_on_off == 2 && showObject2() == false)
-      continue;
-    else if (settings.weather_on_off && showWeather() == false)
-      continue;
-    else if (settings.space_key && interfaceHidden())
+    if (!it->visible() || !it->hasObjectData())
       continue;
 
     to_render.push_back(boost::make_tuple(
@@ -876,10 +981,21 @@ void GraphicsSystem::renderObjects(std::ostream* tree) {
   // Sort by all the ordering values.
   std::sort(to_render.begin(), to_render.end());
 
+  std::vector<GraphicsObjectImpl::RenderListEntry>& render_list =
+      graphics_object_impl_->render_list;
+  render_list.clear();
   for (ToRenderVec::iterator it = to_render.begin(); it != to_render.end();
        ++it) {
-    it->get<4>()->render(it->get<3>(), NULL, tree);
+    GraphicsObjectImpl::RenderListEntry entry;
+    entry.obj_num = it->get<3>();
+    entry.object = it->get<4>();
+    entry.settings = getObjectSettings(entry.obj_num);
+    render_list.push_back(entry);
   }
+
+  graphics_object_impl_->render_list_valid = true;
+  graphics_object_impl_->render_list_generation =
+      GraphicsObject::renderListGeneration();
 }
 
 // -----------------------------------------------------------------------
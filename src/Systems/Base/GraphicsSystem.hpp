@@ -43,11 +43,12 @@
 
 #include "Systems/Base/CGMTable.hpp"
 #include "Systems/Base/EventListener.hpp"
+#include "Systems/Base/ImagePreloader.hpp"
 #include "Systems/Base/Rect.hpp"
 #include "Systems/Base/ToneCurve.hpp"
 
 #include "Utilities/LazyArray.hpp"
-#include "lru_cache.hpp"
+#include "Utilities/SizedLRUCache.hpp"
 
 class ColourFilter;
 class Gameexe;
@@ -332,7 +333,9 @@ class GraphicsSystem : public EventListener {
   void refresh(std::ostream* tree);
 
   // Draws the screen (as if refresh() was called), but draw to the returned
-  // surface instead of the screen.
+  // surface instead of the screen. While skipping read text, nothing is drawn
+  // and a blank surface is returned; these snapshots only feed transition
+  // effects, which don't run while skipping.
   boost::shared_ptr<Surface> renderToSurface();
 
   // Called from the game loop; Does everything that's needed to keep
@@ -375,6 +378,9 @@ class GraphicsSystem : public EventListener {
   // rendered.
   void renderObjects(std::ostream* tree);
 
+  // Collects and sorts the foreground objects that renderObjects() draws.
+  void rebuildRenderList();
+
   // Creates rendering data for a graphics object from a G00, PDT or ANM file.
   // Does not deal with GAN files. Those are built with a separate function.
   GraphicsObjectData* buildObjOfFile(const std::string& filename);
@@ -445,6 +451,18 @@ class GraphicsSystem : public EventListener {
   void ClearAllPreloadedG00();
   boost::shared_ptr<const Surface> GetPreloadedG00(const std::string& name);
 
+  // Whether this graphics system can decode images in the background. When it
+  // can't, there's no point in looking ahead for images to prefetch.
+  bool canPrefetchImages() const { return image_preloader_.get() != NULL; }
+
+  // Starts decoding |short_filename| in the background if it names an image
+  // file that isn't already cached, so that a later getSurfaceNamed() doesn't
+  // have to wait for it.
+  void prefetchImage(const std::string& short_filename);
+
+  // Writes the image cache's size and hit rate to |os|.
+  void printCacheStatistics(std::ostream& os) const;
+
  protected:
   typedef std::set<Renderable*> FinalRenderers;
 
@@ -462,11 +480,29 @@ class GraphicsSystem : public EventListener {
 
   void drawFrame(std::ostream* tree);
 
+  // Starts the background thread for prefetchImage(). |decoder| runs on that
+  // thread; see ImagePreloader.
+  void enableImagePreloading(const ImagePreloader::Decoder& decoder);
+
+  // Stops the background thread, if any. prefetchImage() does nothing
+  // afterwards.
+  void disableImagePreloading();
+
  private:
   // Gets a platform appropriate surface loaded.
   virtual boost::shared_ptr<const Surface> loadSurfaceFromFile(
       const std::string& short_filename) = 0;
 
+  // Turns an image decoded by the ImagePreloader into a surface. Only called
+  // once enableImagePreloading() has been called.
+  virtual boost::shared_ptr<const Surface> surfaceFromDecodedImage(
+      const std::string& short_filename, DecodedImage& image);
+
+  // Returns the image cache's copy of |short_filename|, a surface made from
+  // the preloader's copy, or a freshly loaded one, in that order.
+  boost::shared_ptr<const Surface> loadSurfaceThroughCaches(
+      const std::string& short_filename);
+
   // Default grp name (used in grp* and rec* functions where filename
   // is '???')
   std::string default_grp_name_;
@@ -566,16 +602,23 @@ class GraphicsSystem : public EventListener {
   typedef LazyArray<G00ArrayItem> G00ScriptList;
   G00ScriptList preloaded_g00_;
 
-  /**
-   * LRU cache filled with the last fifteen accessed images.
-   *
-   * This cache's contents are assumed to be immutable.
-   */
-  LRUCache<std::string, boost::shared_ptr<const Surface> > image_cache_;
+  // Recently accessed images, bounded by the memory their pixels and
+  // textures use (__IMAGE_CACHE_MB in the Gameexe).
+  //
+  // This cache's contents are assumed to be immutable.
+  SizedLRUCache<std::string, boost::shared_ptr<const Surface> > image_cache_;
+
+  // Decodes the images that prefetchImage() is asked for. NULL when the
+  // subclass doesn't support decoding in the background.
+  boost::scoped_ptr<ImagePreloader> image_preloader_;
 
   // Possible background script which drives graphics to the screen.
   boost::scoped_ptr<HIKRenderer> hik_renderer_;
 
+  // Blank screen sized surface handed out by renderToSurface() while
+  // rendering is suppressed.
+  boost::shared_ptr<Surface> skipped_frame_;
+
   // boost::serialization support
   friend class boost::serialization::access;
 
@@ -0,0 +1,298 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "Systems/Base/ImageDiskCache.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libReallive/filemap.h"
+
+using boost::ends_with;
+using libReallive::Mapping;
+using libReallive::Read;
+using std::string;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const char kMagic[8] = { 'R', 'L', 'V', 'M', 'I', 'M', 'G', '1' };
+
+const char kEntryExtension[] = ".img";
+const char kTempExtension[] = ".tmp";
+
+// Pixels start on this boundary so that a mapping of the entry can be handed
+// to SSE code as is.
+const size_t kPixelAlignment = 16;
+
+// The start of every entry, followed by the source path, the region table and
+// then the pixels at |pixel_offset|. Entries are only ever read back by the
+// machine that wrote them, so everything is in native byte order.
+struct EntryHeader {
+  char magic[8];
+  boost::uint64_t source_size;
+  boost::int64_t source_mtime;
+  boost::uint32_t width;
+  boost::uint32_t height;
+  boost::uint32_t is_mask;
+  boost::uint32_t region_count;
+  boost::uint32_t path_length;
+  boost::uint32_t pixel_offset;
+};
+
+struct EntryRegion {
+  boost::int32_t x, y, width, height, origin_x, origin_y;
+};
+
+// A file in the cache directory and when it was last used.
+typedef std::pair<std::time_t, fs::path> AgedEntry;
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// ImageDiskCache
+// -----------------------------------------------------------------------
+ImageDiskCache::ImageDiskCache(const fs::path& directory, size_t max_bytes)
+    : directory_(directory),
+      max_bytes_(max_bytes),
+      total_bytes_(0),
+      next_temp_id_(0) {
+  try {
+    fs::create_directories(directory_);
+
+    std::vector<fs::path> stale_temps;
+    fs::directory_iterator end;
+    for (fs::directory_iterator it(directory_); it != end; ++it) {
+      string filename = it->path().filename().string();
+      if (ends_with(filename, kEntryExtension))
+        total_bytes_ += fs::file_size(it->path());
+      else if (ends_with(filename, kTempExtension))
+        stale_temps.push_back(it->path());
+    }
+
+    // Left behind by a run that didn't finish writing them.
+    for (std::vector<fs::path>::const_iterator it = stale_temps.begin();
+         it != stale_temps.end(); ++it) {
+      fs::remove(*it);
+    }
+  } catch (fs::filesystem_error& e) {
+    std::cerr << "Could not use image cache directory " << directory_ << ": "
+              << e.what() << std::endl;
+  }
+}
+
+ImageDiskCache::~ImageDiskCache() {}
+
+char* ImageDiskCache::load(const fs::path& source, Metadata& metadata) {
+  fs::path entry;
+  char* pixels = NULL;
+  try {
+    boost::uintmax_t source_size = fs::file_size(source);
+    std::time_t source_mtime = fs::last_write_time(source);
+    entry = entryPath(source, source_size, source_mtime);
+    if (!fs::exists(entry))
+      return NULL;
+
+    Mapping file(entry.string(), Read);
+    const char* data = file.get();
+    if (file.size() < sizeof(EntryHeader))
+      return NULL;
+
+    const EntryHeader* header = reinterpret_cast<const EntryHeader*>(data);
+    const string source_str = source.string();
+    size_t regions_offset = sizeof(EntryHeader) + header->path_length;
+    size_t pixel_bytes = static_cast<size_t>(header->width) *
+                         header->height * 4;
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->source_size != source_size ||
+        header->source_mtime != source_mtime ||
+        header->path_length != source_str.size() ||
+        header->pixel_offset < regions_offset +
+            header->region_count * sizeof(EntryRegion) ||
+        header->pixel_offset + pixel_bytes != file.size() ||
+        source_str.compare(0, string::npos, data + sizeof(EntryHeader),
+                           header->path_length) != 0) {
+      // A hash collision, an entry for another version of |source| or a
+      // file from an older rlvm.
+      return NULL;
+    }
+
+    metadata.size = Size(header->width, header->height);
+    metadata.is_mask = header->is_mask;
+    metadata.region_table.clear();
+    const EntryRegion* region =
+        reinterpret_cast<const EntryRegion*>(data + regions_offset);
+    for (size_t i = 0; i < header->region_count; ++i, ++region) {
+      Surface::GrpRect rect;
+      rect.rect = Rect::REC(region->x, region->y, region->width,
+                            region->height);
+      rect.originX = region->origin_x;
+      rect.originY = region->origin_y;
+      metadata.region_table.push_back(rect);
+    }
+
+    pixels = static_cast<char*>(malloc(pixel_bytes));
+    if (pixels)
+      memcpy(pixels, data + header->pixel_offset, pixel_bytes);
+  } catch (std::exception&) {
+    return NULL;
+  }
+
+  // Entries are evicted oldest first, so using one makes it new again.
+  try {
+    fs::last_write_time(entry, std::time(NULL));
+  } catch (fs::filesystem_error&) {
+  }
+
+  return pixels;
+}
+
+void ImageDiskCache::store(const fs::path& source, const Metadata& metadata,
+                           const char* pixels) {
+  fs::path temp;
+  try {
+    const string source_str = source.string();
+
+    EntryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.source_size = fs::file_size(source);
+    header.source_mtime = fs::last_write_time(source);
+    header.width = metadata.size.width();
+    header.height = metadata.size.height();
+    header.is_mask = metadata.is_mask;
+    header.region_count = metadata.region_table.size();
+    header.path_length = source_str.size();
+
+    size_t table_end = sizeof(EntryHeader) + source_str.size() +
+                       metadata.region_table.size() * sizeof(EntryRegion);
+    header.pixel_offset =
+        (table_end + kPixelAlignment - 1) / kPixelAlignment * kPixelAlignment;
+    size_t pixel_bytes = static_cast<size_t>(header.width) * header.height * 4;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      std::ostringstream oss;
+      oss << next_temp_id_++ << kTempExtension;
+      temp = directory_ / oss.str();
+    }
+
+    {
+      std::ofstream out(temp.string().c_str(),
+                        std::ios::out | std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(source_str.data(), source_str.size());
+      for (std::vector<Surface::GrpRect>::const_iterator it =
+               metadata.region_table.begin();
+           it != metadata.region_table.end(); ++it) {
+        EntryRegion region = { it->rect.x(), it->rect.y(), it->rect.width(),
+                               it->rect.height(), it->originX, it->originY };
+        out.write(reinterpret_cast<const char*>(&region), sizeof(region));
+      }
+      const char padding[kPixelAlignment] = { 0 };
+      out.write(padding, header.pixel_offset - table_end);
+      out.write(pixels, pixel_bytes);
+
+      if (!out) {
+        out.close();
+        fs::remove(temp);
+        return;
+      }
+    }
+
+    fs::path entry = entryPath(source, header.source_size,
+                               header.source_mtime);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    if (fs::exists(entry))
+      total_bytes_ -= std::min(total_bytes_, fs::file_size(entry));
+    fs::rename(temp, entry);
+    total_bytes_ += header.pixel_offset + pixel_bytes;
+
+    if (total_bytes_ > max_bytes_)
+      evict();
+  } catch (std::exception&) {
+    // Most likely a full disk. The image loaded fine; it just won't be
+    // cached.
+    try {
+      if (!temp.empty())
+        fs::remove(temp);
+    } catch (fs::filesystem_error&) {
+    }
+  }
+}
+
+fs::path ImageDiskCache::entryPath(const fs::path& source,
+                                   boost::uintmax_t size,
+                                   std::time_t mtime) const {
+  size_t seed = 0;
+  boost::hash_combine(seed, source.string());
+  boost::hash_combine(seed, size);
+  boost::hash_combine(seed, mtime);
+
+  std::ostringstream oss;
+  oss << std::hex << std::setw(sizeof(size_t) * 2) << std::setfill('0')
+      << seed << kEntryExtension;
+  return directory_ / oss.str();
+}
+
+void ImageDiskCache::evict() {
+  std::vector<AgedEntry> entries;
+  total_bytes_ = 0;
+  fs::directory_iterator end;
+  for (fs::directory_iterator it(directory_); it != end; ++it) {
+    if (ends_with(it->path().filename().string(), kEntryExtension)) {
+      entries.push_back(
+          AgedEntry(fs::last_write_time(it->path()), it->path()));
+      total_bytes_ += fs::file_size(it->path());
+    }
+  }
+
+  // Go down to three quarters of the budget so we aren't rescanning the
+  // directory on every store.
+  std::sort(entries.begin(), entries.end());
+  boost::uintmax_t target = max_bytes_ / 4 * 3;
+  for (std::vector<AgedEntry>::const_iterator it = entries.begin();
+       it != entries.end() && total_bytes_ > target; ++it) {
+    boost::uintmax_t size = fs::file_size(it->second);
+    fs::remove(it->second);
+    total_bytes_ -= std::min(total_bytes_, size);
+  }
+}
@@ -0,0 +1,97 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_IMAGEDISKCACHE_HPP_
+#define SRC_SYSTEMS_BASE_IMAGEDISKCACHE_HPP_
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ctime>
+#include <vector>
+
+#include "Systems/Base/Rect.hpp"
+#include "Systems/Base/Surface.hpp"
+
+// Keeps decoded images on disk so that later runs can skip GRPCONV. Each
+// entry is one file holding a small header, the region table and then the
+// RGBA pixels, aligned so they can be read straight out of a mapping.
+// Entries are keyed on the source file's path, size and modification time,
+// so an edited or patched image is simply decoded again.
+//
+// Once the files in the cache directory go over the size cap, the least
+// recently used ones are deleted. Loading and storing are safe to do from
+// the ImagePreloader's thread. Any I/O error just turns into a cache miss.
+class ImageDiskCache : public boost::noncopyable {
+ public:
+  // Everything about a decoded image other than its pixels.
+  struct Metadata {
+    Metadata() : is_mask(false) {}
+
+    Size size;
+    bool is_mask;
+    std::vector<Surface::GrpRect> region_table;
+  };
+
+  ImageDiskCache(const boost::filesystem::path& directory, size_t max_bytes);
+  ~ImageDiskCache();
+
+  // Returns a malloc()ed buffer with the decoded pixels of |source| and fills
+  // in |metadata|, or returns NULL if |source| isn't cached.
+  char* load(const boost::filesystem::path& source, Metadata& metadata);
+
+  // Saves the decoded |pixels| of |source| for next time.
+  void store(const boost::filesystem::path& source, const Metadata& metadata,
+             const char* pixels);
+
+ private:
+  // Where the entry for |source| with the given size and modification time
+  // lives.
+  boost::filesystem::path entryPath(const boost::filesystem::path& source,
+                                    boost::uintmax_t size,
+                                    std::time_t mtime) const;
+
+  // Deletes the least recently used entries until we're comfortably under
+  // |max_bytes_|. Must be called with |mutex_| held.
+  void evict();
+
+  boost::filesystem::path directory_;
+  size_t max_bytes_;
+
+  // Guards everything below.
+  boost::mutex mutex_;
+
+  // Total size of the files in |directory_|.
+  boost::uintmax_t total_bytes_;
+
+  // Used to give each in progress write its own temporary file.
+  int next_temp_id_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_IMAGEDISKCACHE_HPP_
@@ -0,0 +1,146 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "Systems/Base/ImagePreloader.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+// The most decoded images we'll hold on to waiting for their opcode to run.
+// A lookahead that guessed wrong (say, an image on a branch that wasn't
+// taken) shouldn't pin its pixels forever.
+static const size_t kMaxDecodedImages = 8;
+
+// -----------------------------------------------------------------------
+// DecodedImage
+// -----------------------------------------------------------------------
+DecodedImage::~DecodedImage() {}
+
+// -----------------------------------------------------------------------
+// ImagePreloader
+// -----------------------------------------------------------------------
+ImagePreloader::ImagePreloader(const Decoder& decoder)
+    : decoder_(decoder),
+      stopping_(false),
+      worker_(boost::bind(&ImagePreloader::workerLoop, this)) {
+}
+
+ImagePreloader::~ImagePreloader() {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+  }
+  work_available_.notify_all();
+  worker_.join();
+}
+
+void ImagePreloader::enqueue(const std::string& short_filename,
+                             const boost::filesystem::path& path) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (stopping_ || decoded_.find(short_filename) != decoded_.end() ||
+        !pending_.insert(short_filename).second) {
+      return;
+    }
+
+    queue_.push_back(std::make_pair(short_filename, path));
+  }
+  work_available_.notify_one();
+}
+
+std::auto_ptr<DecodedImage> ImagePreloader::take(
+    const std::string& short_filename) {
+  boost::mutex::scoped_lock lock(mutex_);
+
+  // Anything still in the queue is about to be loaded by the caller anyway.
+  for (std::deque<Job>::iterator it = queue_.begin(); it != queue_.end();
+       ++it) {
+    if (it->first == short_filename) {
+      queue_.erase(it);
+      pending_.erase(short_filename);
+      break;
+    }
+  }
+
+  // If the worker is decoding it right now, waiting is cheaper than doing the
+  // work twice.
+  while (pending_.count(short_filename))
+    work_finished_.wait(lock);
+
+  boost::ptr_map<std::string, DecodedImage>::iterator it =
+      decoded_.find(short_filename);
+  if (it == decoded_.end())
+    return std::auto_ptr<DecodedImage>();
+
+  decoded_order_.erase(std::find(decoded_order_.begin(), decoded_order_.end(),
+                                 short_filename));
+  return std::auto_ptr<DecodedImage>(decoded_.release(it).release());
+}
+
+void ImagePreloader::workerLoop() {
+  while (true) {
+    Job job;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!stopping_ && queue_.empty())
+        work_available_.wait(lock);
+
+      if (stopping_)
+        return;
+
+      job = queue_.front();
+      queue_.pop_front();
+    }
+
+    std::auto_ptr<DecodedImage> image;
+    try {
+      image.reset(decoder_(job.second));
+    } catch (...) {
+      // The main thread will hit the same error (and report it properly) when
+      // the opcode that wants this image runs.
+    }
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      pending_.erase(job.first);
+
+      if (image.get()) {
+        std::string name = job.first;
+        decoded_.insert(name, image);
+        decoded_order_.push_back(job.first);
+
+        if (decoded_order_.size() > kMaxDecodedImages) {
+          decoded_.erase(decoded_order_.front());
+          decoded_order_.pop_front();
+        }
+      }
+    }
+    work_finished_.notify_all();
+  }
+}
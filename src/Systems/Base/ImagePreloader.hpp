@@ -0,0 +1,108 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_IMAGEPRELOADER_HPP_
+#define SRC_SYSTEMS_BASE_IMAGEPRELOADER_HPP_
+
+#include <boost/filesystem/path.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+
+// An image file that has been decoded, but not yet turned into a Surface.
+// Each GraphicsSystem implementation subclasses this with whatever its
+// decoder produces.
+class DecodedImage {
+ public:
+  virtual ~DecodedImage();
+};
+
+// A background thread that decodes image files before the interpreter asks
+// for them. RLMachine looks ahead in the current scenario for opcodes that
+// load images and hands their file names to GraphicsSystem::prefetchImage(),
+// which queues them here.
+//
+// The decoder runs on the worker thread, so it must only read the file it is
+// given; turning the result into a Surface happens on the main thread.
+class ImagePreloader : public boost::noncopyable {
+ public:
+  typedef boost::function<DecodedImage*(const boost::filesystem::path&)>
+      Decoder;
+
+  explicit ImagePreloader(const Decoder& decoder);
+
+  // Stops the worker, waiting for any in progress decode to finish.
+  ~ImagePreloader();
+
+  // Queues |short_filename|, found at |path|, for decoding unless it is
+  // already queued or decoded.
+  void enqueue(const std::string& short_filename,
+               const boost::filesystem::path& path);
+
+  // Returns the decoded image for |short_filename|, waiting for it if it is
+  // being decoded right now. Returns NULL if it was never queued, or if
+  // decoding failed; the caller then loads it itself and reports the error.
+  std::auto_ptr<DecodedImage> take(const std::string& short_filename);
+
+ private:
+  typedef std::pair<std::string, boost::filesystem::path> Job;
+
+  // Main loop of the worker thread.
+  void workerLoop();
+
+  Decoder decoder_;
+
+  // Guards everything below.
+  boost::mutex mutex_;
+  boost::condition_variable work_available_;
+  boost::condition_variable work_finished_;
+
+  std::deque<Job> queue_;
+
+  // Names in |queue_| or being decoded right now.
+  std::set<std::string> pending_;
+
+  // Decoded images nobody has taken yet, and the order they finished in so
+  // that stale guesses can be dropped.
+  boost::ptr_map<std::string, DecodedImage> decoded_;
+  std::deque<std::string> decoded_order_;
+
+  bool stopping_;
+
+  boost::thread worker_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_IMAGEPRELOADER_HPP_
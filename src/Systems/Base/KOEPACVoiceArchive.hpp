@@ -41,6 +41,9 @@ class KOEPACVoiceArchive : public VoiceArchive {
   virtual ~KOEPACVoiceArchive();
 
   virtual boost::shared_ptr<VoiceSample> findSample(int sample_num);
+  virtual size_t memoryUsage() const {
+    return sizeof(*this) + entries_.capacity() * sizeof(Entry);
+  }
 
  private:
   void readTable(boost::filesystem::path file);
@@ -40,6 +40,9 @@ class NWKVoiceArchive : public VoiceArchive {
   virtual ~NWKVoiceArchive();
 
   virtual boost::shared_ptr<VoiceSample> findSample(int sample_num);
+  virtual size_t memoryUsage() const {
+    return sizeof(*this) + entries_.capacity() * sizeof(Entry);
+  }
 
  private:
   void readTable(boost::filesystem::path file);
@@ -41,6 +41,9 @@ class OVKVoiceArchive : public VoiceArchive {
   virtual ~OVKVoiceArchive();
 
   virtual boost::shared_ptr<VoiceSample> findSample(int sample_num);
+  virtual size_t memoryUsage() const {
+    return sizeof(*this) + entries_.capacity() * sizeof(Entry);
+  }
 
  private:
   // The file to read from
@@ -0,0 +1,703 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "Systems/Base/SoftwareCompositor.hpp"
+
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Systems/Base/GraphicsObject.hpp"
+
+using boost::int64_t;
+using boost::uint32_t;
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Where 16.16 fixed point source coordinates keep their fraction.
+const int kFixedShift = 16;
+const double kFixedOne = 65536.0;
+
+const uint32_t kOpaqueBlack = 0xFF000000u;
+
+// x / 255, rounded, for 0 <= x <= 255 * 255.
+inline int div255(int x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+inline int clampChannel(int x) {
+  return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+inline int mixChannel(int from, int to, int amount) {
+  return div255(from * (255 - amount) + to * amount);
+}
+
+// The shader's tinter(): positive values lighten towards white, negative
+// ones scale the channel by their magnitude.
+inline int tintChannel(int pixel, int tint) {
+  if (tint > 0)
+    return clampChannel(pixel + tint - div255(pixel * tint));
+  else if (tint < 0)
+    return clampChannel(div255(pixel * -tint));
+  else
+    return pixel;
+}
+
+inline void applyEffects(const CompositorEffects& effects,
+                         int& r, int& g, int& b) {
+  const RGBAColour& colour = effects.colour;
+  if (colour.a()) {
+    r = mixChannel(r, colour.r(), colour.a());
+    g = mixChannel(g, colour.g(), colour.a());
+    b = mixChannel(b, colour.b(), colour.a());
+  }
+
+  if (effects.mono) {
+    // NTSC grayscale
+    int gray = (299 * r + 587 * g + 114 * b + 500) / 1000;
+    r = mixChannel(r, gray, effects.mono);
+    g = mixChannel(g, gray, effects.mono);
+    b = mixChannel(b, gray, effects.mono);
+  }
+
+  if (effects.invert) {
+    r = mixChannel(r, 255 - r, effects.invert);
+    g = mixChannel(g, 255 - g, effects.invert);
+    b = mixChannel(b, 255 - b, effects.invert);
+  }
+
+  r = tintChannel(r, effects.light);
+  g = tintChannel(g, effects.light);
+  b = tintChannel(b, effects.light);
+
+  r = tintChannel(r, effects.tint.r());
+  g = tintChannel(g, effects.tint.g());
+  b = tintChannel(b, effects.tint.b());
+}
+
+inline void readTexel(const CompositorSource& source, int u, int v,
+                      int& r, int& g, int& b, int& a) {
+  uint32_t pixel = source.pixels[v * source.pitch + u];
+  if (source.is_mask) {
+    r = g = b = 255;
+  } else {
+    r = (pixel >> source.r_shift) & 0xFF;
+    g = (pixel >> source.g_shift) & 0xFF;
+    b = (pixel >> source.b_shift) & 0xFF;
+  }
+  a = source.has_alpha ? (pixel >> source.a_shift) & 0xFF : 255;
+}
+
+inline uint32_t packPixel(int r, int g, int b) {
+  return kOpaqueBlack | (r << 16) | (g << 8) | b;
+}
+
+// Blends (r, g, b) with coverage |a| into |dst| using RealLive's composite
+// modes: 0 is normal alpha blending, 1 is additive. The OpenGL renderer
+// leaves mode 2 unimplemented and ends up copying the source, so we do too.
+inline void blendPixel(uint32_t& dst, int r, int g, int b, int a,
+                       int composite_mode) {
+  int dr = (dst >> 16) & 0xFF;
+  int dg = (dst >> 8) & 0xFF;
+  int db = dst & 0xFF;
+  switch (composite_mode) {
+  case 0:
+    dr = mixChannel(dr, r, a);
+    dg = mixChannel(dg, g, a);
+    db = mixChannel(db, b, a);
+    break;
+  case 1:
+    dr = std::min(255, dr + div255(r * a));
+    dg = std::min(255, dg + div255(g * a));
+    db = std::min(255, db + div255(b * a));
+    break;
+  default:
+    dr = r;
+    dg = g;
+    db = b;
+    break;
+  }
+  dst = packPixel(dr, dg, db);
+}
+
+// Clips |src| to the image and moves |dst| along with it. This is
+// Texture::filterCoords() for a single texture covering all of |size|, so
+// that both renderers agree on where partially clipped draws land.
+bool clipToSource(const Size& size, Rect& src, Rect& dst) {
+  int x1 = src.x(), y1 = src.y();
+  int w1 = src.width(), h1 = src.height();
+  if (w1 <= 0 || h1 <= 0)
+    return false;
+
+  if (!(x1 + w1 >= 0 && x1 < size.width() &&
+        y1 + h1 >= 0 && y1 < size.height()))
+    return false;
+
+  int vir_x = std::max(x1, 0);
+  int vir_y = std::max(y1, 0);
+  int w = std::min(x1 + w1, size.width()) - vir_x;
+  int h = std::min(y1 + h1, size.height()) - vir_y;
+
+  float dx1 = dst.x() + dst.width() * ((vir_x - x1) / float(w1));
+  float dy1 = dst.y() + dst.height() * ((vir_y - y1) / float(h1));
+  int rounded_x1 = static_cast<int>(floor(dx1 + 0.5f));
+  int rounded_y1 = static_cast<int>(floor(dy1 + 0.5f));
+  int rounded_x2 = static_cast<int>(
+      floor(rounded_x1 + dst.width() * (w / float(w1)) + 0.5f));
+  int rounded_y2 = static_cast<int>(
+      floor(rounded_y1 + dst.height() * (h / float(h1)) + 0.5f));
+
+  src = Rect::REC(vir_x, vir_y, w, h);
+  dst = Rect::GRP(rounded_x1, rounded_y1, rounded_x2, rounded_y2);
+  return true;
+}
+
+void hashRect(std::size_t& seed, const Rect& rect) {
+  boost::hash_combine(seed, rect.x());
+  boost::hash_combine(seed, rect.y());
+  boost::hash_combine(seed, rect.width());
+  boost::hash_combine(seed, rect.height());
+}
+
+void hashColour(std::size_t& seed, const RGBAColour& colour) {
+  boost::hash_combine(seed, colour.r());
+  boost::hash_combine(seed, colour.g());
+  boost::hash_combine(seed, colour.b());
+  boost::hash_combine(seed, colour.a());
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// CompositorSource
+// -----------------------------------------------------------------------
+
+CompositorSource::CompositorSource()
+    : pixels(NULL), pitch(0), r_shift(16), g_shift(8), b_shift(0),
+      a_shift(24), has_alpha(true), is_mask(false), generation(0) {
+}
+
+// -----------------------------------------------------------------------
+// CompositorEffects
+// -----------------------------------------------------------------------
+
+CompositorEffects::CompositorEffects()
+    : colour(RGBAColour::Clear()), tint(RGBColour::Black()), light(0),
+      mono(0), invert(0) {
+}
+
+CompositorEffects::CompositorEffects(const GraphicsObject& go)
+    : colour(go.colour()), tint(go.tint()), light(go.light()),
+      mono(go.mono()), invert(go.invert()) {
+}
+
+bool CompositorEffects::isNone() const {
+  return colour.a() == 0 && tint == RGBColour::Black() && light == 0 &&
+      mono == 0 && invert == 0;
+}
+
+// -----------------------------------------------------------------------
+// SoftwareCompositor
+// -----------------------------------------------------------------------
+
+SoftwareCompositor::SoftwareCompositor(const Size& size, int threads)
+    : size_(size),
+      tiles_wide_((size.width() + kTileSize - 1) / kTileSize),
+      tiles_high_((size.height() + kTileSize - 1) / kTileSize),
+      framebuffer_(std::max(1, size.width() * size.height()), kOpaqueBlack),
+      in_frame_(false),
+      tile_commands_(tileCount()),
+      tile_hashes_(tileCount(), 0),
+      previous_hashes_(tileCount(), 0),
+      previous_valid_(false),
+      flushed_(false),
+      changed_(tileCount(), 0),
+      tiles_drawn_last_frame_(0),
+      jobs_(NULL),
+      jobs_clear_(false),
+      next_job_(0),
+      finished_jobs_(0),
+      batch_(0),
+      stopping_(false) {
+  if (threads <= 0)
+    threads = std::max(1u, boost::thread::hardware_concurrency());
+
+  for (int i = 1; i < threads; ++i) {
+    workers_.push_back(new boost::thread(
+        &SoftwareCompositor::workerLoop, this));
+  }
+}
+
+SoftwareCompositor::~SoftwareCompositor() {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopping_ = true;
+    work_available_.notify_all();
+  }
+
+  for (boost::ptr_vector<boost::thread>::iterator it = workers_.begin();
+       it != workers_.end(); ++it) {
+    it->join();
+  }
+}
+
+void SoftwareCompositor::beginFrame(const Point& origin) {
+  commands_.clear();
+  origin_ = origin;
+  flushed_ = false;
+  in_frame_ = true;
+}
+
+void SoftwareCompositor::drawImage(const CompositorSource& source,
+                                   const Rect& src, const Rect& dst,
+                                   const int opacity[4]) {
+  Command command;
+  command.kind = Command::IMAGE;
+  command.source = source;
+  std::copy(opacity, opacity + 4, command.opacity);
+  command.alpha = 255;
+  command.composite_mode =
+      std::count(opacity, opacity + 4, 255) == 4 ? 2 : 0;
+  command.filter = 0;
+  if (setUpGeometry(command, src, dst, 0, Point()))
+    record(command);
+}
+
+void SoftwareCompositor::drawObject(const CompositorSource& source,
+                                    const Rect& src, const Rect& dst,
+                                    int alpha, int composite_mode,
+                                    int rotation, const Point& rep_origin,
+                                    const CompositorEffects& effects) {
+  Command command;
+  command.kind = Command::OBJECT;
+  command.source = source;
+  std::fill(command.opacity, command.opacity + 4, 255);
+  command.alpha = alpha;
+  command.composite_mode = composite_mode;
+  command.filter = 0;
+  command.effects = effects;
+  command.effects.light = std::max(-255, std::min(255, effects.light));
+  if (setUpGeometry(command, src, dst, rotation, rep_origin))
+    record(command);
+}
+
+void SoftwareCompositor::drawColourMask(const CompositorSource& source,
+                                        const Rect& src, const Rect& dst,
+                                        const RGBAColour& colour,
+                                        int filter) {
+  Command command;
+  command.kind = Command::COLOUR_MASK;
+  command.source = source;
+  std::fill(command.opacity, command.opacity + 4, 255);
+  command.alpha = 255;
+  command.composite_mode = 0;
+  command.colour = colour;
+  command.filter = filter;
+  if (setUpGeometry(command, src, dst, 0, Point()))
+    record(command);
+}
+
+void SoftwareCompositor::filterArea(const Rect& dst,
+                                    const CompositorEffects& effects) {
+  Command command;
+  command.kind = Command::FILTER;
+  std::fill(command.opacity, command.opacity + 4, 255);
+  command.alpha = 255;
+  command.composite_mode = 0;
+  command.filter = 0;
+  command.effects = effects;
+  command.ux = command.uy = command.u0 = 0;
+  command.vx = command.vy = command.v0 = 0;
+  command.bounds = Rect(dst.origin() + Size(origin_.x(), origin_.y()),
+                        dst.size()).intersection(Rect(Point(0, 0), size_));
+  if (command.bounds.width() > 0 && command.bounds.height() > 0)
+    record(command);
+}
+
+void SoftwareCompositor::sourceChanging(const uint32_t* pixels) {
+  if (!in_frame_)
+    return;
+
+  for (std::vector<Command>::const_iterator it = commands_.begin();
+       it != commands_.end(); ++it) {
+    if (it->kind != Command::FILTER && it->source.pixels == pixels) {
+      flush();
+      return;
+    }
+  }
+}
+
+void SoftwareCompositor::endFrame() {
+  assignCommandsToTiles();
+
+  std::vector<int> tiles;
+  for (int i = 0; i < tileCount(); ++i) {
+    if (flushed_ || !previous_valid_ ||
+        tile_hashes_[i] != previous_hashes_[i])
+      tiles.push_back(i);
+  }
+
+  rasterize(tiles, !flushed_);
+  tiles_drawn_last_frame_ = tiles.size();
+
+  // A flushed frame was drawn in two passes, so its hashes don't describe
+  // what's in the framebuffer.
+  previous_hashes_.swap(tile_hashes_);
+  previous_valid_ = !flushed_;
+
+  commands_.clear();
+  in_frame_ = false;
+}
+
+void SoftwareCompositor::takeChangedTiles(std::vector<Rect>& tiles) {
+  for (int i = 0; i < tileCount(); ++i) {
+    if (changed_[i]) {
+      tiles.push_back(tileRect(i));
+      changed_[i] = 0;
+    }
+  }
+}
+
+void SoftwareCompositor::invalidate() {
+  previous_valid_ = false;
+}
+
+Rect SoftwareCompositor::tileRect(int tile) const {
+  int x = (tile % tiles_wide_) * kTileSize;
+  int y = (tile / tiles_wide_) * kTileSize;
+  return Rect::GRP(x, y, std::min(x + kTileSize, size_.width()),
+                   std::min(y + kTileSize, size_.height()));
+}
+
+bool SoftwareCompositor::setUpGeometry(Command& command, const Rect& src,
+                                       const Rect& dst, int rotation,
+                                       const Point& rep_origin) const {
+  Rect clipped_src = src;
+  Rect clipped_dst = dst;
+  if (!clipToSource(command.source.size, clipped_src, clipped_dst))
+    return false;
+
+  int width = clipped_dst.width();
+  int height = clipped_dst.height();
+  if (width == 0 || height == 0)
+    return false;
+
+  // Like the OpenGL renderer, rotate around the centre of the destination
+  // offset by the rep origin.
+  double rep_x = width / 2.0 + rep_origin.x();
+  double rep_y = height / 2.0 + rep_origin.y();
+  double centre_x = origin_.x() + clipped_dst.x() + rep_x;
+  double centre_y = origin_.y() + clipped_dst.y() + rep_y;
+
+  double angle = (rotation / 10.0) * kPi / 180.0;
+  double c = rotation ? cos(angle) : 1.0;
+  double s = rotation ? sin(angle) : 0.0;
+
+  // Screen bounds of the rotated quad.
+  double min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+  for (int corner = 0; corner < 4; ++corner) {
+    double qx = ((corner == 1 || corner == 2) ? width : 0) - rep_x;
+    double qy = (corner >= 2 ? height : 0) - rep_y;
+    double x = centre_x + c * qx - s * qy;
+    double y = centre_y + s * qx + c * qy;
+    if (corner == 0 || x < min_x) min_x = x;
+    if (corner == 0 || x > max_x) max_x = x;
+    if (corner == 0 || y < min_y) min_y = y;
+    if (corner == 0 || y > max_y) max_y = y;
+  }
+  command.bounds = Rect::GRP(
+      static_cast<int>(floor(min_x)), static_cast<int>(floor(min_y)),
+      static_cast<int>(ceil(max_x)), static_cast<int>(ceil(max_y))).
+      intersection(Rect(Point(0, 0), size_));
+  if (command.bounds.width() <= 0 || command.bounds.height() <= 0)
+    return false;
+
+  // Invert the rotation, then scale from the destination to the source.
+  double kx = clipped_src.width() / double(width);
+  double ky = clipped_src.height() / double(height);
+  command.ux = kx * c;
+  command.uy = kx * s;
+  command.u0 = clipped_src.x() + kx * (rep_x - c * centre_x - s * centre_y);
+  command.vx = -ky * s;
+  command.vy = ky * c;
+  command.v0 = clipped_src.y() + ky * (rep_y + s * centre_x - c * centre_y);
+  command.src = clipped_src;
+  return true;
+}
+
+void SoftwareCompositor::record(Command& command) {
+  std::size_t seed = 0;
+  boost::hash_combine(seed, static_cast<int>(command.kind));
+  boost::hash_combine(seed, command.source.pixels);
+  boost::hash_combine(seed, command.source.generation);
+  hashRect(seed, command.src);
+  hashRect(seed, command.bounds);
+  boost::hash_combine(seed, command.ux);
+  boost::hash_combine(seed, command.uy);
+  boost::hash_combine(seed, command.u0);
+  boost::hash_combine(seed, command.vx);
+  boost::hash_combine(seed, command.vy);
+  boost::hash_combine(seed, command.v0);
+  for (int i = 0; i < 4; ++i)
+    boost::hash_combine(seed, command.opacity[i]);
+  boost::hash_combine(seed, command.alpha);
+  boost::hash_combine(seed, command.composite_mode);
+  hashColour(seed, command.colour);
+  boost::hash_combine(seed, command.filter);
+  hashColour(seed, command.effects.colour);
+  hashColour(seed, RGBAColour(command.effects.tint));
+  boost::hash_combine(seed, command.effects.light);
+  boost::hash_combine(seed, command.effects.mono);
+  boost::hash_combine(seed, command.effects.invert);
+  command.hash = seed;
+
+  commands_.push_back(command);
+}
+
+void SoftwareCompositor::assignCommandsToTiles() {
+  for (int i = 0; i < tileCount(); ++i) {
+    tile_commands_[i].clear();
+    tile_hashes_[i] = 0;
+  }
+
+  for (std::size_t i = 0; i < commands_.size(); ++i) {
+    const Rect& bounds = commands_[i].bounds;
+    int first_column = bounds.x() / kTileSize;
+    int last_column = (bounds.x2() - 1) / kTileSize;
+    int first_row = bounds.y() / kTileSize;
+    int last_row = (bounds.y2() - 1) / kTileSize;
+    for (int row = first_row; row <= last_row; ++row) {
+      for (int column = first_column; column <= last_column; ++column) {
+        int tile = row * tiles_wide_ + column;
+        tile_commands_[tile].push_back(i);
+        boost::hash_combine(tile_hashes_[tile], commands_[i].hash);
+      }
+    }
+  }
+}
+
+void SoftwareCompositor::flush() {
+  assignCommandsToTiles();
+
+  std::vector<int> tiles;
+  for (int i = 0; i < tileCount(); ++i)
+    tiles.push_back(i);
+  rasterize(tiles, !flushed_);
+
+  commands_.clear();
+  flushed_ = true;
+}
+
+void SoftwareCompositor::rasterize(const std::vector<int>& tiles,
+                                   bool clear) {
+  for (std::vector<int>::const_iterator it = tiles.begin();
+       it != tiles.end(); ++it) {
+    changed_[*it] = 1;
+  }
+
+  if (workers_.empty() || tiles.size() < 2) {
+    for (std::vector<int>::const_iterator it = tiles.begin();
+         it != tiles.end(); ++it) {
+      rasterizeTile(*it, clear);
+    }
+    return;
+  }
+
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    jobs_ = &tiles;
+    jobs_clear_ = clear;
+    next_job_ = 0;
+    finished_jobs_ = 0;
+    ++batch_;
+    work_available_.notify_all();
+  }
+
+  runJobs();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  while (finished_jobs_ < tiles.size())
+    work_finished_.wait(lock);
+  jobs_ = NULL;
+}
+
+void SoftwareCompositor::runJobs() {
+  while (true) {
+    int tile;
+    bool clear;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (jobs_ == NULL || next_job_ >= jobs_->size())
+        return;
+      tile = (*jobs_)[next_job_++];
+      clear = jobs_clear_;
+    }
+
+    rasterizeTile(tile, clear);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    if (++finished_jobs_ == jobs_->size())
+      work_finished_.notify_all();
+  }
+}
+
+void SoftwareCompositor::workerLoop() {
+  int last_batch = 0;
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!stopping_ && batch_ == last_batch)
+        work_available_.wait(lock);
+      if (stopping_)
+        return;
+      last_batch = batch_;
+    }
+
+    runJobs();
+  }
+}
+
+void SoftwareCompositor::rasterizeTile(int tile, bool clear) {
+  Rect area = tileRect(tile);
+  if (clear) {
+    for (int y = area.y(); y < area.y2(); ++y) {
+      uint32_t* row = &framebuffer_[y * size_.width()];
+      std::fill(row + area.x(), row + area.x2(), kOpaqueBlack);
+    }
+  }
+
+  const std::vector<int>& commands = tile_commands_[tile];
+  for (std::vector<int>::const_iterator it = commands.begin();
+       it != commands.end(); ++it) {
+    const Command& command = commands_[*it];
+    drawCommand(command, area.intersection(command.bounds));
+  }
+}
+
+void SoftwareCompositor::drawCommand(const Command& command,
+                                     const Rect& area) {
+  if (area.width() <= 0 || area.height() <= 0)
+    return;
+
+  if (command.kind == Command::FILTER) {
+    for (int y = area.y(); y < area.y2(); ++y) {
+      uint32_t* dst = &framebuffer_[y * size_.width() + area.x()];
+      for (int x = area.x(); x < area.x2(); ++x, ++dst) {
+        int r = (*dst >> 16) & 0xFF;
+        int g = (*dst >> 8) & 0xFF;
+        int b = *dst & 0xFF;
+        applyEffects(command.effects, r, g, b);
+        *dst = packPixel(r, g, b);
+      }
+    }
+    return;
+  }
+
+  const CompositorSource& source = command.source;
+  const bool has_effects = command.kind == Command::OBJECT &&
+                           !command.effects.isNone();
+  const bool gradient = command.kind == Command::IMAGE &&
+      !(command.opacity[0] == command.opacity[1] &&
+        command.opacity[0] == command.opacity[2] &&
+        command.opacity[0] == command.opacity[3]);
+  const int alpha = command.kind == Command::IMAGE ? command.opacity[0] :
+                                                     command.alpha;
+
+  // Sample at pixel centres, stepping along each row in fixed point.
+  const int64_t min_u = int64_t(command.src.x()) << kFixedShift;
+  const int64_t max_u = int64_t(command.src.x2()) << kFixedShift;
+  const int64_t min_v = int64_t(command.src.y()) << kFixedShift;
+  const int64_t max_v = int64_t(command.src.y2()) << kFixedShift;
+  const int64_t du = static_cast<int64_t>(floor(command.ux * kFixedOne + 0.5));
+  const int64_t dv = static_cast<int64_t>(floor(command.vx * kFixedOne + 0.5));
+
+  for (int y = area.y(); y < area.y2(); ++y) {
+    double px = area.x() + 0.5;
+    double py = y + 0.5;
+    int64_t u = static_cast<int64_t>(floor(
+        (command.ux * px + command.uy * py + command.u0) * kFixedOne + 0.5));
+    int64_t v = static_cast<int64_t>(floor(
+        (command.vx * px + command.vy * py + command.v0) * kFixedOne + 0.5));
+
+    uint32_t* dst = &framebuffer_[y * size_.width() + area.x()];
+    for (int x = area.x(); x < area.x2(); ++x, ++dst, u += du, v += dv) {
+      if (u < min_u || u >= max_u || v < min_v || v >= max_v)
+        continue;
+
+      int r, g, b, a;
+      readTexel(source, static_cast<int>(u >> kFixedShift),
+                static_cast<int>(v >> kFixedShift), r, g, b, a);
+
+      switch (command.kind) {
+      case Command::IMAGE: {
+        int coverage = alpha;
+        if (gradient) {
+          // Fractions of the way across the source, out of 256.
+          int fx = static_cast<int>(((u - min_u) << 8) / (max_u - min_u));
+          int fy = static_cast<int>(((v - min_v) << 8) / (max_v - min_v));
+          int top = command.opacity[0] * (256 - fx) + command.opacity[1] * fx;
+          int bottom =
+              command.opacity[3] * (256 - fx) + command.opacity[2] * fx;
+          coverage = (top * (256 - fy) + bottom * fy + 32768) >> 16;
+        }
+        blendPixel(*dst, r, g, b, div255(a * coverage),
+                   command.composite_mode);
+        break;
+      }
+      case Command::OBJECT:
+        if (has_effects)
+          applyEffects(command.effects, r, g, b);
+        blendPixel(*dst, r, g, b, div255(a * alpha), command.composite_mode);
+        break;
+      case Command::COLOUR_MASK: {
+        const RGBAColour& colour = command.colour;
+        if (command.filter == 0) {
+          // Darken the screen by the mask, then add the colour back in.
+          int mask = div255(a * colour.a());
+          int dr = (*dst >> 16) & 0xFF;
+          int dg = (*dst >> 8) & 0xFF;
+          int db = *dst & 0xFF;
+          *dst = packPixel(clampChannel(dr - mask + div255(colour.r() * mask)),
+                           clampChannel(dg - mask + div255(colour.g() * mask)),
+                           clampChannel(db - mask + div255(colour.b() * mask)));
+        } else {
+          blendPixel(*dst, div255(r * colour.r()), div255(g * colour.g()),
+                     div255(b * colour.b()), div255(a * colour.a()), 0);
+        }
+        break;
+      }
+      case Command::FILTER:
+        break;
+      }
+    }
+  }
+}
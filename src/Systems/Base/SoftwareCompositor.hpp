@@ -0,0 +1,271 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_SOFTWARECOMPOSITOR_HPP_
+#define SRC_SYSTEMS_BASE_SOFTWARECOMPOSITOR_HPP_
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "Systems/Base/Colour.hpp"
+#include "Systems/Base/Rect.hpp"
+
+class GraphicsObject;
+
+// A 32 bit image that the SoftwareCompositor reads from. The compositor only
+// holds on to the pixel pointer until the end of the frame.
+struct CompositorSource {
+  CompositorSource();
+
+  const boost::uint32_t* pixels;
+
+  // Distance between rows, in pixels.
+  int pitch;
+
+  Size size;
+
+  // Where each channel lives in a pixel.
+  int r_shift, g_shift, b_shift, a_shift;
+
+  // Whether the image has an alpha channel. Images without one are opaque.
+  bool has_alpha;
+
+  // Whether only the alpha channel is meaningful. Masks are white, like the
+  // GL_ALPHA textures they are uploaded as.
+  bool is_mask;
+
+  // Must change whenever the pixels do; unchanged tiles are only skipped
+  // while every image drawn on them keeps the same generation.
+  boost::uint64_t generation;
+};
+
+// RealLive's per object colour effects, applied in the same order as the
+// object shader in Systems/SDL/Shaders.cpp.
+struct CompositorEffects {
+  CompositorEffects();
+  explicit CompositorEffects(const GraphicsObject& go);
+
+  bool isNone() const;
+
+  RGBAColour colour;
+  RGBColour tint;
+  int light;
+  int mono;
+  int invert;
+};
+
+// Composites a frame on the CPU into a single framebuffer, as an alternative
+// to drawing each object with OpenGL.
+//
+// Draws between beginFrame() and endFrame() are only recorded. endFrame()
+// splits the screen into tiles, compares the draws touching each tile with
+// the ones from the previous frame, and rasterizes just the tiles that
+// differ, spread over a pool of worker threads.
+class SoftwareCompositor : public boost::noncopyable {
+ public:
+  // Tiles are squares this many pixels on a side.
+  static const int kTileSize = 64;
+
+  // |threads| is the number of threads rasterizing tiles, including the
+  // caller's; 0 picks one per core.
+  SoftwareCompositor(const Size& size, int threads);
+  ~SoftwareCompositor();
+
+  const Size& size() const { return size_; }
+
+  // The framebuffer, as opaque 0xAARRGGBB words, size().width() per row.
+  const boost::uint32_t* pixels() const { return &framebuffer_[0]; }
+
+  // Starts recording a frame on a black screen. Every draw is offset by
+  // |origin| (used by screen shaking).
+  void beginFrame(const Point& origin);
+
+  bool inFrame() const { return in_frame_; }
+
+  // Draws |src| of |source| stretched over |dst|, fading between the
+  // |opacity| of the top left, top right, bottom right and bottom left
+  // corners. As in the OpenGL renderer, the source is copied without
+  // blending when every corner is opaque.
+  void drawImage(const CompositorSource& source, const Rect& src,
+                 const Rect& dst, const int opacity[4]);
+
+  // Draws |src| of |source| the way a GraphicsObject is drawn: stretched over
+  // |dst|, rotated by |rotation| tenths of a degree around the centre of
+  // |dst| offset by |rep_origin|, with |effects| applied and blended with
+  // |composite_mode|.
+  void drawObject(const CompositorSource& source, const Rect& src,
+                  const Rect& dst, int alpha, int composite_mode,
+                  int rotation, const Point& rep_origin,
+                  const CompositorEffects& effects);
+
+  // Draws |colour| through the alpha channel of |src| of |source|. A
+  // |filter| of 0 subtracts the mask from the screen before adding the
+  // colour (the text window backgrounds); 1 blends the colour normally.
+  void drawColourMask(const CompositorSource& source, const Rect& src,
+                      const Rect& dst, const RGBAColour& colour, int filter);
+
+  // Applies |effects| to what is already on the screen in |dst|.
+  void filterArea(const Rect& dst, const CompositorEffects& effects);
+
+  // Must be called before the pixels behind a source drawn this frame are
+  // freed or rewritten. Draws recorded so far are rasterized immediately.
+  void sourceChanging(const boost::uint32_t* pixels);
+
+  // Rasterizes the recorded frame into the framebuffer.
+  void endFrame();
+
+  // Appends the area of each tile that changed since the last call.
+  void takeChangedTiles(std::vector<Rect>& tiles);
+
+  // Forgets the previous frame, so the next one is rasterized (and reported
+  // as changed) in full.
+  void invalidate();
+
+  // How many tiles the last endFrame() rasterized.
+  int tilesDrawnLastFrame() const { return tiles_drawn_last_frame_; }
+
+ private:
+  // A recorded draw.
+  struct Command {
+    enum Kind { IMAGE, OBJECT, COLOUR_MASK, FILTER };
+
+    Kind kind;
+    CompositorSource source;
+
+    // The part of |source| being drawn, clipped to the image.
+    Rect src;
+
+    // The part of the screen the draw can touch.
+    Rect bounds;
+
+    // Maps a point on the screen to a point in |source|:
+    //   u = ux * x + uy * y + u0, v = vx * x + vy * y + v0
+    double ux, uy, u0;
+    double vx, vy, v0;
+
+    // Corner alphas for IMAGE, in the same order as drawImage().
+    int opacity[4];
+
+    // Overall alpha for OBJECT, and the blend mode for IMAGE and OBJECT.
+    int alpha;
+    int composite_mode;
+
+    // Colour and filter for COLOUR_MASK.
+    RGBAColour colour;
+    int filter;
+
+    // Effects for OBJECT and FILTER.
+    CompositorEffects effects;
+
+    std::size_t hash;
+  };
+
+  int tileCount() const { return tiles_wide_ * tiles_high_; }
+  Rect tileRect(int tile) const;
+
+  // Clips |src| to |command|'s source, moving |dst| along with it, and
+  // works out the mapping from the screen back to the source and the
+  // screen bounds. Returns false if nothing would be drawn.
+  bool setUpGeometry(Command& command, const Rect& src, const Rect& dst,
+                     int rotation, const Point& rep_origin) const;
+
+  // Hashes |command| and adds it to this frame.
+  void record(Command& command);
+
+  // Fills |tile_commands_| and |tile_hashes_| from |commands_|.
+  void assignCommandsToTiles();
+
+  // Rasterizes everything recorded so far over the whole screen.
+  void flush();
+
+  // Rasterizes |tiles| using every thread, clearing them first if |clear|.
+  void rasterize(const std::vector<int>& tiles, bool clear);
+
+  // Rasterizes one tile. Safe to call from several threads at once on
+  // different tiles.
+  void rasterizeTile(int tile, bool clear);
+
+  // Draws the part of |command| inside |area|.
+  void drawCommand(const Command& command, const Rect& area);
+
+  // Hands out the tiles in |jobs_| until there are none left.
+  void runJobs();
+
+  // Loop for each thread in |workers_|.
+  void workerLoop();
+
+  Size size_;
+  int tiles_wide_, tiles_high_;
+  std::vector<boost::uint32_t> framebuffer_;
+
+  bool in_frame_;
+  Point origin_;
+  std::vector<Command> commands_;
+
+  // Which commands touch each tile, and a hash of those commands.
+  std::vector<std::vector<int> > tile_commands_;
+  std::vector<std::size_t> tile_hashes_;
+
+  // Hashes of the previous frame, valid if |previous_valid_|.
+  std::vector<std::size_t> previous_hashes_;
+  bool previous_valid_;
+
+  // Set when sourceChanging() rasterized part of the current frame early.
+  bool flushed_;
+
+  // Tiles rasterized since the last takeChangedTiles().
+  std::vector<char> changed_;
+
+  int tiles_drawn_last_frame_;
+
+  // Guards everything below.
+  boost::mutex mutex_;
+  boost::condition_variable work_available_;
+  boost::condition_variable work_finished_;
+
+  // The tiles being rasterized, and how many have been handed out and
+  // finished.
+  const std::vector<int>* jobs_;
+  bool jobs_clear_;
+  std::size_t next_job_;
+  std::size_t finished_jobs_;
+
+  // Bumped for each batch of jobs so sleeping workers notice new work.
+  int batch_;
+  bool stopping_;
+
+  boost::ptr_vector<boost::thread> workers_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_SOFTWARECOMPOSITOR_HPP_
@@ -115,6 +115,11 @@ SoundSystem::SoundSystem(System& system)
 
   std::fill_n(channel_volume_, NUM_TOTAL_CHANNELS, 255);
 
+  int voice_cache_mb = gexe("__VOICE_CACHE_MB").to_int(0);
+  if (voice_cache_mb > 0)
+    voice_cache_.setMemoryBudget(
+        static_cast<size_t>(voice_cache_mb) * 1024 * 1024);
+
   // Read the \#SE.xxx entries from the Gameexe
   GameexeFilteringIterator se = gexe.filtering_begin("SE.");
   GameexeFilteringIterator end = gexe.filtering_end();
@@ -429,6 +434,10 @@ void SoundSystem::reset() {
   // empty
 }
 
+void SoundSystem::printCacheStatistics(std::ostream& os) const {
+  voice_cache_.printStatistics(os);
+}
+
 // static
 void SoundSystem::checkChannel(int channel, const char* function_name) {
   if (channel < 0 || channel > NUM_TOTAL_CHANNELS) {
@@ -33,6 +33,7 @@
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/version.hpp>
+#include <iosfwd>
 #include <map>
 #include <string>
 
@@ -359,6 +360,9 @@ class SoundSystem {
 
   virtual void reset();
 
+  // Writes the size and hit rate of the sound caches to |os|.
+  virtual void printCacheStatistics(std::ostream& os) const;
+
   System& system() { return system_; }
 
  protected:
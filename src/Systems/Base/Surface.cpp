@@ -45,6 +45,13 @@ Rect Surface::rect() const {
 
 // -----------------------------------------------------------------------
 
+size_t Surface::memoryUsage() const {
+  Size s = size();
+  return static_cast<size_t>(s.width()) * s.height() * 4;
+}
+
+// -----------------------------------------------------------------------
+
 void Surface::dump() {
   throw rlvm::Exception("Unimplemented function Surface::dump()");
 }
@@ -85,6 +85,10 @@ class Surface : public boost::enable_shared_from_this<Surface> {
   virtual Size size() const = 0;
   Rect rect() const;
 
+  // Estimated bytes of system and video memory this surface holds. Used to
+  // budget the image cache.
+  virtual size_t memoryUsage() const;
+
   virtual void dump();
 
   /// Blits to another surface
@@ -84,8 +84,8 @@ void TextTextPageElement::replayElement(TextPage& page, bool is_active_page) {
   // Sometimes there are empty TextTextPageElements. I hypothesize these happen
   // because of empty strings which just set the speaker's name.
   if (list_of_chars_to_print_.size()) {
-    printTextToFunction(bind(&TextPage::CharacterImpl, ref(page), _1, _2),
-                        list_of_chars_to_print_, "");
+    page.CharactersImpl(list_of_chars_to_print_, 0,
+                        list_of_chars_to_print_.size());
   }
 }
 
@@ -179,6 +179,26 @@ bool TextPage::character(const string& current, const string& rest) {
   return rendered;
 }
 
+string::size_type TextPage::characters(const string& text,
+                                       string::size_type begin,
+                                       string::size_type end) {
+  string::size_type printed = CharactersImpl(text, begin, end);
+
+  if (printed != begin) {
+    if (elements_to_replay_.size() == 0 ||
+        !elements_to_replay_.back().isTextElement())
+      elements_to_replay_.push_back(new TextTextPageElement);
+
+    dynamic_cast<TextTextPageElement&>(elements_to_replay_.back()).
+      append(text.substr(begin, printed - begin));
+
+    number_of_chars_on_page_ +=
+        utf8::distance(text.begin() + begin, text.begin() + printed);
+  }
+
+  return printed;
+}
+
 void TextPage::name(const string& name, const string& next_char) {
   addAction(bind(&TextPage::NameImpl, _1, name, next_char, _2));
   number_of_chars_on_page_++;
@@ -264,6 +284,12 @@ bool TextPage::CharacterImpl(const string& c, const string& rest) {
   return system_->text().textWindow(window_num_)->character(c, rest);
 }
 
+string::size_type TextPage::CharactersImpl(const string& text,
+                                           string::size_type begin,
+                                           string::size_type end) {
+  return system_->text().textWindow(window_num_)->characters(text, begin, end);
+}
+
 void TextPage::NameImpl(const string& name,
                         const string& next_char,
                         bool is_active_page) {
@@ -67,6 +67,13 @@ class TextPage : public boost::noncopyable {
   // spacing rules.
   bool character(const std::string& current, const std::string& rest);
 
+  // Like character(), but for the whole run of |text| between byte offsets
+  // |begin| and |end|. Stops when the window fills up and returns the offset
+  // of the first character that wasn't displayed.
+  std::string::size_type characters(const std::string& text,
+                                    std::string::size_type begin,
+                                    std::string::size_type end);
+
   // Displays a name. This function will be called by the
   // TextoutLongOperation.
   void name(const std::string& name, const std::string& next_char);
@@ -137,6 +144,9 @@ class TextPage : public boost::noncopyable {
   // Private implementations; These methods are what actually does things. They
   // output to the screen, etc.
   bool CharacterImpl(const std::string& c, const std::string& rest);
+  std::string::size_type CharactersImpl(const std::string& text,
+                                        std::string::size_type begin,
+                                        std::string::size_type end);
   void NameImpl(const std::string& name, const std::string& next_char,
                 bool is_active_page);
   void KoeMarkerImpl(int id, bool is_active_page);
@@ -112,6 +112,7 @@ TextSystem::TextSystem(System& system, Gameexe& gexe)
       skip_mode_(false),
       kidoku_read_(false),
       in_selection_mode_(false),
+      has_deferred_text_(false),
       system_(system) {
   GameexeInterpretObject ctrl_use(gexe("CTRL_USE"));
   if (ctrl_use.exists())
@@ -643,6 +644,20 @@ boost::shared_ptr<Surface> TextSystem::renderText(
   return surface;
 }
 
+int TextSystem::charWidths(int size, const std::string& utf8str,
+                           std::vector<int>& widths) {
+  int total = 0;
+  string::const_iterator it = utf8str.begin();
+  string::const_iterator strend = utf8str.end();
+  while (it != strend) {
+    int w = charWidth(size, utf8::next(it, strend));
+    widths.push_back(w);
+    total += w;
+  }
+
+  return total;
+}
+
 void TextSystem::reset() {
   is_reading_backlog_ = false;
   script_message_no_wait_ = false;
@@ -659,6 +674,7 @@ void TextSystem::reset() {
   in_selection_mode_ = false;
   kidoku_read_ = false;
   skip_mode_ = false;
+  has_deferred_text_ = false;
 }
 
 void TextSystem::setKidokuRead(const int in) {
@@ -674,6 +690,8 @@ void TextSystem::setKidokuRead(const int in) {
     // Auto leave skip mode when we stop reading previously read text.
     setSkipMode(false);
   }
+
+  drawDeferredText();
 }
 
 void TextSystem::setSkipMode(int in) {
@@ -686,6 +704,21 @@ void TextSystem::setSkipMode(int in) {
         Source<TextSystem>(this),
         Details<int>(&in));
   }
+
+  drawDeferredText();
+}
+
+void TextSystem::setInSelectionMode(const bool in) {
+  in_selection_mode_ = in;
+  drawDeferredText();
+}
+
+void TextSystem::drawDeferredText() {
+  if (has_deferred_text_ && !renderingSuppressed()) {
+    has_deferred_text_ = false;
+    clearAllTextWindows();
+    replayPageSet(*current_pageset_, true);
+  }
 }
 
 template<class Archive>
@@ -715,28 +748,41 @@ template void TextSystem::load<boost::archive::text_iarchive>(
 
 // -----------------------------------------------------------------------
 
+static const char LOWER_BYTE_FULLWIDTH_ASTERISK = 0x96;
+static const char LOWER_BYTE_FULLWIDTH_PERCENT = 0x93;
+
+// Whether |cur| starts a name variable placeholder.
+static bool isNameReference(const char* cur) {
+  return cur[0] == 0x81 && (cur[1] == LOWER_BYTE_FULLWIDTH_ASTERISK ||
+                            cur[1] == LOWER_BYTE_FULLWIDTH_PERCENT);
+}
+
+// Consumes the name variable placeholder at |cur|, storing which kind of
+// name it refers to in |type| and the name slot in |index|.
+static void readNameReference(const char*& cur, char& type, int& index) {
+  type = cur[1];
+  cur += 2;
+
+  string strindex;
+  if (readFullwidthLatinLetter(cur, strindex)) {
+    // Try to read a second character. We don't care if it fails.
+    readFullwidthLatinLetter(cur, strindex);
+  } else {
+    throw rlvm::Exception("Malformed name construct in bytecode!");
+  }
+
+  index = Memory::ConvertLetterIndexToInt(strindex);
+}
+
 void parseNames(const Memory& memory, const std::string& input,
                 std::string& output) {
   const char* cur = input.c_str();
 
-  const char LOWER_BYTE_FULLWIDTH_ASTERISK = 0x96;
-  const char LOWER_BYTE_FULLWIDTH_PERCENT = 0x93;
-
   while (*cur) {
-    if (cur[0] == 0x81 && (cur[1] == LOWER_BYTE_FULLWIDTH_ASTERISK ||
-                           cur[1] == LOWER_BYTE_FULLWIDTH_PERCENT)) {
-      char type = cur[1];
-      cur += 2;
-
-      string strindex;
-      if (readFullwidthLatinLetter(cur, strindex)) {
-        // Try to read a second character. We don't care if it fails.
-        readFullwidthLatinLetter(cur, strindex);
-      } else {
-        throw rlvm::Exception("Malformed name construct in bytecode!");
-      }
-
-      int index = Memory::ConvertLetterIndexToInt(strindex);
+    if (isNameReference(cur)) {
+      char type;
+      int index;
+      readNameReference(cur, type, index);
       if (type == LOWER_BYTE_FULLWIDTH_ASTERISK)
         output += memory.getName(index);
       else
@@ -747,10 +793,84 @@ void parseNames(const Memory& memory, const std::string& input,
   }
 }
 
+// -----------------------------------------------------------------------
+// ParsedTextout
+// -----------------------------------------------------------------------
+ParsedTextout::ParsedTextout(const std::string& cp932str, int encoding)
+    : encoding_(encoding) {
+  bool has_names = false;
+  try {
+    string literal;
+    const char* cur = cp932str.c_str();
+    while (*cur) {
+      if (isNameReference(cur)) {
+        Piece name;
+        readNameReference(cur, name.name_type, name.name_index);
+
+        if (!literal.empty()) {
+          pieces_.push_back(Piece());
+          pieces_.back().utf8 = cp932toUTF8(literal, encoding);
+          literal.clear();
+        }
+        pieces_.push_back(name);
+        has_names = true;
+      } else {
+        copyOneShiftJisCharacter(cur, literal);
+      }
+    }
+
+    if (!literal.empty()) {
+      pieces_.push_back(Piece());
+      pieces_.back().utf8 = cp932toUTF8(literal, encoding);
+    }
+  } catch(rlvm::Exception& e) {
+    // WEIRD: Sometimes rldev (and the official compiler?) will generate strings
+    // that aren't valid shift_jis. Fall back while I figure out how to handle
+    // this.
+    pieces_.assign(1, Piece());
+    pieces_.back().utf8 = cp932toUTF8(cp932str, encoding);
+    has_names = false;
+  }
+
+  if (has_names)
+    cp932_ = cp932str;
+}
+
+std::string ParsedTextout::render(const Memory& memory) const {
+  if (pieces_.empty())
+    return string();
+  if (pieces_.size() == 1 && pieces_[0].name_type == 0)
+    return pieces_[0].utf8;
+
+  string out;
+  try {
+    for (vector<Piece>::const_iterator it = pieces_.begin();
+         it != pieces_.end(); ++it) {
+      if (it->name_type == 0) {
+        out += it->utf8;
+      } else if (it->name_type == LOWER_BYTE_FULLWIDTH_ASTERISK) {
+        out += cp932toUTF8(memory.getName(it->name_index), encoding_);
+      } else {
+        out += cp932toUTF8(memory.getLocalName(it->name_index), encoding_);
+      }
+    }
+  } catch(rlvm::Exception& e) {
+    // An out of range name slot; show the placeholder as is.
+    return cp932toUTF8(cp932_, encoding_);
+  }
+
+  return out;
+}
+
 bool TextSystem::currentlySkipping() const {
   return kidoku_read_ && skipMode();
 }
 
+bool TextSystem::renderingSuppressed() const {
+  // Selections need to be seen and the backlog is only ever looked at.
+  return currentlySkipping() && !in_selection_mode_ && !is_reading_backlog_;
+}
+
 bool RestoreTextSystemVisibility::operator()(RLMachine& machine) {
   machine.system().text().setSystemVisible(true);
   return true;
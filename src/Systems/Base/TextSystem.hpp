@@ -38,6 +38,7 @@
 #include <boost/serialization/version.hpp>
 #include <boost/shared_ptr.hpp>
 #include <stdint.h>
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include <map>
@@ -236,6 +237,15 @@ class TextSystem : public EventListener {
 
   virtual int charWidth(int size, uint16_t codepoint) = 0;
 
+  // Appends the advance width of each character in |utf8str| at |size| to
+  // |widths| and returns their sum. Laying out a whole line this way lets
+  // subclasses look up the font once instead of once per character.
+  virtual int charWidths(int size, const std::string& utf8str,
+                         std::vector<int>& widths);
+
+  // Writes the size and hit rate of any glyph caches to |os|.
+  virtual void printCacheStatistics(std::ostream& os) const {}
+
   TextSystemGlobals& globals() { return globals_; }
 
   // Resets non-configuration values (so we can load games).
@@ -249,7 +259,17 @@ class TextSystem : public EventListener {
 
   bool currentlySkipping() const;
 
-  void setInSelectionMode(const bool in) { in_selection_mode_ = in; }
+  // Whether we're skipping through previously read text and shouldn't draw
+  // anything. Opcodes still run, but the screen, transition effects and text
+  // glyphs are left alone until we hit unread text or a selection, when the
+  // pages laid out in the meantime are drawn in one go.
+  bool renderingSuppressed() const;
+
+  // Called by text windows that laid out a character without drawing it
+  // because renderingSuppressed() was true.
+  void setHasDeferredText() { has_deferred_text_ = true; }
+
+  void setInSelectionMode(const bool in);
 
   // Overriden from EventListener
   virtual bool mouseButtonStateChanged(MouseButton mouse_button, bool pressed);
@@ -329,6 +349,10 @@ class TextSystem : public EventListener {
   // Whether we are currently paused at a user choice.
   bool in_selection_mode_;
 
+  // Whether the current page set has characters that were laid out but not
+  // drawn while rendering was suppressed.
+  bool has_deferred_text_;
+
   // Contains overrides for showing or hiding the text windows.
   std::map<int, bool> window_visual_override_;
 
@@ -336,6 +360,10 @@ class TextSystem : public EventListener {
   // manageable constant number.
   void expireOldPages();
 
+  // Redraws the current page set if text was deferred while rendering was
+  // suppressed and we've since stopped skipping.
+  void drawDeferredText();
+
   // Our parent system object.
   System& system_;
 
@@ -363,6 +391,38 @@ class TextSystem : public EventListener {
 void parseNames(const Memory& memory, const std::string& input,
                 std::string& output);
 
+// A textout string converted to UTF-8 once, with its name variable
+// placeholders kept to one side. Showing it again only means splicing in
+// the current names instead of parsing and converting the whole string.
+class ParsedTextout {
+ public:
+  ParsedTextout(const std::string& cp932str, int encoding);
+
+  // The text encoding this was converted with.
+  int encoding() const { return encoding_; }
+
+  // Returns the UTF-8 text with the names from |memory| filled in.
+  std::string render(const Memory& memory) const;
+
+ private:
+  // Either a run of converted text, or (when |name_type| is non-zero) a name
+  // placeholder.
+  struct Piece {
+    Piece() : name_type(0), name_index(0) {}
+    std::string utf8;
+    char name_type;
+    int name_index;
+  };
+
+  std::vector<Piece> pieces_;
+
+  // The original text, kept only when it has names in it so render() can
+  // fall back to it the same way parseNames() callers do.
+  std::string cp932_;
+
+  int encoding_;
+};
+
 // LongOperation which just calls text().setSystemVisible(true) and removes
 // itself from the callstack.
 struct RestoreTextSystemVisibility : public LongOperation {
@@ -505,6 +505,50 @@ void TextWindow::clearWin() {
 
 bool TextWindow::character(const std::string& current,
                            const std::string& rest) {
+  int char_width = current.empty() ?
+      0 : text_system_.charWidth(fontSizeInPixels(), codepoint(current));
+  if (!displayCharacter(current, char_width, rest.begin(), rest.end()))
+    return false;
+
+  // When we aren't rendering a piece of text with a ruby gloss, mark
+  // the screen as dirty so that this character renders.
+  if (ruby_begin_point_ == -1) {
+    system_.graphics().markScreenAsDirty(GUT_TEXTSYS);
+  }
+
+  return true;
+}
+
+std::string::size_type TextWindow::characters(const std::string& text,
+                                              std::string::size_type begin,
+                                              std::string::size_type end) {
+  string::const_iterator it = text.begin() + begin;
+  string::const_iterator run_end = text.begin() + end;
+
+  // Measure the run in one go so the font is looked up once.
+  vector<int> widths;
+  text_system_.charWidths(fontSizeInPixels(), string(it, run_end), widths);
+
+  for (vector<int>::const_iterator width = widths.begin(); it != run_end;
+       ++width) {
+    string::const_iterator next = it;
+    utf8::next(next, run_end);
+    if (!displayCharacter(string(it, next), *width, next, text.end()))
+      break;
+
+    it = next;
+  }
+
+  if (it != text.begin() + begin && ruby_begin_point_ == -1)
+    system_.graphics().markScreenAsDirty(GUT_TEXTSYS);
+
+  return it - text.begin();
+}
+
+bool TextWindow::displayCharacter(const std::string& current,
+                                  int char_width,
+                                  std::string::const_iterator rest,
+                                  std::string::const_iterator rest_end) {
   // If this text page is already full, save some time and reject
   // early.
   if (isFull())
@@ -544,18 +588,24 @@ bool TextWindow::character(const std::string& current,
 
     // If the width of this glyph plus the spacing will put us over the
     // edge of the window, then line increment.
-    if (mustLineBreak(cur_codepoint, rest)) {
+    if (mustLineBreak(cur_codepoint, char_width, rest, rest_end)) {
       hardBrake();
 
       if (isFull())
         return false;
     }
 
-    RGBColour shadow = RGBAColour::Black().rgb();
-    text_system_.renderGlyphOnto(
-        current, fontSizeInPixels(), font_colour_, &shadow,
-        text_insertion_point_x_, text_insertion_point_y_,
-        textSurface());
+    // While skipping read text we only lay out the page; the TextSystem
+    // replays it onto the window once skipping stops.
+    if (text_system_.renderingSuppressed()) {
+      text_system_.setHasDeferredText();
+    } else {
+      RGBColour shadow = RGBAColour::Black().rgb();
+      text_system_.renderGlyphOnto(
+          current, fontSizeInPixels(), font_colour_, &shadow,
+          text_insertion_point_x_, text_insertion_point_y_,
+          textSurface());
+    }
 
     // Move the insertion point forward one character
     text_insertion_point_x_ += font_size_in_pixels_ + x_spacing_;
@@ -564,19 +614,14 @@ bool TextWindow::character(const std::string& current,
       setIndentation();
   }
 
-  // When we aren't rendering a piece of text with a ruby gloss, mark
-  // the screen as dirty so that this character renders.
-  if (ruby_begin_point_ == -1) {
-    system_.graphics().markScreenAsDirty(GUT_TEXTSYS);
-  }
-
   last_token_was_name_ = false;
 
   return true;
 }
 
-bool TextWindow::mustLineBreak(int cur_codepoint, const std::string& rest) {
-  int char_width = system().text().charWidth(fontSizeInPixels(), cur_codepoint);
+bool TextWindow::mustLineBreak(int cur_codepoint, int char_width,
+                               std::string::const_iterator rest,
+                               std::string::const_iterator rest_end) {
   bool cur_codepoint_is_kinsoku = isKinsoku(cur_codepoint);
   int normal_width =
       x_window_size_in_chars_ * (default_font_size_in_pixels_ + x_spacing_);
@@ -596,13 +641,12 @@ bool TextWindow::mustLineBreak(int cur_codepoint, const std::string& rest) {
 
   // If this character will fit on the line, but the next n characters are
   // kinsoku characters and one of them won't, then break.
-  if (!cur_codepoint_is_kinsoku && rest != "") {
+  if (!cur_codepoint_is_kinsoku && rest != rest_end) {
     int final_insertion_x = text_insertion_point_x_ + char_width + x_spacing_;
 
-    string::const_iterator cur = rest.begin();
-    string::const_iterator end = rest.end();
-    while (cur != end) {
-      int point = utf8::next(cur, end);
+    string::const_iterator cur = rest;
+    while (cur != rest_end) {
+      int point = utf8::next(cur, rest_end);
       if (isKinsoku(point)) {
         final_insertion_x += char_width + x_spacing_;
 
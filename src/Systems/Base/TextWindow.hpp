@@ -219,9 +219,21 @@ class TextWindow {
   // does not and was not displayed.
   virtual bool character(const std::string& current, const std::string& rest);
 
-  // Checks to make sure that not only will |cur_codepoint| fit on the line,
-  // but also that we'll perform kinsoku rules correctly.
-  bool mustLineBreak(int cur_codepoint, const std::string& rest);
+  // Displays the characters in |text| from byte offset |begin| up to |end|
+  // until the window fills up, marking the screen dirty once instead of after
+  // every character. Line breaking can look past |end| into the rest of
+  // |text|. Returns the offset of the first character that wasn't displayed.
+  virtual std::string::size_type characters(const std::string& text,
+                                            std::string::size_type begin,
+                                            std::string::size_type end);
+
+  // Checks to make sure that not only will |cur_codepoint|, which is
+  // |char_width| pixels wide, fit on the line, but also that we'll perform
+  // kinsoku rules correctly. [|rest|, |rest_end|) is the text after
+  // |cur_codepoint|.
+  bool mustLineBreak(int cur_codepoint, int char_width,
+                     std::string::const_iterator rest,
+                     std::string::const_iterator rest_end);
 
   // Returns whether another character can be placed on the screen.
   bool isFull() const;
@@ -270,6 +282,13 @@ class TextWindow {
 
   void renderKoeReplayButtons(std::ostream* tree);
 
+  // Shared implementation of character() and characters(). |char_width| is
+  // the advance width of |current|, which characters() measures for the
+  // whole run at once. Doesn't mark the screen as dirty.
+  virtual bool displayCharacter(const std::string& current, int char_width,
+                        std::string::const_iterator rest,
+                        std::string::const_iterator rest_end);
+
  protected:
   // We cache the size of the screen so we don't need the machine in
   // some accessors.
@@ -59,6 +59,9 @@ class VoiceArchive : public boost::enable_shared_from_this<VoiceArchive> {
 
   virtual boost::shared_ptr<VoiceSample> findSample(int sample_num) = 0;
 
+  // Bytes of memory this archive's index uses. VoiceCache is budgeted by it.
+  virtual size_t memoryUsage() const = 0;
+
  protected:
   // A sortable list with metadata pointing into an archive.
   struct Entry {
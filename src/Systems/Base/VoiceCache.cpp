@@ -43,6 +43,10 @@
 
 const int ID_RADIX = 100000;
 
+// Default budget for archive indexes. An archive's index costs 12 bytes per
+// sample, so this holds far more than the handful of archives a scene uses.
+const int DEFAULT_VOICE_CACHE_MB = 1;
+
 using boost::iends_with;
 using boost::shared_ptr;
 using std::string;
@@ -51,7 +55,7 @@ namespace fs = boost::filesystem;
 
 VoiceCache::VoiceCache(SoundSystem& sound_system)
     : sound_system_(sound_system),
-      file_cache_(7) {
+      file_cache_(DEFAULT_VOICE_CACHE_MB * 1024 * 1024) {
 }
 
 VoiceCache::~VoiceCache() {
@@ -68,7 +72,7 @@ boost::shared_ptr<VoiceSample> VoiceCache::find(int id) {
     archive = findArchive(file_no);
     if (archive) {
       // Cache for later use.
-      file_cache_.insert(file_no, archive);
+      file_cache_.insert(file_no, archive, archive->memoryUsage());
       return archive->findSample(index);
     } else {
       // There aren't any archives with |file_no|. Look for an individual file
@@ -83,6 +87,14 @@ boost::shared_ptr<VoiceSample> VoiceCache::find(int id) {
   }
 }
 
+void VoiceCache::setMemoryBudget(size_t bytes) {
+  file_cache_.set_max_bytes(bytes);
+}
+
+void VoiceCache::printStatistics(std::ostream& os) const {
+  file_cache_.printStatistics(os, "Voice archive cache");
+}
+
 shared_ptr<VoiceArchive> VoiceCache::findArchive(int file_no) const {
   std::ostringstream oss;
   oss << "z" << std::setw(4) << std::setfill('0') << file_no;
@@ -27,9 +27,10 @@
 #ifndef SRC_SYSTEMS_BASE_VOICECACHE_HPP_
 #define SRC_SYSTEMS_BASE_VOICECACHE_HPP_
 
-#include "lru_cache.hpp"
-
 #include <boost/shared_ptr.hpp>
+#include <iosfwd>
+
+#include "Utilities/SizedLRUCache.hpp"
 
 class SoundSystem;
 class VoiceArchive;
@@ -45,6 +46,12 @@ class VoiceCache {
 
   boost::shared_ptr<VoiceSample> find(int id);
 
+  // Bounds the memory used by cached archive indexes. Defaults to 1MB.
+  void setMemoryBudget(size_t bytes);
+
+  // Writes the archive cache's size and hit rate to |os|.
+  void printStatistics(std::ostream& os) const;
+
  private:
   // Searches for a file archive of voices.
   boost::shared_ptr<VoiceArchive> findArchive(int file_no) const;
@@ -55,8 +62,9 @@ class VoiceCache {
 
   SoundSystem& sound_system_;
 
-  /// A mapping between a file id number and the underlying file object.
-  LRUCache<int, boost::shared_ptr<VoiceArchive> > file_cache_;
+  /// A mapping between a file id number and the underlying file object,
+  /// bounded by the memory the archives' indexes use.
+  SizedLRUCache<int, boost::shared_ptr<VoiceArchive> > file_cache_;
 };  // class VoiceCache
 
 #endif  // SRC_SYSTEMS_BASE_VOICECACHE_HPP_
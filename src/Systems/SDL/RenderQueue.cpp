@@ -0,0 +1,274 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2013 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "GL/glew.h"
+
+#include "Systems/SDL/RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "Systems/Base/GraphicsObject.hpp"
+#include "Systems/SDL/SDLUtils.hpp"
+#include "Systems/SDL/Shaders.hpp"
+
+namespace {
+
+void setBlendFunc(RenderQueue::BlendMode blend) {
+  switch (blend) {
+  case RenderQueue::BLEND_COPY:
+    glBlendFunc(GL_ONE, GL_ZERO);
+    break;
+  case RenderQueue::BLEND_ALPHA:
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    break;
+  case RenderQueue::BLEND_ADDITIVE:
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    break;
+  }
+}
+
+void setTexCoordArray(GLenum unit, GLint size, const char* base,
+                      size_t offset) {
+  if (GLEW_ARB_multitexture)
+    glClientActiveTextureARB(unit);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(size, GL_FLOAT, sizeof(RenderQueue::Vertex),
+                    base + offset);
+}
+
+void clearTexCoordArray(GLenum unit) {
+  if (GLEW_ARB_multitexture)
+    glClientActiveTextureARB(unit);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+}  // namespace
+
+std::vector<RenderQueue::Quad> RenderQueue::queued_quads_;
+std::vector<RenderQueue::Vertex> RenderQueue::queued_vertices_;
+std::vector<RenderQueue::Batch> RenderQueue::batches_;
+size_t RenderQueue::batch_count_ = 0;
+std::vector<RenderQueue::Vertex> RenderQueue::batched_vertices_;
+GLuint RenderQueue::vertex_buffer_ = 0;
+
+// static
+void RenderQueue::SetVertex(Vertex& vertex, GLfloat x, GLfloat y,
+                            GLfloat s, GLfloat t, int alpha) {
+  vertex.x = x;
+  vertex.y = y;
+  vertex.s = s;
+  vertex.t = t;
+  vertex.colour[0] = vertex.colour[1] = vertex.colour[2] = 255;
+  vertex.colour[3] = alpha;
+  std::fill(vertex.effect_colour, vertex.effect_colour + 4, 0.0f);
+  std::fill(vertex.tint_light, vertex.tint_light + 4, 0.0f);
+  std::fill(vertex.mono_invert, vertex.mono_invert + 2, 0.0f);
+}
+
+// static
+void RenderQueue::SetVertexEffects(Vertex& vertex, const GraphicsObject& go) {
+  const RGBAColour& colour = go.colour();
+  vertex.effect_colour[0] = colour.r_float();
+  vertex.effect_colour[1] = colour.g_float();
+  vertex.effect_colour[2] = colour.b_float();
+  vertex.effect_colour[3] = colour.a_float();
+
+  const RGBColour& tint = go.tint();
+  vertex.tint_light[0] = tint.r_float();
+  vertex.tint_light[1] = tint.g_float();
+  vertex.tint_light[2] = tint.b_float();
+  vertex.tint_light[3] = go.light() / 255.0f;
+
+  vertex.mono_invert[0] = go.mono() / 255.0f;
+  vertex.mono_invert[1] = go.invert() / 255.0f;
+}
+
+// static
+void RenderQueue::AddQuad(GLuint texture, BlendMode blend, bool use_shader,
+                          const Vertex vertices[4]) {
+  Quad quad;
+  quad.key.texture = texture;
+  quad.key.blend = blend;
+  quad.key.use_shader = use_shader;
+  quad.bounds.x1 = quad.bounds.x2 = vertices[0].x;
+  quad.bounds.y1 = quad.bounds.y2 = vertices[0].y;
+  for (int i = 1; i < 4; ++i) {
+    quad.bounds.x1 = std::min(quad.bounds.x1, vertices[i].x);
+    quad.bounds.x2 = std::max(quad.bounds.x2, vertices[i].x);
+    quad.bounds.y1 = std::min(quad.bounds.y1, vertices[i].y);
+    quad.bounds.y2 = std::max(quad.bounds.y2, vertices[i].y);
+  }
+
+  queued_quads_.push_back(quad);
+  queued_vertices_.insert(queued_vertices_.end(), vertices, vertices + 4);
+}
+
+// static
+void RenderQueue::BuildBatches() {
+  for (size_t i = 0; i < batch_count_; ++i)
+    batches_[i].quads.clear();
+  batch_count_ = 0;
+
+  for (size_t i = 0; i < queued_quads_.size(); ++i) {
+    const Quad& quad = queued_quads_[i];
+
+    // Walk back to the latest batch we could join, stopping at anything we
+    // would have to be drawn on top of.
+    int target = -1;
+    for (int b = static_cast<int>(batch_count_) - 1; b >= 0; --b) {
+      const Batch& batch = batches_[b];
+      if (batch.key == quad.key) {
+        target = b;
+        break;
+      }
+
+      if (batch.bounds.intersects(quad.bounds)) {
+        bool overlaps = false;
+        for (std::vector<int>::const_iterator it = batch.quads.begin();
+             it != batch.quads.end() && !overlaps; ++it) {
+          overlaps = queued_quads_[*it].bounds.intersects(quad.bounds);
+        }
+        if (overlaps)
+          break;
+      }
+    }
+
+    if (target == -1) {
+      if (batch_count_ == batches_.size())
+        batches_.push_back(Batch());
+      target = batch_count_++;
+      batches_[target].key = quad.key;
+      batches_[target].bounds = quad.bounds;
+    } else {
+      Bounds& bounds = batches_[target].bounds;
+      bounds.x1 = std::min(bounds.x1, quad.bounds.x1);
+      bounds.y1 = std::min(bounds.y1, quad.bounds.y1);
+      bounds.x2 = std::max(bounds.x2, quad.bounds.x2);
+      bounds.y2 = std::max(bounds.y2, quad.bounds.y2);
+    }
+
+    batches_[target].quads.push_back(i);
+  }
+}
+
+// static
+void RenderQueue::Flush() {
+  if (queued_quads_.empty())
+    return;
+
+  BuildBatches();
+
+  // Lay the vertices out batch by batch so each batch is one range.
+  bool any_shader = false;
+  batched_vertices_.clear();
+  for (size_t b = 0; b < batch_count_; ++b) {
+    any_shader |= batches_[b].key.use_shader;
+    for (std::vector<int>::const_iterator it = batches_[b].quads.begin();
+         it != batches_[b].quads.end(); ++it) {
+      std::vector<Vertex>::const_iterator first =
+          queued_vertices_.begin() + *it * 4;
+      batched_vertices_.insert(batched_vertices_.end(), first, first + 4);
+    }
+  }
+
+  const char* base = reinterpret_cast<const char*>(&batched_vertices_[0]);
+  if (GLEW_ARB_vertex_buffer_object) {
+    if (vertex_buffer_ == 0)
+      glGenBuffersARB(1, &vertex_buffer_);
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, vertex_buffer_);
+
+    // Respecifying the whole buffer lets the driver hand us fresh storage
+    // instead of waiting for the last frame to finish with the old one.
+    GLsizeiptrARB size = batched_vertices_.size() * sizeof(Vertex);
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB, size, NULL, GL_STREAM_DRAW_ARB);
+    glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, size, base);
+    base = NULL;
+  }
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(2, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, x));
+  glEnableClientState(GL_COLOR_ARRAY);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex),
+                 base + offsetof(Vertex, colour));
+  setTexCoordArray(GL_TEXTURE0_ARB, 2, base, offsetof(Vertex, s));
+  if (any_shader) {
+    setTexCoordArray(GL_TEXTURE1_ARB, 4, base,
+                     offsetof(Vertex, effect_colour));
+    setTexCoordArray(GL_TEXTURE2_ARB, 4, base, offsetof(Vertex, tint_light));
+    setTexCoordArray(GL_TEXTURE3_ARB, 2, base,
+                     offsetof(Vertex, mono_invert));
+  }
+
+  bool using_shader = false;
+  GLint first = 0;
+  for (size_t b = 0; b < batch_count_; ++b) {
+    const Batch& batch = batches_[b];
+    if (batch.key.use_shader != using_shader) {
+      using_shader = batch.key.use_shader;
+      if (using_shader) {
+        glUseProgramObjectARB(Shaders::getBatchedObjectProgram());
+        glUniform1iARB(Shaders::getBatchedObjectUniformImage(), 0);
+      } else {
+        glUseProgramObjectARB(0);
+      }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, batch.key.texture);
+    setBlendFunc(batch.key.blend);
+
+    GLsizei count = batch.quads.size() * 4;
+    glDrawArrays(GL_QUADS, first, count);
+    first += count;
+  }
+
+  if (using_shader)
+    glUseProgramObjectARB(0);
+  glBlendFunc(GL_ONE, GL_ZERO);
+
+  if (any_shader) {
+    clearTexCoordArray(GL_TEXTURE3_ARB);
+    clearTexCoordArray(GL_TEXTURE2_ARB);
+    clearTexCoordArray(GL_TEXTURE1_ARB);
+  }
+  clearTexCoordArray(GL_TEXTURE0_ARB);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  if (vertex_buffer_)
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+  DebugShowGLErrors();
+
+  queued_quads_.clear();
+  queued_vertices_.clear();
+}
+
+// static
+void RenderQueue::ResetContext() {
+  queued_quads_.clear();
+  queued_vertices_.clear();
+  vertex_buffer_ = 0;
+}
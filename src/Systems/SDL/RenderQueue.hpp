@@ -0,0 +1,139 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2013 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_SDL_RENDERQUEUE_HPP_
+#define SRC_SYSTEMS_SDL_RENDERQUEUE_HPP_
+
+#include <SDL/SDL_opengl.h>
+
+#include <vector>
+
+class GraphicsObject;
+
+// Collects the textured quads drawn during a frame and draws them with as
+// few OpenGL calls as possible, from one streaming vertex buffer.
+//
+// Quads with the same texture, blend mode and program are drawn together. A
+// quad is only moved ahead of quads queued before it when it doesn't overlap
+// any of them, so the screen looks the same as drawing each quad on its own.
+//
+// Anything that draws with OpenGL directly, reads back the screen, or
+// changes or deletes a texture must call Flush() first.
+class RenderQueue {
+ public:
+  enum BlendMode {
+    // glBlendFunc(GL_ONE, GL_ZERO)
+    BLEND_COPY,
+    // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+    BLEND_ALPHA,
+    // glBlendFunc(GL_SRC_ALPHA, GL_ONE)
+    BLEND_ADDITIVE
+  };
+
+  // One corner of a quad.
+  struct Vertex {
+    GLfloat x, y;
+    GLfloat s, t;
+    GLubyte colour[4];
+
+    // Read by Shaders::getBatchedObjectProgram(): the object's colour, its
+    // tint and light, and its mono and invert, all scaled to [0, 1].
+    GLfloat effect_colour[4];
+    GLfloat tint_light[4];
+    GLfloat mono_invert[2];
+  };
+
+  // Fills in the position, texture coordinate and primary colour of
+  // |vertex|, with no effects.
+  static void SetVertex(Vertex& vertex, GLfloat x, GLfloat y,
+                        GLfloat s, GLfloat t, int alpha);
+
+  // Copies |go|'s colour effects into |vertex|.
+  static void SetVertexEffects(Vertex& vertex, const GraphicsObject& go);
+
+  // Queues a quad of |texture| with the corners in |vertices|, given
+  // clockwise from the top left. If |use_shader|, the effects in the
+  // vertices are applied with the batched object program.
+  static void AddQuad(GLuint texture, BlendMode blend, bool use_shader,
+                      const Vertex vertices[4]);
+
+  // Draws everything queued.
+  static void Flush();
+
+  // Drops the vertex buffer after the OpenGL context has been recreated.
+  static void ResetContext();
+
+ private:
+  struct Key {
+    GLuint texture;
+    BlendMode blend;
+    bool use_shader;
+
+    bool operator==(const Key& rhs) const {
+      return texture == rhs.texture && blend == rhs.blend &&
+          use_shader == rhs.use_shader;
+    }
+  };
+
+  struct Bounds {
+    GLfloat x1, y1, x2, y2;
+
+    bool intersects(const Bounds& rhs) const {
+      return x1 < rhs.x2 && rhs.x1 < x2 && y1 < rhs.y2 && rhs.y1 < y2;
+    }
+  };
+
+  struct Quad {
+    Key key;
+    Bounds bounds;
+  };
+
+  // Quads drawn together, in the order they were queued.
+  struct Batch {
+    Key key;
+    Bounds bounds;
+    std::vector<int> quads;
+  };
+
+  // Groups |queued_quads_| into |batches_|.
+  static void BuildBatches();
+
+  // Quads in the order they were queued, and their vertices, four per quad.
+  static std::vector<Quad> queued_quads_;
+  static std::vector<Vertex> queued_vertices_;
+
+  // Reused between flushes so we don't allocate every frame. Only the first
+  // |batch_count_| batches are in use.
+  static std::vector<Batch> batches_;
+  static size_t batch_count_;
+  static std::vector<Vertex> batched_vertices_;
+
+  // The streaming vertex buffer, or 0 if it hasn't been made yet.
+  static GLuint vertex_buffer_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_RENDERQUEUE_HPP_
@@ -30,6 +30,7 @@
 
 #include "Systems/Base/Colour.hpp"
 #include "Systems/Base/GraphicsObject.hpp"
+#include "Systems/SDL/RenderQueue.hpp"
 #include "Systems/SDL/SDLUtils.hpp"
 #include "Systems/SDL/Shaders.hpp"
 #include "Systems/SDL/Texture.hpp"
@@ -48,6 +49,8 @@ SDLColourFilter::~SDLColourFilter() {
 
 void SDLColourFilter::Fill(const GraphicsObject& go,
                            const RGBAColour& colour) {
+  RenderQueue::Flush();
+
   if (GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
     if (back_texture_id_ == 0) {
       glGenTextures(1, &back_texture_id_);
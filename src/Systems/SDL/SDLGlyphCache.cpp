@@ -0,0 +1,159 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "Systems/SDL/SDLGlyphCache.hpp"
+
+#include <SDL/SDL.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#include "Systems/Base/Colour.hpp"
+#include "Systems/Base/SystemError.hpp"
+
+// Each atlas page is this many pixels square. 32-bit pixels make each page
+// 1MB.
+static const int kPageSize = 512;
+
+// Once this many pages are full, the cache starts over.
+static const size_t kMaxPages = 8;
+
+// -----------------------------------------------------------------------
+// SDLGlyphCache
+// -----------------------------------------------------------------------
+SDLGlyphCache::SDLGlyphCache()
+    : shelf_x_(0), shelf_y_(0), shelf_height_(0), hits_(0), misses_(0) {
+}
+
+SDLGlyphCache::~SDLGlyphCache() {
+  clear();
+}
+
+bool SDLGlyphCache::find(int font_size, const RGBColour& colour,
+                         const std::string& glyph, Glyph& out) {
+  GlyphMap::const_iterator it = glyphs_.find(makeKey(font_size, colour, glyph));
+  if (it == glyphs_.end()) {
+    misses_++;
+    return false;
+  }
+
+  hits_++;
+  out = it->second;
+  return true;
+}
+
+void SDLGlyphCache::insert(int font_size, const RGBColour& colour,
+                           const std::string& glyph, SDL_Surface* surface,
+                           Glyph& out) {
+  out = allocate(Size(surface->w, surface->h), surface);
+
+  // Both surfaces are in the same format, so this is a straight copy that
+  // keeps the alpha channel as is.
+  SDL_LockSurface(surface);
+  SDL_LockSurface(out.page);
+  int row_bytes = surface->w * surface->format->BytesPerPixel;
+  const char* src = static_cast<const char*>(surface->pixels);
+  char* dst = static_cast<char*>(out.page->pixels) +
+              out.rect.y() * out.page->pitch +
+              out.rect.x() * out.page->format->BytesPerPixel;
+  for (int y = 0; y < surface->h; ++y) {
+    memcpy(dst, src, row_bytes);
+    src += surface->pitch;
+    dst += out.page->pitch;
+  }
+  SDL_UnlockSurface(out.page);
+  SDL_UnlockSurface(surface);
+
+  glyphs_[makeKey(font_size, colour, glyph)] = out;
+}
+
+void SDLGlyphCache::printStatistics(std::ostream& os) const {
+  os << "Glyph cache: " << glyphs_.size() << " glyphs on " << pages_.size()
+     << " pages; " << hits_ << " hits, " << misses_ << " misses" << std::endl;
+}
+
+// static
+SDLGlyphCache::Key SDLGlyphCache::makeKey(int font_size,
+                                          const RGBColour& colour,
+                                          const std::string& glyph) {
+  int packed_colour = (colour.r() << 16) | (colour.g() << 8) | colour.b();
+  return Key(font_size, packed_colour, glyph);
+}
+
+SDLGlyphCache::Glyph SDLGlyphCache::allocate(const Size& size,
+                                             SDL_Surface* format_source) {
+  // Move down to a new shelf if this one is out of room.
+  if (!pages_.empty() && shelf_x_ + size.width() > pages_.back()->w) {
+    shelf_x_ = 0;
+    shelf_y_ += shelf_height_;
+    shelf_height_ = 0;
+  }
+
+  if (pages_.empty() || shelf_x_ + size.width() > pages_.back()->w ||
+      shelf_y_ + size.height() > pages_.back()->h) {
+    if (pages_.size() >= kMaxPages)
+      clear();
+
+    // A glyph too large for a normal page (only at enormous font sizes) gets
+    // a page of its own.
+    SDL_PixelFormat* format = format_source->format;
+    SDL_Surface* page = SDL_CreateRGBSurface(
+        SDL_SWSURFACE, std::max(kPageSize, size.width()),
+        std::max(kPageSize, size.height()), format->BitsPerPixel,
+        format->Rmask, format->Gmask, format->Bmask, format->Amask);
+    if (page == NULL)
+      throw SystemError("Could not allocate a glyph cache page");
+    SDL_SetAlpha(page, format_source->flags & SDL_SRCALPHA,
+                 format_source->format->alpha);
+
+    pages_.push_back(page);
+    shelf_x_ = 0;
+    shelf_y_ = 0;
+    shelf_height_ = 0;
+  }
+
+  Glyph glyph;
+  glyph.page = pages_.back();
+  glyph.rect = Rect(Point(shelf_x_, shelf_y_), size);
+
+  shelf_x_ += size.width();
+  shelf_height_ = std::max(shelf_height_, size.height());
+  return glyph;
+}
+
+void SDLGlyphCache::clear() {
+  for (std::vector<SDL_Surface*>::iterator it = pages_.begin();
+       it != pages_.end(); ++it) {
+    SDL_FreeSurface(*it);
+  }
+  pages_.clear();
+  glyphs_.clear();
+  shelf_x_ = 0;
+  shelf_y_ = 0;
+  shelf_height_ = 0;
+}
@@ -0,0 +1,108 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_SDL_SDLGLYPHCACHE_HPP_
+#define SRC_SYSTEMS_SDL_SDLGLYPHCACHE_HPP_
+
+#include <boost/noncopyable.hpp>
+#include <boost/tuple/tuple.hpp>
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Systems/Base/Rect.hpp"
+
+struct SDL_Surface;
+class RGBColour;
+
+// Glyphs that SDL_ttf has already rendered, keyed on font size, colour and
+// the UTF-8 character. The glyphs are packed into a few large atlas pages
+// instead of being kept as one small surface each. Message skip and backlog
+// replay draw the same few thousand characters over and over, and without
+// this each one goes back through FreeType.
+//
+// Pages are packed in shelves: glyphs are placed left to right in rows as
+// tall as the tallest glyph in them. Once the cache has used all its pages,
+// it is emptied and starts over.
+class SDLGlyphCache : public boost::noncopyable {
+ public:
+  // Where a cached glyph is in the atlas.
+  struct Glyph {
+    SDL_Surface* page;
+    Rect rect;
+  };
+
+  SDLGlyphCache();
+  ~SDLGlyphCache();
+
+  // Looks up a glyph. Returns false if it hasn't been cached.
+  bool find(int font_size, const RGBColour& colour, const std::string& glyph,
+            Glyph& out);
+
+  // Copies the rendered |surface| into the atlas and fills |out| with where
+  // it went. |surface| must be in the 32-bit format SDL_ttf's blended
+  // rendering produces. The returned location is valid until the next call
+  // to insert().
+  void insert(int font_size, const RGBColour& colour,
+              const std::string& glyph, SDL_Surface* surface, Glyph& out);
+
+  long hits() const { return hits_; }
+  long misses() const { return misses_; }
+
+  // Writes a one line summary of the cache's size and hit rate.
+  void printStatistics(std::ostream& os) const;
+
+ private:
+  typedef boost::tuple<int, int, std::string> Key;
+  typedef std::map<Key, Glyph> GlyphMap;
+
+  static Key makeKey(int font_size, const RGBColour& colour,
+                     const std::string& glyph);
+
+  // Finds room for a |size| glyph, starting a new page (or emptying the
+  // cache) when the current one is full.
+  Glyph allocate(const Size& size, SDL_Surface* format_source);
+
+  // Frees every page and forgets every glyph.
+  void clear();
+
+  GlyphMap glyphs_;
+
+  std::vector<SDL_Surface*> pages_;
+
+  // Packing state for the last page in |pages_|.
+  int shelf_x_;
+  int shelf_y_;
+  int shelf_height_;
+
+  long hits_;
+  long misses_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_SDLGLYPHCACHE_HPP_
@@ -31,13 +31,17 @@
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_opengl.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
-#include <boost/scoped_array.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <cstdio>
+#include <cstring>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
@@ -52,22 +56,27 @@
 #include "Systems/Base/Colour.hpp"
 #include "Systems/Base/EventSystem.hpp"
 #include "Systems/Base/GraphicsObject.hpp"
+#include "Systems/Base/ImageDiskCache.hpp"
 #include "Systems/Base/MouseCursor.hpp"
 #include "Systems/Base/Renderable.hpp"
+#include "Systems/Base/SoftwareCompositor.hpp"
 #include "Systems/Base/System.hpp"
 #include "Systems/Base/SystemError.hpp"
 #include "Systems/Base/TextSystem.hpp"
 #include "Systems/Base/ToneCurve.hpp"
+#include "Systems/SDL/RenderQueue.hpp"
 #include "Systems/SDL/SDLColourFilter.hpp"
 #include "Systems/SDL/SDLEventSystem.hpp"
 #include "Systems/SDL/SDLRenderToTextureSurface.hpp"
 #include "Systems/SDL/SDLSurface.hpp"
 #include "Systems/SDL/SDLUtils.hpp"
 #include "Systems/SDL/Texture.hpp"
+#include "Systems/SDL/TextureAtlas.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/Graphics.hpp"
 #include "Utilities/LazyArray.hpp"
 #include "Utilities/StringUtilities.hpp"
+#include "libReallive/filemap.h"
 #include "libReallive/gameexe.h"
 #include "xclannad/file.h"
 
@@ -75,6 +84,28 @@ using namespace boost;
 using namespace std;
 using namespace libReallive;
 
+namespace {
+
+// Applies a colour filter's effects to the screen while it is being
+// composited on the CPU.
+class CompositorColourFilter : public ColourFilter {
+ public:
+  CompositorColourFilter(SoftwareCompositor* compositor,
+                         const Rect& screen_rect)
+      : compositor_(compositor), screen_rect_(screen_rect) {}
+
+  virtual void Fill(const GraphicsObject& go, const RGBAColour& colour) {
+    if (compositor_->inFrame())
+      compositor_->filterArea(screen_rect_, CompositorEffects(go));
+  }
+
+ private:
+  SoftwareCompositor* compositor_;
+  Rect screen_rect_;
+};
+
+}  // namespace
+
 // -----------------------------------------------------------------------
 // Private Interface
 // -----------------------------------------------------------------------
@@ -86,6 +117,8 @@ void SDLGraphicsSystem::setCursor(int cursor) {
 }
 
 void SDLGraphicsSystem::beginFrame() {
+  TextureAtlas::NewFrame();
+
   glClearColor(0, 0, 0, 0);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   DebugShowGLErrors();
@@ -108,6 +141,9 @@ void SDLGraphicsSystem::beginFrame() {
   // Full screen shaking moves where the origin is.
   Point origin = GetScreenOrigin();
   glTranslatef(origin.x(), origin.y(), 0);
+
+  if (compositor_)
+    compositor_->beginFrame(origin);
 }
 
 void SDLGraphicsSystem::markScreenAsDirty(GraphicsUpdateType type) {
@@ -120,11 +156,18 @@ void SDLGraphicsSystem::markScreenAsDirty(GraphicsUpdateType type) {
 }
 
 void SDLGraphicsSystem::endFrame() {
+  if (compositor_)
+    presentCompositedFrame();
+
   FinalRenderers::iterator it = renderer_begin();
   FinalRenderers::iterator end = renderer_end();
   for (; it != end; ++it) {
+    // The final renderers (the GUI among them) may draw with OpenGL
+    // directly, so everything before them has to be on the screen first.
+    RenderQueue::Flush();
     (*it)->render(NULL);
   }
+  RenderQueue::Flush();
 
   if (screenUpdateMode() == SCREENUPDATEMODE_MANUAL) {
     // Copy the area behind the cursor to the temporary buffer (drivers differ:
@@ -140,6 +183,7 @@ void SDLGraphicsSystem::endFrame() {
   }
 
   drawCursor();
+  RenderQueue::Flush();
 
   // Swap the buffers
   glFlush();
@@ -177,6 +221,7 @@ void SDLGraphicsSystem::redrawLastFrame() {
     glEnd();
 
     drawCursor();
+    RenderQueue::Flush();
 
     glFlush();
 
@@ -198,7 +243,70 @@ void SDLGraphicsSystem::drawCursor() {
   }
 }
 
+void SDLGraphicsSystem::presentCompositedFrame() {
+  compositor_->endFrame();
+
+  // Only upload the tiles that changed since we last drew to the screen.
+  std::vector<Rect> tiles;
+  compositor_->takeChangedTiles(tiles);
+  glBindTexture(GL_TEXTURE_2D, compositor_texture_);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, screenSize().width());
+  for (std::vector<Rect>::const_iterator it = tiles.begin();
+       it != tiles.end(); ++it) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, it->x(), it->y(),
+                    it->width(), it->height(),
+                    GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                    compositor_->pixels() +
+                    it->y() * screenSize().width() + it->x());
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  DebugShowGLErrors();
+
+  int width = screenSize().width();
+  int height = screenSize().height();
+  float x_cord = width / float(screen_tex_width_);
+  float y_cord = height / float(screen_tex_height_);
+
+  // The compositor has already moved everything by the screen origin.
+  glPushMatrix(); {
+    glLoadIdentity();
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glBegin(GL_QUADS); {
+      glColor4ub(255, 255, 255, 255);
+      glTexCoord2f(0, 0);
+      glVertex2i(0, 0);
+      glTexCoord2f(x_cord, 0);
+      glVertex2i(width, 0);
+      glTexCoord2f(x_cord, y_cord);
+      glVertex2i(width, height);
+      glTexCoord2f(0, y_cord);
+      glVertex2i(0, height);
+    }
+    glEnd();
+  }
+  glPopMatrix();
+  DebugShowGLErrors();
+}
+
 shared_ptr<Surface> SDLGraphicsSystem::endFrameToSurface() {
+  if (compositor_) {
+    compositor_->endFrame();
+
+    SDL_Surface* surface = SDL_CreateRGBSurface(
+        SDL_SWSURFACE, screenSize().width(), screenSize().height(), 32,
+        0xFF0000, 0xFF00, 0xFF, 0xFF000000);
+    if (surface == NULL)
+      reportSDLError("SDL_CreateRGBSurface", "endFrameToSurface()");
+
+    const Uint32* src = compositor_->pixels();
+    for (int y = 0; y < screenSize().height(); ++y) {
+      memcpy(static_cast<char*>(surface->pixels) + y * surface->pitch,
+             src + y * screenSize().width(), screenSize().width() * 4);
+    }
+
+    return shared_ptr<Surface>(new SDLSurface(this, surface));
+  }
+
   return shared_ptr<Surface>(new SDLRenderToTextureSurface(this, screenSize()));
 }
 
@@ -212,7 +320,8 @@ SDLGraphicsSystem::SDLGraphicsSystem(System& system, Gameexe& gameexe)
     last_seen_number_(0), last_line_number_(0),
     screen_contents_texture_valid_(false),
     screen_tex_width_(0),
-    screen_tex_height_(0) {
+    screen_tex_height_(0),
+    compositor_texture_(0) {
   haikei_.reset(new SDLSurface(this));
   for (int i = 0; i < 16; ++i)
     display_contexts_[i].reset(new SDLSurface(this));
@@ -225,6 +334,13 @@ SDLGraphicsSystem::SDLGraphicsSystem(System& system, Gameexe& gameexe)
   int name_enc = gameexe("NAME_ENC").to_int(0);
   caption_title_ = cp932toUTF8(cp932caption, name_enc);
 
+  // __SOFTWARE_COMPOSITOR is the number of threads to composite the screen
+  // with; 0 uses one per core.
+  if (gameexe("__SOFTWARE_COMPOSITOR").exists()) {
+    compositor_.reset(new SoftwareCompositor(
+        screenSize(), gameexe("__SOFTWARE_COMPOSITOR").to_int(0)));
+  }
+
   setupVideo();
 
   // Now we allocate the first two display contexts with equal size to
@@ -251,6 +367,16 @@ SDLGraphicsSystem::SDLGraphicsSystem(System& system, Gameexe& gameexe)
   }
 
   SDL_ShowCursor(useCustomCursor() ? SDL_DISABLE : SDL_ENABLE);
+
+  int disk_cache_mb = gameexe("__IMAGE_DISK_CACHE_MB").to_int(0);
+  if (disk_cache_mb > 0) {
+    image_disk_cache_.reset(new ImageDiskCache(
+        system.gameSaveDirectory() / "image_cache",
+        static_cast<size_t>(disk_cache_mb) * 1024 * 1024));
+  }
+
+  enableImagePreloading(boost::bind(&SDLGraphicsSystem::decodeImageFile,
+                                    image_disk_cache_, _1));
 }
 
 void SDLGraphicsSystem::setupVideo() {
@@ -310,6 +436,10 @@ void SDLGraphicsSystem::setupVideo() {
     throw SystemError(oss.str());
   }
 
+  // Any vertex buffer or atlas pages belonged to the old context.
+  RenderQueue::ResetContext();
+  TextureAtlas::ResetContext();
+
   glEnable(GL_TEXTURE_2D);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
@@ -351,6 +481,20 @@ void SDLGraphicsSystem::setupVideo() {
                screen_tex_width_, screen_tex_height_, 0, GL_RGB,
                GL_UNSIGNED_BYTE, NULL);
 
+  if (compositor_) {
+    // Sized like |screen_contents_texture_| so older drivers can cope.
+    glGenTextures(1, &compositor_texture_);
+    glBindTexture(GL_TEXTURE_2D, compositor_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                 screen_tex_width_, screen_tex_height_, 0, GL_BGRA,
+                 GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+
+    // The new texture is empty, so upload all of the next frame.
+    compositor_->invalidate();
+  }
+
   ShowGLErrors();
 }
 
@@ -358,9 +502,12 @@ SDLGraphicsSystem::~SDLGraphicsSystem() {
 }
 
 void SDLGraphicsSystem::executeGraphicsSystem(RLMachine& machine) {
-  // For now, nothing, but later, we need to put all code each cycle
-  // here.
-  if (isResponsibleForUpdate() && screenNeedsRefresh()) {
+  // While skipping read text, let changes to the screen pile up and draw
+  // them in one frame once skipping stops.
+  bool rendering_suppressed = machine.system().text().renderingSuppressed();
+
+  if (isResponsibleForUpdate() && screenNeedsRefresh() &&
+      !rendering_suppressed) {
     refresh(NULL);
     screenRefreshed();
     redraw_last_frame_ = false;
@@ -513,32 +660,56 @@ typedef enum { NO_MASK, ALPHA_MASK, COLOR_MASK} MaskType;
 #define DefaultAmask 0xff000000
 #define DefaultBpp 32
 
+// Wraps |data|, which must come from malloc(), in a surface that takes
+// ownership of it.
+//
+// We can't (regretfully) rely on SDL_DisplayFormat[Alpha] to decide on a
+// format that we can send to OpenGL (see some Intel macs), so we use the
+// above format, which orders our data correctly, with only the flags that
+// would have been set by SDL_DisplayFormat[Alpha]. That is exactly what
+// SDL_CreateRGBSurfaceFrom() gives us, so the pixels the decoder wrote are
+// used as is instead of being converted into a fresh copy.
 static SDL_Surface* newSurfaceFromRGBAData(int w, int h, char* data,
                                            MaskType with_mask) {
   int amask = (with_mask == ALPHA_MASK) ? DefaultAmask : 0;
-  SDL_Surface* tmp = SDL_CreateRGBSurfaceFrom(
+  SDL_Surface* surf = SDL_CreateRGBSurfaceFrom(
     data, w, h, DefaultBpp, w*4, DefaultRmask, DefaultGmask,
     DefaultBmask, amask);
-
-  // We now need to convert this surface to a format suitable for use across
-  // the rest of the program. We can't (regretfully) rely on
-  // SDL_DisplayFormat[Alpha] to decide on a format that we can send to OpenGL
-  // (see some Intel macs) so use convert surface to a pixel order our data
-  // correctly while still using the appropriate alpha flags. So use the above
-  // format with only the flags that would have been set by
-  // SDL_DisplayFormat[Alpha].
-  Uint32 flags;
-  if (with_mask == ALPHA_MASK) {
-    flags = tmp->flags & (SDL_SRCALPHA | SDL_RLEACCELOK);
-  } else {
-    flags = tmp->flags & (SDL_SRCCOLORKEY | SDL_SRCALPHA | SDL_RLEACCELOK);
+  if (surf == NULL) {
+    free(data);
+    return NULL;
   }
 
-  SDL_Surface* surf = SDL_ConvertSurface(tmp, tmp->format, flags);
-  SDL_FreeSurface(tmp);
+  // Without SDL_PREALLOC, SDL_FreeSurface() free()s the pixels for us.
+  surf->flags &= ~SDL_PREALLOC;
   return surf;
 };
 
+// Whether every pixel in |data| has an alpha of 0xff.
+static bool isFullyOpaque(const char* data, int pixel_count) {
+  const Uint32* pixels = reinterpret_cast<const Uint32*>(data);
+  int i = 0;
+#if defined(__SSE2__)
+  // Check sixteen pixels per branch.
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(DefaultAmask));
+  for (; i + 16 <= pixel_count; i += 16) {
+    const __m128i* block = reinterpret_cast<const __m128i*>(pixels + i);
+    __m128i all = _mm_and_si128(
+        _mm_and_si128(_mm_loadu_si128(block), _mm_loadu_si128(block + 1)),
+        _mm_and_si128(_mm_loadu_si128(block + 2), _mm_loadu_si128(block + 3)));
+    __m128i opaque = _mm_cmpeq_epi32(_mm_and_si128(all, alpha), alpha);
+    if (_mm_movemask_epi8(opaque) != 0xffff)
+      return false;
+  }
+#endif
+  for (; i < pixel_count; ++i) {
+    if ((pixels[i] & DefaultAmask) != DefaultAmask)
+      return false;
+  }
+
+  return true;
+}
+
 // Helper function for load_surface_from_file; invoked in a stl loop.
 static SDLSurface::GrpRect xclannadRegionToGrpRect(
     const GRPCONV::REGION& region) {
@@ -550,73 +721,126 @@ static SDLSurface::GrpRect xclannadRegionToGrpRect(
   return rect;
 }
 
-boost::shared_ptr<const Surface> SDLGraphicsSystem::loadSurfaceFromFile(
-    const std::string& short_filename) {
-  boost::filesystem::path filename =
-      system().findFile(short_filename, IMAGE_FILETYPES);
-  if (filename.empty()) {
-    ostringstream oss;
-    oss << "Could not find image file \"" << short_filename << "\".";
-    throw rlvm::Exception(oss.str());
+// Grabs the Type-2 information out of the converter or creates one default
+// region if none exist.
+static void buildRegionTable(GRPCONV& conv,
+                             vector<SDLSurface::GrpRect>& region_table) {
+  if (conv.region_table.size()) {
+    transform(conv.region_table.begin(), conv.region_table.end(),
+              back_inserter(region_table),
+              xclannadRegionToGrpRect);
+  } else {
+    SDLSurface::GrpRect rect;
+    rect.rect = Rect(Point(0, 0), Size(conv.Width(), conv.Height()));
+    rect.originX = 0;
+    rect.originY = 0;
+    region_table.push_back(rect);
   }
+}
+
+// What decodeImageFile() produces: a surface that owns its pixels, and the
+// region table that goes with it.
+class SDLDecodedImage : public DecodedImage {
+ public:
+  SDLDecodedImage() : surface(NULL) {}
+  virtual ~SDLDecodedImage() {
+    if (surface)
+      SDL_FreeSurface(surface);
+  }
+
+  SDL_Surface* surface;
+  Size size;
+  vector<SDLSurface::GrpRect> region_table;
+};
 
-  // Glue code to allow my stuff to work with Jagarl's loader
-  FILE* file = fopen(filename.string().c_str(), "rb");
-  if (!file) {
+// static
+DecodedImage* SDLGraphicsSystem::decodeImageFile(
+    const boost::shared_ptr<ImageDiskCache>& disk_cache,
+    const boost::filesystem::path& filename) {
+  if (disk_cache) {
+    ImageDiskCache::Metadata metadata;
+    char* pixels = disk_cache->load(filename, metadata);
+    if (pixels) {
+      std::auto_ptr<SDLDecodedImage> image(new SDLDecodedImage);
+      image->size = metadata.size;
+      image->surface = newSurfaceFromRGBAData(
+          metadata.size.width(), metadata.size.height(), pixels,
+          metadata.is_mask ? ALPHA_MASK : NO_MASK);
+      image->region_table = metadata.region_table;
+      return image.release();
+    }
+  }
+
+  // Glue code to allow my stuff to work with Jagarl's loader. The file is
+  // mapped rather than read, and the converter decodes straight into the
+  // buffer that becomes the surface's pixels.
+  scoped_ptr<Mapping> file;
+  try {
+    file.reset(new Mapping(filename.string(), Read));
+  } catch (libReallive::Error& e) {
     ostringstream oss;
     oss << "Could not open file: " << filename;
     throw rlvm::Exception(oss.str());
   }
 
-  fseek(file, 0, SEEK_END);
-  size_t size = ftell(file);
-  scoped_array<char> d(new char[size + 1]);
-  fseek(file, 0, SEEK_SET);
-  fread(d.get(), size, 1, file);
-  fclose(file);
-
-  scoped_ptr<GRPCONV> conv(GRPCONV::AssignConverter(d.get(), size, "???"));
+  scoped_ptr<GRPCONV> conv(
+      GRPCONV::AssignConverter(file->get(), file->size(), "???"));
   if (conv == 0) {
     throw SystemError("Failure in GRPCONV.");
   }
-  // do not free until SDL_FreeSurface() is called on the surface using it
+
+  std::auto_ptr<SDLDecodedImage> image(new SDLDecodedImage);
+  image->size = Size(conv->Width(), conv->Height());
+  buildRegionTable(*conv, image->region_table);
+
+  // The LZ decoders may write a little past the end of the image.
   char* mem = (char*)malloc(conv->Width() * conv->Height() * 4 + 1024);
-  SDL_Surface* s = 0;
   if (conv->Read(mem)) {
     MaskType is_mask = conv->IsMask() ? ALPHA_MASK : NO_MASK;
-    if (is_mask == ALPHA_MASK) {
-      int len = conv->Width()*conv->Height();
-      unsigned int* d = (unsigned int*)mem;
-      int i;
-      for (i = 0; i < len; i++) {
-        if ( (*d&0xff000000) != 0xff000000) break;
-        d++;
-      }
-      if (i == len) {
-        is_mask = NO_MASK;
-      }
+    if (is_mask == ALPHA_MASK &&
+        isFullyOpaque(mem, conv->Width() * conv->Height())) {
+      is_mask = NO_MASK;
     }
 
-    s = newSurfaceFromRGBAData(conv->Width(), conv->Height(), mem, is_mask);
-  }
-  free(mem);
+    if (disk_cache) {
+      ImageDiskCache::Metadata metadata;
+      metadata.size = image->size;
+      metadata.is_mask = is_mask == ALPHA_MASK;
+      metadata.region_table = image->region_table;
+      disk_cache->store(filename, metadata, mem);
+    }
 
-  // Grab the Type-2 information out of the converter or create one
-  // default region if none exist
-  vector<SDLSurface::GrpRect> region_table;
-  if (conv->region_table.size()) {
-    transform(conv->region_table.begin(), conv->region_table.end(),
-              back_inserter(region_table),
-              xclannadRegionToGrpRect);
+    image->surface =
+        newSurfaceFromRGBAData(conv->Width(), conv->Height(), mem, is_mask);
   } else {
-    SDLSurface::GrpRect rect;
-    rect.rect = Rect(Point(0, 0), Size(conv->Width(), conv->Height()));
-    rect.originX = 0;
-    rect.originY = 0;
-    region_table.push_back(rect);
+    free(mem);
   }
 
-  shared_ptr<Surface> surface_to_ret(new SDLSurface(this, s, region_table));
+  return image.release();
+}
+
+boost::shared_ptr<const Surface> SDLGraphicsSystem::loadSurfaceFromFile(
+    const std::string& short_filename) {
+  boost::filesystem::path filename =
+      system().findFile(short_filename, IMAGE_FILETYPES);
+  if (filename.empty()) {
+    ostringstream oss;
+    oss << "Could not find image file \"" << short_filename << "\".";
+    throw rlvm::Exception(oss.str());
+  }
+
+  scoped_ptr<DecodedImage> image(
+      decodeImageFile(image_disk_cache_, filename));
+  return surfaceFromDecodedImage(short_filename, *image);
+}
+
+boost::shared_ptr<const Surface> SDLGraphicsSystem::surfaceFromDecodedImage(
+    const std::string& short_filename, DecodedImage& decoded) {
+  SDLDecodedImage& image = static_cast<SDLDecodedImage&>(decoded);
+  shared_ptr<Surface> surface_to_ret(
+      new SDLSurface(this, image.surface, image.region_table));
+  image.surface = NULL;
+
   // handle tone curve effect loading
   if(short_filename.find("?") != short_filename.npos) {
     string effect_no_str = short_filename.substr(short_filename.find("?") + 1);
@@ -627,7 +851,7 @@ boost::shared_ptr<const Surface> SDLGraphicsSystem::loadSurfaceFromFile(
       oss << "Tone curve index " << effect_no << " is invalid.";
       throw rlvm::Exception(oss.str());
     }
-    surface_to_ret.get()->toneCurve(globals().tone_curves.getEffect(effect_no / 10 - 1), Rect(Point(0, 0), Size(conv->Width(), conv->Height())));
+    surface_to_ret.get()->toneCurve(globals().tone_curves.getEffect(effect_no / 10 - 1), Rect(Point(0, 0), image.size));
   }
 
   return surface_to_ret;
@@ -656,6 +880,9 @@ boost::shared_ptr<Surface> SDLGraphicsSystem::buildSurface(const Size& size) {
 }
 
 ColourFilter* SDLGraphicsSystem::BuildColourFiller(const Rect& rect) {
+  if (compositor_)
+    return new CompositorColourFilter(compositor_.get(), rect);
+
   return new SDLColourFilter(rect);
 }
 
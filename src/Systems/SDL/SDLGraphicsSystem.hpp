@@ -31,6 +31,7 @@
 #include <set>
 #include <string>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include "Systems/Base/GraphicsSystem.hpp"
 
@@ -40,8 +41,10 @@ struct SDL_Surface;
 
 class Gameexe;
 class GraphicsObject;
+class ImageDiskCache;
 class SDLGraphicsSystem;
 class SDLSurface;
+class SoftwareCompositor;
 class System;
 class Texture;
 
@@ -85,6 +88,8 @@ class SDLGraphicsSystem : public GraphicsSystem {
 
   virtual boost::shared_ptr<const Surface> loadSurfaceFromFile(
       const std::string& short_filename);
+  virtual boost::shared_ptr<const Surface> surfaceFromDecodedImage(
+      const std::string& short_filename, DecodedImage& image);
 
   virtual boost::shared_ptr<Surface> getHaikei();
   virtual boost::shared_ptr<Surface> getDC(int dc);
@@ -92,6 +97,10 @@ class SDLGraphicsSystem : public GraphicsSystem {
 
   virtual ColourFilter* BuildColourFiller(const Rect& rect);
 
+  // Returns the compositor that draws the screen on the CPU, or NULL when
+  // drawing with OpenGL.
+  SoftwareCompositor* compositor() { return compositor_.get(); }
+
   // -----------------------------------------------------------------------
 
   virtual void setWindowSubtitle(const std::string& cp932str,
@@ -108,6 +117,13 @@ class SDLGraphicsSystem : public GraphicsSystem {
  private:
   void setupVideo();
 
+  // Decodes the image file at |filename|, going through |disk_cache| if it
+  // isn't NULL. Touches nothing but the files, so the ImagePreloader can call
+  // this on its own thread.
+  static DecodedImage* decodeImageFile(
+      const boost::shared_ptr<ImageDiskCache>& disk_cache,
+      const boost::filesystem::path& filename);
+
   /**
    * @name Internal Error Checking Methods
    *
@@ -136,6 +152,9 @@ class SDLGraphicsSystem : public GraphicsSystem {
 
   void setWindowTitle();
 
+  // Finishes the frame in |compositor_| and draws it to the screen.
+  void presentCompositedFrame();
+
   // ---------------------------------------------------------------------
 
   SDL_Surface* screen_;
@@ -185,6 +204,17 @@ class SDLGraphicsSystem : public GraphicsSystem {
   /// OpenGL v1.x drivers.
   int screen_tex_width_;
   int screen_tex_height_;
+
+  // When the Gameexe has __SOFTWARE_COMPOSITOR, surfaces draw into this
+  // instead of issuing OpenGL calls, and each frame reaches the screen as
+  // the changed parts of |compositor_texture_|.
+  boost::scoped_ptr<SoftwareCompositor> compositor_;
+  GLuint compositor_texture_;
+
+  // Decoded images saved between runs (__IMAGE_DISK_CACHE_MB in the
+  // Gameexe). NULL when disabled. Shared with the ImagePreloader's decoder,
+  // which may still be running while we're destroyed.
+  boost::shared_ptr<ImageDiskCache> image_disk_cache_;
 };
 
 
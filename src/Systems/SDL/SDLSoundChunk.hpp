@@ -64,6 +64,9 @@ class SDLSoundChunk : public boost::enable_shared_from_this<SDLSoundChunk> {
   // Fades a chunk in.
   void fadeInChunkOn(int channel, int loops, int ms);
 
+  // Bytes of decoded audio held by the chunk.
+  size_t memoryUsage() const { return sample_ ? sample_->alen : 0; }
+
   // SDL_Mixer callback function passed in to Mix_ChannelFinished().
   static void SoundChunkFinishedPlayback(int channel);
 
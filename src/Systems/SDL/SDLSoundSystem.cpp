@@ -31,6 +31,7 @@
 #include <SDL/SDL_mixer.h>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <ostream>
 #include <sstream>
 #include <string>
 
@@ -40,6 +41,7 @@
 #include "Systems/SDL/SDLMusic.hpp"
 #include "Systems/SDL/SDLSoundChunk.hpp"
 #include "Utilities/Exception.hpp"
+#include "libReallive/gameexe.h"
 
 using boost::shared_ptr;
 using namespace std;
@@ -66,6 +68,16 @@ static RealLiveSoundQualities s_real_live_sound_qualities[] = {
   {48000, AUDIO_S16}    // 48 h_kz, 16 bit stereo
 };
 
+// Default budget for each of the sound effect and wavPlay() caches. A second
+// of 44kHz 16 bit stereo audio is about 172KB once decoded.
+static const int kDefaultSoundCacheMB = 16;
+
+static size_t soundCacheBudget(System& system) {
+  return static_cast<size_t>(
+      system.gameexe()("__SOUND_CACHE_MB").to_int(kDefaultSoundCacheMB)) *
+      1024 * 1024;
+}
+
 // -----------------------------------------------------------------------
 // SDLSoundSystem (private)
 // -----------------------------------------------------------------------
@@ -81,7 +93,7 @@ SDLSoundSystem::SDLSoundChunkPtr SDLSoundSystem::getSoundChunk(
     }
 
     sample.reset(new SDLSoundChunk(file_path));
-    cache.insert(file_name, sample);
+    cache.insert(file_name, sample, sample->memoryUsage());
   }
 
   return sample;
@@ -133,7 +145,9 @@ boost::shared_ptr<SDLMusic> SDLSoundSystem::LoadMusic(
 // SDLSoundSystem
 // -----------------------------------------------------------------------
 SDLSoundSystem::SDLSoundSystem(System& system)
-  : SoundSystem(system), se_cache_(5), wav_cache_(5) {
+  : SoundSystem(system),
+    se_cache_(soundCacheBudget(system)),
+    wav_cache_(soundCacheBudget(system)) {
   SDL_InitSubSystem(SDL_INIT_AUDIO);
 
   /* We're going to be requesting certain things from our audio
@@ -404,6 +418,12 @@ void SDLSoundSystem::reset() {
   SoundSystem::reset();
 }
 
+void SDLSoundSystem::printCacheStatistics(std::ostream& os) const {
+  se_cache_.printStatistics(os, "Sound effect cache");
+  wav_cache_.printStatistics(os, "Wav cache");
+  SoundSystem::printCacheStatistics(os);
+}
+
 void SDLSoundSystem::setMusicHook(
   void (*mix_func)(void *udata, Uint8 *stream, int len)) {
   if (!mix_func)
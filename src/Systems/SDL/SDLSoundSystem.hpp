@@ -29,7 +29,7 @@
 #define SRC_SYSTEMS_SDL_SDLSOUNDSYSTEM_HPP_
 
 #include "Systems/Base/SoundSystem.hpp"
-#include "lru_cache.hpp"
+#include "Utilities/SizedLRUCache.hpp"
 
 #include <string>
 #include <boost/shared_ptr.hpp>
@@ -81,6 +81,8 @@ class SDLSoundSystem : public SoundSystem {
 
   virtual void reset();
 
+  virtual void printCacheStatistics(std::ostream& os) const;
+
   // Wrapper around SDL_mixer's hook function. We do this because we need to
   // have our own default music mixing function which is set at startup.
   void setMusicHook(void (*mix_func)(void *udata, Uint8 *stream, int len));
@@ -88,7 +90,7 @@ class SDLSoundSystem : public SoundSystem {
  private:
   typedef boost::shared_ptr<SDLSoundChunk> SDLSoundChunkPtr;
   typedef boost::shared_ptr<SDLMusic> SDLMusicPtr;
-  typedef LRUCache<std::string, SDLSoundChunkPtr> SoundChunkCache;
+  typedef SizedLRUCache<std::string, SDLSoundChunkPtr> SoundChunkCache;
 
   virtual void koePlayImpl(int id);
 
@@ -119,6 +121,8 @@ class SDLSoundSystem : public SoundSystem {
   // found.
   boost::shared_ptr<SDLMusic> LoadMusic(const std::string& bgm_name);
 
+  // Decoded sound effects and wavPlay() files, each bounded by the memory
+  // their samples use (__SOUND_CACHE_MB in the Gameexe).
   SoundChunkCache se_cache_;
   SoundChunkCache wav_cache_;
 
@@ -35,8 +35,10 @@
 
 #include "base/notification_source.h"
 #include "Systems/Base/Colour.hpp"
+#include "Systems/Base/ColourTransforms.hpp"
 #include "Systems/Base/GraphicsObject.hpp"
 #include "Systems/Base/GraphicsObjectData.hpp"
+#include "Systems/Base/SoftwareCompositor.hpp"
 #include "Systems/Base/SystemError.hpp"
 #include "Systems/SDL/SDLGraphicsSystem.hpp"
 #include "Systems/SDL/SDLUtils.hpp"
@@ -51,133 +53,103 @@ using boost::ptr_vector;
 
 namespace {
 
-// An interface to TransformSurface that maps one color to another.
-class ColourTransformer {
- public:
-  virtual ~ColourTransformer() {}
-  virtual SDL_Color operator()(const SDL_Color& colour) const = 0;
-};
-
-class ToneCurveColourTransformer : public ColourTransformer{
- private:
-	ToneCurveRGBMap colormap;
- public:
-  ToneCurveColourTransformer(const ToneCurveRGBMap m) : colormap(m) {};
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    SDL_Color out = {
-        colormap[0][colour.r],
-        colormap[1][colour.g],
-        colormap[2][colour.b],
-        0
-    };
-    return out;
-  }
-};
-
-class InvertColourTransformer : public ColourTransformer {
- public:
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    SDL_Color out = {
-        255 - colour.r,
-        255 - colour.g,
-        255 - colour.b,
-        0
-    };
-    return out;
-  }
-};
-
-class MonoColourTransformer : public ColourTransformer {
- public:
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    float grayscale = 0.3 * colour.r + 0.59 * colour.g + 0.11 * colour.b;
-    clamp(grayscale, 0, 255);
-    SDL_Color out = {
-        grayscale,
-        grayscale,
-        grayscale,
-        0
-    };
-    return out;
-  }
-};
-
-class ApplyColourTransformer : public ColourTransformer {
- public:
-  explicit ApplyColourTransformer(const RGBColour& colour) : colour_(colour) {
-  }
-
-  int compose(int in_colour, int surface_colour) const {
-    if (in_colour > 0) {
-      return 255 -
-          ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
-            (255 * 255)) * 255);
-    } else if (in_colour < 0) {
-      return (static_cast<float>(abs(in_colour) * surface_colour) /
-              (255 * 255)) * 255;
-    } else {
-      return surface_colour;
-    }
-  }
-
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    SDL_Color out = {
-        compose(colour_.r(), colour.r),
-        compose(colour_.g(), colour.g),
-        compose(colour_.b(), colour.b),
-	0
-    };
-    return out;
-  }
-
- private:
-  RGBColour colour_;
-};
-
-// Applies a |transformer| to every pixel in |area| in the surface |surface|.
+// Applies |kernel| to every pixel in |area| in the surface |surface|.
+template<typename Kernel>
 void TransformSurface(SDLSurface* our_surface, const Rect& area,
-                      const ColourTransformer& transformer) {
-  SDL_Surface* surface = our_surface->rawSurface();
-  SDL_Color colour;
-  Uint32 col = 0;
-
-  // determine position
-  char* p_position = (char*)surface->pixels;
+                      const Kernel& kernel) {
+  Rect clipped = area.intersection(our_surface->rect());
+  if (clipped.width() <= 0 || clipped.height() <= 0)
+    return;
 
-  // offset by y
-  p_position += (surface->pitch * area.y());
+  SDL_Surface* surface = our_surface->rawSurface();
+  const SDL_PixelFormat& format = *surface->format;
 
+  our_surface->aboutToWrite();
   SDL_LockSurface(surface);
-  {
-    for (int y = 0; y < area.height(); ++y) {
-      // advance forward x
-      p_position += (surface->format->BytesPerPixel * area.x());
-
-      for (int x = 0; x < area.width(); ++x) {
-        // copy pixel data
-        memcpy(&col, p_position, surface->format->BytesPerPixel);
-
-        // Before someone tries to simplify the following four lines,
-        // remember that sizeof(int) != sizeof(Uint8).
-        Uint8 alpha;
-        SDL_GetRGBA(col, surface->format, &colour.r, &colour.g, &colour.b, &alpha);
-        SDL_Color out = transformer(colour);
-        Uint32 out_colour = SDL_MapRGBA(surface->format, out.r, out.g, out.b, alpha);
-
-        memcpy(p_position, &out_colour, surface->format->BytesPerPixel);
-
-        p_position += surface->format->BytesPerPixel;
+  char* row = static_cast<char*>(surface->pixels) +
+              surface->pitch * clipped.y() +
+              format.BytesPerPixel * clipped.x();
+  if (format.BytesPerPixel == 4 && format.Rloss == 0 && format.Gloss == 0 &&
+      format.Bloss == 0) {
+    // Every surface we build is like this.
+    PixelLayout layout(format.Rshift, format.Gshift, format.Bshift,
+                       format.Rmask | format.Gmask | format.Bmask);
+    for (int y = 0; y < clipped.height(); ++y, row += surface->pitch) {
+      TransformRow(reinterpret_cast<Uint32*>(row), clipped.width(), layout,
+                   kernel);
+    }
+  } else {
+    for (int y = 0; y < clipped.height(); ++y, row += surface->pitch) {
+      char* p_position = row;
+      for (int x = 0; x < clipped.width(); ++x) {
+        // Before someone tries to simplify the following, remember that
+        // sizeof(int) != sizeof(Uint8).
+        Uint32 col = 0;
+        memcpy(&col, p_position, format.BytesPerPixel);
+
+        Uint8 r, g, b, alpha;
+        SDL_GetRGBA(col, surface->format, &r, &g, &b, &alpha);
+        kernel(r, g, b);
+        Uint32 out_colour = SDL_MapRGBA(surface->format, r, g, b, alpha);
+
+        memcpy(p_position, &out_colour, format.BytesPerPixel);
+        p_position += format.BytesPerPixel;
       }
-
-      // advance forward image_width - area.width() - x
-      int advance = surface->w - area.x() - area.width();
-      p_position += (surface->format->BytesPerPixel * advance);
     }
   }
   SDL_UnlockSurface(surface);
 
   // If we are the main screen, then we want to update the screen
-  our_surface->markWrittenTo(our_surface->rect());
+  our_surface->markWrittenTo(clipped);
+}
+
+// Once a surface has this many separate dirty areas, they're all folded into
+// one rectangle.
+const size_t kMaxDirtyRectangles = 8;
+
+int area(const Rect& rect) {
+  return rect.width() * rect.height();
+}
+
+// Adds |rect| to |rects|, merging it with any rectangle where the merged
+// rectangle would cover little more than the two pieces. A run of glyphs
+// along a line collapses into one strip this way.
+void addDirtyRectangle(std::vector<Rect>& rects, Rect rect) {
+  if (rect.isEmpty())
+    return;
+
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (std::vector<Rect>::iterator it = rects.begin(); it != rects.end();
+         ++it) {
+      Rect u = it->rectUnion(rect);
+      int pieces = area(*it) + area(rect);
+      if (area(u) <= pieces + pieces / 4) {
+        rect = u;
+        rects.erase(it);
+        merged = true;
+        break;
+      }
+    }
+  }
+
+  if (rects.size() >= kMaxDirtyRectangles) {
+    for (std::vector<Rect>::const_iterator it = rects.begin();
+         it != rects.end(); ++it) {
+      rect = rect.rectUnion(*it);
+    }
+    rects.clear();
+  }
+
+  rects.push_back(rect);
+}
+
+// Returns a number that no surface has used yet, so the SoftwareCompositor
+// can tell when a surface's pixels have changed.
+boost::uint64_t NewGeneration() {
+  static boost::uint64_t generation = 0;
+  return ++generation;
 }
 
 }  // namespace
@@ -232,14 +204,18 @@ SDLSurface::TextureRecord::TextureRecord(
 // -----------------------------------------------------------------------
 
 void SDLSurface::TextureRecord::reupload(SDL_Surface* surface,
-                                         const Rect& dirty) {
+                                         const std::vector<Rect>& dirty) {
   if (texture) {
-    Rect i = Rect::REC(x_, y_, w_, h_).intersection(dirty);
-    if (!i.isEmpty()) {
-      texture->reupload(surface,
-                        i.x() - x_, i.y() - y_,
-                        i.x(), i.y(), i.width(), i.height(),
-                        bytes_per_pixel_, byte_order_, byte_type_);
+    Rect bounds = Rect::REC(x_, y_, w_, h_);
+    for (std::vector<Rect>::const_iterator it = dirty.begin();
+         it != dirty.end(); ++it) {
+      Rect i = bounds.intersection(*it);
+      if (!i.isEmpty()) {
+        texture->reupload(surface,
+                          i.x() - x_, i.y() - y_,
+                          i.x(), i.y(), i.width(), i.height(),
+                          bytes_per_pixel_, byte_order_, byte_type_);
+      }
     }
   } else {
     texture.reset(new Texture(surface, x_, y_, w_, h_, bytes_per_pixel_,
@@ -259,7 +235,8 @@ void SDLSurface::TextureRecord::forceUnload() {
 
 SDLSurface::SDLSurface(SDLGraphicsSystem* system)
     : surface_(NULL), texture_is_valid_(false), is_dc0_(false),
-      graphics_system_(system), is_mask_(false) {
+      graphics_system_(system), is_mask_(false),
+      generation_(NewGeneration()) {
   registerForNotification(system);
 }
 
@@ -267,7 +244,7 @@ SDLSurface::SDLSurface(SDLGraphicsSystem* system)
 
 SDLSurface::SDLSurface(SDLGraphicsSystem* system, SDL_Surface* surf)
   : surface_(surf), texture_is_valid_(false), is_dc0_(false),
-    graphics_system_(system), is_mask_(false) {
+    graphics_system_(system), is_mask_(false), generation_(NewGeneration()) {
   buildRegionTable(Size(surf->w, surf->h));
   registerForNotification(system);
 }
@@ -279,7 +256,7 @@ SDLSurface::SDLSurface(SDLGraphicsSystem* system, SDL_Surface* surf,
                        const vector<SDLSurface::GrpRect>& region_table)
   : surface_(surf), region_table_(region_table),
     texture_is_valid_(false), is_dc0_(false), graphics_system_(system),
-    is_mask_(false) {
+    is_mask_(false), generation_(NewGeneration()) {
   registerForNotification(system);
 }
 
@@ -287,7 +264,7 @@ SDLSurface::SDLSurface(SDLGraphicsSystem* system, SDL_Surface* surf,
 
 SDLSurface::SDLSurface(SDLGraphicsSystem* system, const Size& size)
   : surface_(NULL), texture_is_valid_(false), is_dc0_(false),
-    graphics_system_(system), is_mask_(false) {
+    graphics_system_(system), is_mask_(false), generation_(NewGeneration()) {
   allocate(size);
   buildRegionTable(size);
   registerForNotification(system);
@@ -338,6 +315,26 @@ Size SDLSurface::size() const {
 
 // -----------------------------------------------------------------------
 
+size_t SDLSurface::memoryUsage() const {
+  if (!surface_)
+    return 0;
+
+  size_t pixels = static_cast<size_t>(surface_->pitch) * surface_->h;
+
+  size_t textures = 0;
+  for (std::vector<TextureRecord>::const_iterator it = textures_.begin();
+       it != textures_.end(); ++it) {
+    if (it->texture)
+      textures += it->texture->memoryUsage();
+  }
+
+  // Images are usually put in the cache right before they're first drawn, so
+  // until the textures exist, assume they'll cost as much as the pixels.
+  return pixels + (textures ? textures : pixels);
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::dump() {
   static int count = 0;
   ostringstream ss;
@@ -368,6 +365,7 @@ void SDLSurface::allocate(const Size& size, bool is_dc0) {
 void SDLSurface::deallocate() {
   textures_.clear();
   if (surface_) {
+    aboutToWrite();
     SDL_FreeSurface(surface_);
     surface_ = NULL;
   }
@@ -382,6 +380,7 @@ void SDLSurface::blitToSurface(Surface& dest_surface,
                                const Rect& src, const Rect& dst,
                                int alpha, bool use_src_alpha) const {
   SDLSurface& sdl_dest_surface = dynamic_cast<SDLSurface&>(dest_surface);
+  sdl_dest_surface.aboutToWrite();
 
   SDL_Rect src_rect, dest_rect;
   RectToSDLRect(src, &src_rect);
@@ -434,6 +433,8 @@ void SDLSurface::blitToSurface(Surface& dest_surface,
 void SDLSurface::blitFROMSurface(SDL_Surface* src_surface,
                                  const Rect& src, const Rect& dst,
                                  int alpha, bool use_src_alpha) {
+  aboutToWrite();
+
   SDL_Rect src_rect, dest_rect;
   RectToSDLRect(src, &src_rect);
   RectToSDLRect(dst, &dest_rect);
@@ -508,6 +509,16 @@ static void determineProperties(
 // -----------------------------------------------------------------------
 
 void SDLSurface::uploadTextureIfNeeded() const {
+  // Small textures live in a TextureAtlas page, which may have been handed
+  // to other images since we last drew. Those have to be uploaded again.
+  for (std::vector<TextureRecord>::iterator it = textures_.begin();
+       it != textures_.end(); ++it) {
+    if (it->texture && it->texture->evicted()) {
+      it->forceUnload();
+      texture_is_valid_ = false;
+    }
+  }
+
   if (!texture_is_valid_) {
     if (textures_.size() == 0) {
       GLenum bytes_per_pixel;
@@ -541,10 +552,11 @@ void SDLSurface::uploadTextureIfNeeded() const {
     } else {
       // Reupload the textures without reallocating them.
       for_each(textures_.begin(), textures_.end(),
-               bind(&TextureRecord::reupload, _1, surface_, dirty_rectangle_));
+               bind(&TextureRecord::reupload, _1, surface_,
+                    boost::cref(dirty_rectangles_)));
     }
 
-    dirty_rectangle_ = Rect();
+    dirty_rectangles_.clear();
     texture_is_valid_ = true;
   }
 }
@@ -552,6 +564,13 @@ void SDLSurface::uploadTextureIfNeeded() const {
 // -----------------------------------------------------------------------
 
 void SDLSurface::renderToScreen(const Rect& src, const Rect& dst, int alpha) const {
+  SoftwareCompositor* compositor = recordingCompositor();
+  if (compositor) {
+    compositor->drawObject(compositorSource(), src, dst, alpha, 0, 0, Point(),
+                           CompositorEffects());
+    return;
+  }
+
   uploadTextureIfNeeded();
 
   for (vector<TextureRecord>::iterator it = textures_.begin();
@@ -564,6 +583,12 @@ void SDLSurface::renderToScreen(const Rect& src, const Rect& dst, int alpha) con
 
 void SDLSurface::renderToScreenAsColorMask(
   const Rect& src, const Rect& dst, const RGBAColour& rgba, int filter) const {
+  SoftwareCompositor* compositor = recordingCompositor();
+  if (compositor) {
+    compositor->drawColourMask(compositorSource(), src, dst, rgba, filter);
+    return;
+  }
+
   uploadTextureIfNeeded();
 
   for (vector<TextureRecord>::iterator it = textures_.begin();
@@ -576,6 +601,12 @@ void SDLSurface::renderToScreenAsColorMask(
 
 void SDLSurface::renderToScreen(const Rect& src, const Rect& dst,
                                 const int opacity[4]) const {
+  SoftwareCompositor* compositor = recordingCompositor();
+  if (compositor) {
+    compositor->drawImage(compositorSource(), src, dst, opacity);
+    return;
+  }
+
   uploadTextureIfNeeded();
 
   for (vector<TextureRecord>::iterator it = textures_.begin();
@@ -588,6 +619,19 @@ void SDLSurface::renderToScreen(const Rect& src, const Rect& dst,
 
 void SDLSurface::renderToScreenAsObject(
   const GraphicsObject& rp, const Rect& src, const Rect& dst, int alpha) const {
+  SoftwareCompositor* compositor = recordingCompositor();
+  if (compositor) {
+    // Texture::renderToScreenAsObject() moves the object by its origin
+    // before positioning it.
+    Rect moved_dst(dst.origin() + Size(rp.xOrigin(), rp.yOrigin()),
+                   dst.size());
+    compositor->drawObject(compositorSource(), src, moved_dst, alpha,
+                           rp.compositeMode(), rp.rotation(),
+                           Point(rp.xRepOrigin(), rp.yRepOrigin()),
+                           CompositorEffects(rp));
+    return;
+  }
+
   uploadTextureIfNeeded();
 
   for (vector<TextureRecord>::iterator it = textures_.begin();
@@ -602,6 +646,7 @@ void SDLSurface::fill(const RGBAColour& colour) {
   // Fill the entire surface with the incoming colour
   Uint32 sdl_colour = MapRGBA(surface_->format, colour);
 
+  aboutToWrite();
   if (SDL_FillRect(surface_, NULL, sdl_colour))
     reportSDLError("SDL_FillRect", "SDLGrpahicsSystem::wipe()");
 
@@ -618,6 +663,7 @@ void SDLSurface::fill(const RGBAColour& colour, const Rect& area) {
   SDL_Rect rect;
   RectToSDLRect(area, &rect);
 
+  aboutToWrite();
   if (SDL_FillRect(surface_, &rect, sdl_colour))
     reportSDLError("SDL_FillRect", "SDLGrpahicsSystem::wipe()");
 
@@ -628,31 +674,27 @@ void SDLSurface::fill(const RGBAColour& colour, const Rect& area) {
 // -----------------------------------------------------------------------
 
 void SDLSurface::invert(const Rect& rect) {
-  InvertColourTransformer inverter;
-  TransformSurface(this, rect, inverter);
+  TransformSurface(this, rect, InvertKernel());
 }
 
 // -----------------------------------------------------------------------
 
 void SDLSurface::mono(const Rect& rect) {
-  MonoColourTransformer mono;
-  TransformSurface(this, rect, mono);
+  TransformSurface(this, rect, MonoKernel());
 }
 
 
 // -----------------------------------------------------------------------
 
 void SDLSurface::toneCurve(const ToneCurveRGBMap effect, const Rect& area) {
-  ToneCurveColourTransformer tc(effect);
-  TransformSurface(this, area, tc);
+  TransformSurface(this, area, ToneCurveKernel(effect));
 }
 
 
 // -----------------------------------------------------------------------
 
 void SDLSurface::applyColour(const RGBColour& colour, const Rect& area) {
-  ApplyColourTransformer apply(colour);
-  TransformSurface(this, area, apply);
+  TransformSurface(this, area, ApplyColourKernel(colour));
 }
 
 // -----------------------------------------------------------------------
@@ -786,17 +828,57 @@ boost::shared_ptr<Surface> SDLSurface::clipAsColorMask(
 
 // -----------------------------------------------------------------------
 
+void SDLSurface::aboutToWrite() {
+  SoftwareCompositor* compositor = recordingCompositor();
+  if (compositor && surface_)
+    compositor->sourceChanging(static_cast<Uint32*>(surface_->pixels));
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::markWrittenTo(const Rect& written_rect) {
+  generation_ = NewGeneration();
+
   // If we are marked as dc0, alert the SDLGraphicsSystem.
   if (is_dc0_ && graphics_system_) {
     graphics_system_->markScreenAsDirty(GUT_DRAW_DC0);
   }
 
   // Mark that the texture needs reuploading
-  dirty_rectangle_ = dirty_rectangle_.rectUnion(written_rect);
+  addDirtyRectangle(dirty_rectangles_, written_rect);
   texture_is_valid_ = false;
 }
 
+SoftwareCompositor* SDLSurface::recordingCompositor() const {
+  if (!graphics_system_)
+    return NULL;
+
+  SoftwareCompositor* compositor = graphics_system_->compositor();
+  return compositor && compositor->inFrame() ? compositor : NULL;
+}
+
+// -----------------------------------------------------------------------
+
+CompositorSource SDLSurface::compositorSource() const {
+  // Every surface rlvm builds or loads is 32 bit; see buildNewSurface().
+  assert(surface_->format->BytesPerPixel == 4);
+
+  CompositorSource source;
+  source.pixels = static_cast<const Uint32*>(surface_->pixels);
+  source.pitch = surface_->pitch / 4;
+  source.size = Size(surface_->w, surface_->h);
+  source.r_shift = surface_->format->Rshift;
+  source.g_shift = surface_->format->Gshift;
+  source.b_shift = surface_->format->Bshift;
+  source.a_shift = surface_->format->Ashift;
+  source.has_alpha = surface_->format->Amask != 0;
+  source.is_mask = is_mask_;
+  source.generation = generation_;
+  return source;
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::Observe(NotificationType type,
                          const NotificationSource& source,
                          const NotificationDetails& details) {
@@ -807,7 +889,7 @@ void SDLSurface::Observe(NotificationType type,
       it->forceUnload();
     }
 
-    dirty_rectangle_ = rect();
+    dirty_rectangles_.assign(1, rect());
   }
 
   texture_is_valid_ = false;
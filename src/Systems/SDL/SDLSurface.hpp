@@ -30,6 +30,7 @@
 
 #include <vector>
 
+#include <boost/cstdint.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 
@@ -38,7 +39,9 @@
 #include "Systems/Base/Surface.hpp"
 #include "Systems/Base/ToneCurve.hpp"
 
+struct CompositorSource;
 struct SDL_Surface;
+class SoftwareCompositor;
 class Texture;
 class GraphicsSystem;
 class SDLGraphicsSystem;
@@ -80,7 +83,7 @@ class SDLSurface : public Surface,
      * Reuploads this current piece of surface from the supplied
      * surface without allocating a new texture.
      */
-    void reupload(SDL_Surface* surface, const Rect& dirty);
+    void reupload(SDL_Surface* surface, const std::vector<Rect>& dirty);
 
     /// Clears |texture|. Called before a switch between windowed and
     /// fullscreen mode, so that we aren't holding stale references.
@@ -109,8 +112,10 @@ class SDLSurface : public Surface,
   mutable bool texture_is_valid_;
 
   /// When a chunk of the surface is invalidated, we only want to upload the
-  /// smallest possible area, but for simplicity, we only keep one dirty area.
-  mutable Rect dirty_rectangle_;
+  /// smallest possible area. Writes that touch or overlap are merged, but
+  /// separate areas (a new glyph and the cursor, say) stay separate so we
+  /// don't upload everything between them.
+  mutable std::vector<Rect> dirty_rectangles_;
 
   /// Whether this surface is DC0 and needs special treatment.
   bool is_dc0_;
@@ -129,6 +134,18 @@ class SDLSurface : public Surface,
 
   bool is_mask_;
 
+  /// Changes every time surface_ is written to. Used by the
+  /// SoftwareCompositor to skip redrawing parts of the screen that show
+  /// the same pixels as last frame.
+  boost::uint64_t generation_;
+
+  /// Returns the SDLGraphicsSystem's SoftwareCompositor if it is recording
+  /// a frame, in which case we draw through it instead of OpenGL.
+  SoftwareCompositor* recordingCompositor() const;
+
+  /// Describes surface_ to the SoftwareCompositor.
+  CompositorSource compositorSource() const;
+
   NotificationRegistrar registrar_;
 
   static std::vector<int> segmentPicture(int size_remainging);
@@ -207,6 +224,7 @@ class SDLSurface : public Surface,
   // -----------------------------------------------------------------------
 
   virtual Size size() const;
+  virtual size_t memoryUsage() const;
 
   virtual void fill(const RGBAColour& colour);
   virtual void fill(const RGBAColour& colour, const Rect& area);
@@ -226,6 +244,11 @@ class SDLSurface : public Surface,
 
   void interpretAsColorMask(int r, int g, int b, int alpha);
 
+  // Called before each change to surface_. If the SoftwareCompositor has
+  // recorded draws from our pixels this frame, they're rasterized now,
+  // while the pixels still hold what was drawn.
+  void aboutToWrite();
+
   // Called after each change to surface_. Marks the texture as
   // invalid and notifies SDLGraphicsSystem when appropriate.
   void markWrittenTo(const Rect& written_rect);
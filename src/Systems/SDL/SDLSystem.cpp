@@ -116,10 +116,15 @@ void SDLSystem::run(RLMachine& machine) {
   if (sleep_time > max_time)
     sleep_time = max_time;
 
-  if (!forceFastForward() && sleep_time) {
+  // Don't wait between ticks while skipping read text; nothing is drawn so
+  // there's nothing to pace.
+  if (!forceFastForward() && !text_system_->renderingSuppressed() &&
+      sleep_time) {
     event_system_->wait(sleep_time);
-    setForceWait(false);
   }
+
+  // Whether or not we slept, this tick has dealt with the request.
+  setForceWait(false);
 }
 
 // -----------------------------------------------------------------------
@@ -39,6 +39,7 @@
 #include "Utilities/algoplus.hpp"
 #include "Utilities/findFontFile.h"
 #include "libReallive/gameexe.h"
+#include "utf8cpp/utf8.h"
 
 #include <boost/bind.hpp>
 #include <SDL/SDL_ttf.h>
@@ -51,6 +52,12 @@
 using namespace std;
 using namespace boost;
 
+// Number of entries in an advance table; one for every BMP codepoint.
+static const int kCodepointCount = 0x10000;
+
+// Marks advance table entries that haven't been measured yet.
+static const int16_t kUnmeasuredAdvance = -1;
+
 SDLTextSystem::SDLTextSystem(SDLSystem& system, Gameexe& gameexe)
     : TextSystem(system, gameexe), sdl_system_(system) {
   if (TTF_Init() == -1) {
@@ -86,53 +93,104 @@ Size SDLTextSystem::renderGlyphOnto(
     const boost::shared_ptr<Surface>& destination) {
   SDLSurface* sdl_surface = static_cast<SDLSurface*>(destination.get());
 
-  boost::shared_ptr<TTF_Font> font = getFontOfSize(font_size);
+  Point insertion(insertion_point_x, insertion_point_y);
+
+  // The shadow goes down first so the glyph is drawn over it. Each glyph is
+  // blitted as soon as it's looked up since inserting another one may
+  // invalidate its place in the cache.
+  if (shadow_colour && sdl_system_.text().fontShadow()) {
+    SDLGlyphCache::Glyph shadow;
+    if (findOrRenderGlyph(current, font_size, *shadow_colour, shadow)) {
+      sdl_surface->blitFROMSurface(
+          shadow.page, shadow.rect,
+          Rect(insertion + Point(2, 2), shadow.rect.size()), 255);
+    }
+  }
+
+  SDLGlyphCache::Glyph character;
+  if (!findOrRenderGlyph(current, font_size, font_colour, character))
+    return Size(0, 0);
+
+  Size size = character.rect.size();
+  sdl_surface->blitFROMSurface(
+      character.page, character.rect, Rect(insertion, size), 255);
+  return size;
+}
+
+int SDLTextSystem::charWidth(int size, uint16_t codepoint) {
+  return lookupAdvance(getAdvanceTable(size), size, codepoint);
+}
+
+int SDLTextSystem::charWidths(int size, const std::string& utf8str,
+                              std::vector<int>& widths) {
+  AdvanceTable& table = getAdvanceTable(size);
+
+  int total = 0;
+  string::const_iterator it = utf8str.begin();
+  string::const_iterator strend = utf8str.end();
+  while (it != strend) {
+    int w = lookupAdvance(table, size, utf8::next(it, strend));
+    widths.push_back(w);
+    total += w;
+  }
+
+  return total;
+}
+
+void SDLTextSystem::printCacheStatistics(std::ostream& os) const {
+  glyph_cache_.printStatistics(os);
+}
+
+bool SDLTextSystem::findOrRenderGlyph(const std::string& current,
+                                      int font_size,
+                                      const RGBColour& colour,
+                                      SDLGlyphCache::Glyph& out) {
+  if (glyph_cache_.find(font_size, colour, current, out))
+    return true;
 
-  // TODO: Glyphs go in a cache?
   SDL_Color sdl_colour;
-  RGBColourToSDLColor(font_colour, &sdl_colour);
-  boost::shared_ptr<SDL_Surface> character(
+  RGBColourToSDLColor(colour, &sdl_colour);
+  boost::shared_ptr<TTF_Font> font = getFontOfSize(font_size);
+  boost::shared_ptr<SDL_Surface> rendered(
       TTF_RenderUTF8_Blended(font.get(), current.c_str(), sdl_colour),
       SDL_FreeSurface);
 
-  if (character == NULL) {
+  if (rendered == NULL) {
     // Bug during Kyou's path. The string is printed "". Regression in parser?
     cerr << "WARNING. TTF_RenderUTF8_Blended didn't render the character \""
          << current << "\". Hopefully continuing..." << endl;
-    return Size(0, 0);
+    return false;
   }
 
-  boost::shared_ptr<SDL_Surface> shadow;
-  if (shadow_colour && sdl_system_.text().fontShadow()) {
-    SDL_Color sdl_shadow_colour;
-    RGBColourToSDLColor(*shadow_colour, &sdl_shadow_colour);
+  glyph_cache_.insert(font_size, colour, current, rendered.get(), out);
+  return true;
+}
 
-    shadow.reset(
-        TTF_RenderUTF8_Blended(font.get(), current.c_str(), sdl_shadow_colour),
-        SDL_FreeSurface);
+SDLTextSystem::AdvanceTable& SDLTextSystem::getAdvanceTable(int size) {
+  AdvanceTableMap::iterator it = advance_tables_.find(size);
+  if (it == advance_tables_.end()) {
+    it = advance_tables_.insert(
+        std::make_pair(size, AdvanceTable(kCodepointCount,
+                                          kUnmeasuredAdvance))).first;
   }
 
-  Point insertion(insertion_point_x, insertion_point_y);
+  return it->second;
+}
 
-  if (shadow) {
-    Size offset(shadow->w, shadow->h);
-    sdl_surface->blitFROMSurface(
-        shadow.get(), Rect(Point(0, 0), offset),
-        Rect(insertion + Point(2, 2), offset),
-        255);
+int SDLTextSystem::lookupAdvance(AdvanceTable& table, int size,
+                                 uint16_t codepoint) {
+  int16_t& advance = table[codepoint];
+  if (advance == kUnmeasuredAdvance) {
+    boost::shared_ptr<TTF_Font> font = getFontOfSize(size);
+    int minx, maxx, miny, maxy, measured;
+    if (TTF_GlyphMetrics(font.get(), codepoint,
+                         &minx, &maxx, &miny, &maxy, &measured) == 0) {
+      advance = measured;
+    } else {
+      advance = 0;
+    }
   }
 
-  Size size(character->w, character->h);
-  sdl_surface->blitFROMSurface(
-      character.get(), Rect(Point(0, 0), size), Rect(insertion, size), 255);
-  return size;
-}
-
-int SDLTextSystem::charWidth(int size, uint16_t codepoint) {
-  boost::shared_ptr<TTF_Font> font = getFontOfSize(size);
-  int minx, maxx, miny, maxy, advance;
-  TTF_GlyphMetrics(font.get(), codepoint,
-                   &minx, &maxx, &miny, &maxy, &advance);
   return advance;
 }
 
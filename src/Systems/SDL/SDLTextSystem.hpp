@@ -30,11 +30,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/ptr_container/ptr_map.hpp>
 #include <SDL/SDL_ttf.h>
 
 #include "Systems/Base/TextSystem.hpp"
+#include "Systems/SDL/SDLGlyphCache.hpp"
 
 class Point;
 class RLMachine;
@@ -58,15 +60,41 @@ class SDLTextSystem : public TextSystem {
       int insertion_point_y,
       const boost::shared_ptr<Surface>& destination);
   virtual int charWidth(int size, uint16_t codepoint);
+  virtual int charWidths(int size, const std::string& utf8str,
+                         std::vector<int>& widths);
+  virtual void printCacheStatistics(std::ostream& os) const;
 
   // Returns (and caches) a SDL_ttf font object for a font of |size|.
   boost::shared_ptr<TTF_Font> getFontOfSize(int size);
 
  private:
+  // Fills |out| with the location of |current| in the glyph cache, rendering
+  // it with SDL_ttf first if it isn't there. Returns false if SDL_ttf
+  // couldn't render it.
+  bool findOrRenderGlyph(const std::string& current, int font_size,
+                         const RGBColour& colour, SDLGlyphCache::Glyph& out);
+
+  // Advance widths for every BMP codepoint at one font size. Entries are
+  // filled in from TTF_GlyphMetrics the first time they're asked for.
+  typedef std::vector<int16_t> AdvanceTable;
+  typedef std::map<int, AdvanceTable> AdvanceTableMap;
+
+  // Returns the advance table for |size|, creating an empty one if needed.
+  AdvanceTable& getAdvanceTable(int size);
+
+  // Returns the width of |codepoint| from |table|, measuring it first if this
+  // is the first time it's been asked for.
+  int lookupAdvance(AdvanceTable& table, int size, uint16_t codepoint);
+
   // Font storage.
   typedef std::map< int , boost::shared_ptr<TTF_Font> > FontSizeMap;
   FontSizeMap map_;
 
+  AdvanceTableMap advance_tables_;
+
+  // Rendered glyphs, so repeated characters skip FreeType.
+  SDLGlyphCache glyph_cache_;
+
   SDLSystem& sdl_system_;
 };
 
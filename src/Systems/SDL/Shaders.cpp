@@ -27,6 +27,7 @@
 #include "GL/glew.h"
 
 #include <iostream>
+#include <string>
 
 #include "Systems/Base/GraphicsObject.hpp"
 #include "Systems/Base/SystemError.hpp"
@@ -49,15 +50,9 @@ const char kColorMaskShader[] =
     "                     0.0, 1.0);"
     "}";
 
-const char kObjectShader[] =
-    "uniform sampler2D image;\n"
-    "uniform vec4 colour;\n"
-    "uniform float mono;\n"
-    "uniform float invert;\n"
-    "uniform float light;\n"
-    "uniform vec3 tint;\n"
-    "uniform float alpha;\n"
-    "\n"
+// RealLive's colour/mono/invert/light/tint effects, shared by the object
+// programs below.
+const char kObjectEffects[] =
     "void tinter(in float pixel_val, in float tint_val, out float mixed) {\n"
     "  if (tint_val > 0.0) {\n"
     "    mixed = pixel_val + tint_val - (pixel_val * tint_val);\n"
@@ -68,9 +63,8 @@ const char kObjectShader[] =
     "  }\n"
     "}\n"
     "\n"
-    "void main() {\n"
-    "  vec4 pixel = texture2D(image, gl_TexCoord[0].st);\n"
-    "\n"
+    "vec4 applyEffects(in vec4 pixel, in vec4 colour, in float mono,\n"
+    "                  in float invert, in float light, in vec3 tint) {\n"
     "  // The colour is blended directly with the incoming pixel value.\n"
     "  vec3 coloured = mix(pixel.rgb, colour.rgb, colour.a);\n"
     "  pixel = vec4(coloured.r, coloured.g, coloured.b, pixel.a);\n"
@@ -97,13 +91,44 @@ const char kObjectShader[] =
     "  tinter(pixel.r, tint.r, out_r);\n"
     "  tinter(pixel.g, tint.g, out_g);\n"
     "  tinter(pixel.b, tint.b, out_b);\n"
-    "  pixel = vec4(out_r, out_g, out_b, pixel.a);\n"
+    "  return vec4(out_r, out_g, out_b, pixel.a);\n"
+    "}\n"
+    "\n";
+
+const char kObjectShader[] =
+    "uniform sampler2D image;\n"
+    "uniform vec4 colour;\n"
+    "uniform float mono;\n"
+    "uniform float invert;\n"
+    "uniform float light;\n"
+    "uniform vec3 tint;\n"
+    "uniform float alpha;\n"
+    "\n"
+    "void main() {\n"
+    "  vec4 pixel = applyEffects(texture2D(image, gl_TexCoord[0].st),\n"
+    "                            colour, mono, invert, light, tint);\n"
     "\n"
     "  // We're responsible for doing the main alpha blending, too.\n"
     "  pixel.a = pixel.a * alpha;\n"
     "  gl_FragColor = pixel;\n"
     "}\n";
 
+// The same effects, read from the texture coordinates that RenderQueue
+// fills in for each vertex so objects with different effects can share a
+// draw call: colour in unit 1, tint and light in unit 2, and mono and
+// invert in unit 3. The alpha comes in the primary colour.
+const char kBatchedObjectShader[] =
+    "uniform sampler2D image;\n"
+    "\n"
+    "void main() {\n"
+    "  vec4 pixel = applyEffects(texture2D(image, gl_TexCoord[0].st),\n"
+    "                            gl_TexCoord[1], gl_TexCoord[3].s,\n"
+    "                            gl_TexCoord[3].t, gl_TexCoord[2].a,\n"
+    "                            gl_TexCoord[2].rgb);\n"
+    "  pixel.a = pixel.a * gl_Color.a;\n"
+    "  gl_FragColor = pixel;\n"
+    "}\n";
+
 } // namespace
 
 GLuint Shaders::color_mask_program_object_id_ = 0;
@@ -111,6 +136,10 @@ GLuint Shaders::color_mask_shader_object_id_= 0;
 GLint Shaders::color_mask_current_values_ = 0;
 GLint Shaders::color_mask_mask_ = 0;
 
+GLuint Shaders::batched_object_program_object_id_ = 0;
+GLuint Shaders::batched_object_shader_object_id_ = 0;
+GLint Shaders::batched_object_image_ = 0;
+
 GLuint Shaders::object_program_object_id_ = 0;
 GLuint Shaders::object_shader_object_id_ = 0;
 GLint Shaders::object_image_ = 0;
@@ -156,7 +185,8 @@ GLint Shaders::getColorMaskUniformMask() {
 
 GLuint Shaders::getObjectProgram() {
   if (object_program_object_id_ == 0) {
-    buildShader(kObjectShader,
+    std::string source = std::string(kObjectEffects) + kObjectShader;
+    buildShader(source.c_str(),
                 &object_shader_object_id_,
                 &object_program_object_id_);
   }
@@ -175,6 +205,28 @@ GLint Shaders::getObjectUniformImage() {
   return object_image_;
 }
 
+GLuint Shaders::getBatchedObjectProgram() {
+  if (batched_object_program_object_id_ == 0) {
+    std::string source = std::string(kObjectEffects) + kBatchedObjectShader;
+    buildShader(source.c_str(),
+                &batched_object_shader_object_id_,
+                &batched_object_program_object_id_);
+  }
+
+  return batched_object_program_object_id_;
+}
+
+GLint Shaders::getBatchedObjectUniformImage() {
+  if (batched_object_image_ == 0) {
+    batched_object_image_ = glGetUniformLocationARB(
+        getBatchedObjectProgram(), "image");
+    if (batched_object_image_ == -1)
+      throw SystemError("Bad uniform value: image");
+  }
+
+  return batched_object_image_;
+}
+
 void Shaders::loadObjectUniformFromGraphicsObject(const GraphicsObject& go) {
   RGBAColour colour = go.colour();
   glUniform4fARB(Shaders::getObjectUniformColour(),
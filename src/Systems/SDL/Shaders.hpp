@@ -57,6 +57,12 @@ class Shaders {
   static GLint getObjectUniformMono();
   static GLint getObjectUniformInvert();
 
+  // Returns the shader that implements the same effects as the object
+  // program, taking them per vertex from the texture coordinates of units 1
+  // through 3 instead of from uniforms. Used by RenderQueue.
+  static GLuint getBatchedObjectProgram();
+  static GLint getBatchedObjectUniformImage();
+
  private:
   // Compiles and links the text program in |shader| into a shader and program
   // object.
@@ -69,6 +75,10 @@ class Shaders {
   static GLint color_mask_current_values_;
   static GLint color_mask_mask_;
 
+  static GLuint batched_object_program_object_id_;
+  static GLuint batched_object_shader_object_id_;
+  static GLint batched_object_image_;
+
   static GLuint object_program_object_id_;
   static GLuint object_shader_object_id_;
   static GLint object_image_;
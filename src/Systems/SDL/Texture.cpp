@@ -44,6 +44,7 @@
 #include "Systems/Base/GraphicsObject.hpp"
 #include "Systems/Base/GraphicsObjectData.hpp"
 #include "Systems/Base/SystemError.hpp"
+#include "Systems/SDL/RenderQueue.hpp"
 #include "Systems/SDL/SDLGraphicsSystem.hpp"
 #include "Systems/SDL/SDLSurface.hpp"
 #include "Systems/SDL/SDLUtils.hpp"
@@ -82,7 +83,31 @@ Texture::Texture(SDL_Surface* surface, int x, int y, int w, int h,
     texture_width_(SafeSize(logical_width_)),
     texture_height_(SafeSize(logical_height_)),
     back_texture_id_(0),
+    in_atlas_(false), atlas_page_(NULL), atlas_x_(0), atlas_y_(0),
+    uv_width_(texture_width_), uv_height_(texture_height_),
     is_upside_down_(false) {
+  // Small images that are a whole surface to themselves share a texture
+  // with others.
+  if (w == total_width_ && h == total_height_ && bytes_per_pixel == 4) {
+    in_atlas_ = TextureAtlas::Allocate(this, w, h, &atlas_page_, &texture_id_,
+                                       &atlas_x_, &atlas_y_);
+  }
+
+  if (in_atlas_) {
+    uv_width_ = uv_height_ = TextureAtlas::PageSize();
+
+    SDL_LockSurface(surface);
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH,
+                  surface->pitch / surface->format->BytesPerPixel);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, atlas_x_, atlas_y_, w, h,
+                    byte_order, byte_type, surface->pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    DebugShowGLErrors();
+    SDL_UnlockSurface(surface);
+    return;
+  }
+
   glGenTextures(1, &texture_id_);
   glBindTexture(GL_TEXTURE_2D, texture_id_);
   DebugShowGLErrors();
@@ -143,7 +168,12 @@ Texture::Texture(render_to_texture, int width, int height)
     total_width_(width), total_height_(height),
     texture_width_(0), texture_height_(0), texture_id_(0),
     back_texture_id_(0),
+    in_atlas_(false), atlas_page_(NULL), atlas_x_(0), atlas_y_(0),
+    uv_width_(0), uv_height_(0),
     is_upside_down_(true) {
+  // We copy the screen, so everything queued has to be on it first.
+  RenderQueue::Flush();
+
   glGenTextures(1, &texture_id_);
   glBindTexture(GL_TEXTURE_2D, texture_id_);
   DebugShowGLErrors();
@@ -152,8 +182,8 @@ Texture::Texture(render_to_texture, int width, int height)
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  texture_width_ = SafeSize(logical_width_);
-  texture_height_ = SafeSize(logical_height_);
+  texture_width_ = uv_width_ = SafeSize(logical_width_);
+  texture_height_ = uv_height_ = SafeSize(logical_height_);
 
   // This may fail.
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
@@ -169,7 +199,14 @@ Texture::Texture(render_to_texture, int width, int height)
 // -----------------------------------------------------------------------
 
 Texture::~Texture() {
-  glDeleteTextures(1, &texture_id_);
+  RenderQueue::Flush();
+  if (in_atlas_) {
+    // The texture belongs to the page.
+    if (atlas_page_)
+      TextureAtlas::Release(atlas_page_, this);
+  } else {
+    glDeleteTextures(1, &texture_id_);
+  }
 
   if (back_texture_id_)
     glDeleteTextures(1, &back_texture_id_);
@@ -195,15 +232,35 @@ void Texture::reupload(SDL_Surface* surface,
                        int x, int y, int w, int h,
                        unsigned int bytes_per_pixel, int byte_order,
                        int byte_type) {
+  // Quads already queued must show our old contents.
+  RenderQueue::Flush();
+
   glBindTexture(GL_TEXTURE_2D, texture_id_);
 
   if (w == total_width_ && h == total_height_) {
     SDL_LockSurface(surface);
 
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface->w, surface->h,
+    glTexSubImage2D(GL_TEXTURE_2D, 0, atlas_x_, atlas_y_,
+                    surface->w, surface->h,
                     byte_order, byte_type, surface->pixels);
     DebugShowGLErrors();
 
+    SDL_UnlockSurface(surface);
+  } else if (surface->pitch % surface->format->BytesPerPixel == 0) {
+    // Point GL at the dirty area inside the surface instead of copying it
+    // into the upload buffer first. Small dirty areas, like a single glyph,
+    // upload only their own rows.
+    SDL_LockSurface(surface);
+    char* src = static_cast<char*>(surface->pixels) + surface->pitch * y +
+                surface->format->BytesPerPixel * x;
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH,
+                  surface->pitch / surface->format->BytesPerPixel);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, atlas_x_ + offset_x, atlas_y_ + offset_y,
+                    w, h, byte_order, byte_type, src);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    DebugShowGLErrors();
+
     SDL_UnlockSurface(surface);
   } else {
     // Cut out the current piece
@@ -224,8 +281,8 @@ void Texture::reupload(SDL_Surface* surface,
     }
     SDL_UnlockSurface(surface);
 
-    glTexSubImage2D(GL_TEXTURE_2D, 0, offset_x, offset_y, w, h,
-                    byte_order, byte_type, pixel_data);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, atlas_x_ + offset_x, atlas_y_ + offset_y,
+                    w, h, byte_order, byte_type, pixel_data);
     DebugShowGLErrors();
   }
 }
@@ -271,32 +328,23 @@ void Texture::renderToScreen(const Rect& src, const Rect& dst, int opacity) {
 
   // For the time being, we are dumb and assume that it's one texture
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = float(atlas_x_ + x1) / uv_width_;
+  float thisy1 = float(atlas_y_ + y1) / uv_height_;
+  float thisx2 = float(atlas_x_ + x2) / uv_width_;
+  float thisy2 = float(atlas_y_ + y2) / uv_height_;
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
     thisy2 = float(logical_height_ - y2) / texture_height_;
   }
 
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glBegin(GL_QUADS); {
-    glColor4ub(255, 255, 255, opacity);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
-  }
-  glEnd();
-  glBlendFunc(GL_ONE, GL_ZERO);
+  RenderQueue::Vertex vertices[4];
+  RenderQueue::SetVertex(vertices[0], fdx1, fdy1, thisx1, thisy1, opacity);
+  RenderQueue::SetVertex(vertices[1], fdx2, fdy1, thisx2, thisy1, opacity);
+  RenderQueue::SetVertex(vertices[2], fdx2, fdy2, thisx2, thisy2, opacity);
+  RenderQueue::SetVertex(vertices[3], fdx1, fdy2, thisx1, thisy2, opacity);
+  TextureAtlas::Touch(atlas_page_);
+  RenderQueue::AddQuad(texture_id_, RenderQueue::BLEND_ALPHA, false, vertices);
 }
 
 // -----------------------------------------------------------------------
@@ -309,6 +357,11 @@ void Texture::renderToScreen(const Rect& src, const Rect& dst, int opacity) {
  */
 void Texture::renderToScreenAsColorMask(
   const Rect& src, const Rect& dst, const RGBAColour& rgba, int filter) {
+  // These read back the screen or set their own GL state, so they're drawn
+  // straight away.
+  RenderQueue::Flush();
+  TextureAtlas::Touch(atlas_page_);
+
   if (filter == 0) {
     if (GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
       render_to_screen_as_colour_mask_subtractive_glsl(src, dst, rgba);
@@ -331,16 +384,27 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = float(atlas_x_ + x1) / uv_width_;
+  float thisy1 = float(atlas_y_ + y1) / uv_height_;
+  float thisx2 = float(atlas_x_ + x2) / uv_width_;
+  float thisy2 = float(atlas_y_ + y2) / uv_height_;
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
     thisy2 = float(logical_height_ - y2) / texture_height_;
   }
 
+  // The copy of the screen is laid out like our own image, even when we
+  // are in an atlas page.
+  float backx1 = float(x1) / texture_width_;
+  float backy1 = float(y1) / texture_height_;
+  float backx2 = float(x2) / texture_width_;
+  float backy2 = float(y2) / texture_height_;
+  if (is_upside_down_) {
+    backy1 = thisy1;
+    backy2 = thisy2;
+  }
+
   // If we haven't already, allocate video memory for the back
   // texture.
   //
@@ -390,16 +454,16 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
 
   glBegin(GL_QUADS); {
     glColorRGBA(rgba);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx1, thisy2);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx1, backy2);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx1, thisy1);
     glVertex2i(fdx1, fdy1);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx2, thisy2);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx2, backy2);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx2, thisy1);
     glVertex2i(fdx2, fdy1);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx2, thisy1);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx2, backy1);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx2, thisy2);
     glVertex2i(fdx2, fdy2);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx1, thisy1);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx1, backy1);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx1, thisy2);
     glVertex2i(fdx1, fdy2);
   }
@@ -431,10 +495,10 @@ void Texture::render_to_screen_as_colour_mask_subtractive_fallback(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = float(atlas_x_ + x1) / uv_width_;
+  float thisy1 = float(atlas_y_ + y1) / uv_height_;
+  float thisx2 = float(atlas_x_ + x2) / uv_width_;
+  float thisy2 = float(atlas_y_ + y2) / uv_height_;
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
@@ -475,10 +539,10 @@ void Texture::render_to_screen_as_colour_mask_additive(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = float(atlas_x_ + x1) / uv_width_;
+  float thisy1 = float(atlas_y_ + y1) / uv_height_;
+  float thisx2 = float(atlas_x_ + x2) / uv_width_;
+  float thisy2 = float(atlas_y_ + y2) / uv_height_;
 
   if (is_upside_down_) {
     thisy1 = float(logical_height_ - y1) / texture_height_;
@@ -515,34 +579,24 @@ void Texture::renderToScreen(const Rect& src, const Rect& dst,
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
-
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  float thisx1 = float(atlas_x_ + x1) / uv_width_;
+  float thisy1 = float(atlas_y_ + y1) / uv_height_;
+  float thisx2 = float(atlas_x_ + x2) / uv_width_;
+  float thisy2 = float(atlas_y_ + y2) / uv_height_;
 
   // Blend when we have less opacity
+  RenderQueue::BlendMode blend = RenderQueue::BLEND_COPY;
   if (find_if(opacity, opacity + 4, bind(std::less<int>(), _1, 255))
      != opacity + 4)
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  glBegin(GL_QUADS); {
-    glColor4ub(255, 255, 255, opacity[0]);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glColor4ub(255, 255, 255, opacity[1]);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glColor4ub(255, 255, 255, opacity[2]);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glColor4ub(255, 255, 255, opacity[3]);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
-  }
-  glEnd();
-  glBlendFunc(GL_ONE, GL_ZERO);
+    blend = RenderQueue::BLEND_ALPHA;
+
+  RenderQueue::Vertex vertices[4];
+  RenderQueue::SetVertex(vertices[0], fdx1, fdy1, thisx1, thisy1, opacity[0]);
+  RenderQueue::SetVertex(vertices[1], fdx2, fdy1, thisx2, thisy1, opacity[1]);
+  RenderQueue::SetVertex(vertices[2], fdx2, fdy2, thisx2, thisy2, opacity[2]);
+  RenderQueue::SetVertex(vertices[3], fdx1, fdy2, thisx1, thisy2, opacity[3]);
+  TextureAtlas::Touch(atlas_page_);
+  RenderQueue::AddQuad(texture_id_, blend, false, vertices);
 }
 
 // -----------------------------------------------------------------------
@@ -571,21 +625,20 @@ void Texture::renderToScreenAsObject(
   }
 
   // Convert the pixel coordinates into [0,1) texture coordinates
-  float thisx1 = float(xSrc1) / texture_width_;
-  float thisy1 = float(ySrc1) / texture_height_;
-  float thisx2 = float(xSrc2) / texture_width_;
-  float thisy2 = float(ySrc2) / texture_height_;
-
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  float thisx1 = float(atlas_x_ + xSrc1) / uv_width_;
+  float thisy1 = float(atlas_y_ + ySrc1) / uv_height_;
+  float thisx2 = float(atlas_x_ + xSrc2) / uv_width_;
+  float thisy2 = float(atlas_y_ + ySrc2) / uv_height_;
 
   // Make this so that when we have composite 1, we're doing a pure
   // additive blend, (ignoring the alpha channel?)
+  RenderQueue::BlendMode blend = RenderQueue::BLEND_COPY;
   switch (go.compositeMode()) {
   case 0:
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    blend = RenderQueue::BLEND_ALPHA;
     break;
   case 1:
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    blend = RenderQueue::BLEND_ADDITIVE;
     break;
   case 2: {
     static int displayedWarning = 0;
@@ -602,77 +655,49 @@ void Texture::renderToScreenAsObject(
   }
   }
 
-  glPushMatrix(); {
-    // Move the "origin" to the correct position.
-    glTranslatef(go.xOrigin(), go.yOrigin(), 0);
-
-    // Translate to where the object starts.
-    glTranslatef(fdx1, fdy1, 0);
-
-    int width = fdx2 - fdx1;
-    int height = fdy2 - fdy1;
-
-    // Rotate the texture around the point (origin + position + reporigin)
-    float x_rep = (width / 2.0f) + go.xRepOrigin();
-    float y_rep = (height / 2.0f) + go.yRepOrigin();
-
-    glTranslatef(x_rep, y_rep, 0);
-    glRotatef(float(go.rotation()) / 10, 0, 0, 1);
-    glTranslatef(-x_rep, -y_rep, 0);
-
-    // RealLive has its own complex shading/tinting system which we implement
-    // in a shader if available. It's costly enough that we make sure we need
-    // to use it.
-    bool using_shader = false;
-    if ((go.light() ||
-         go.tint() != RGBColour::Black() ||
-         go.colour() != RGBAColour::Clear() ||
-         go.mono() ||
-         go.invert()) &&
-        GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
-      // Image
-      glActiveTexture(GL_TEXTURE0_ARB);
-      glEnable(GL_TEXTURE_2D);
-      glBindTexture(GL_TEXTURE_2D, texture_id_);
-      glUseProgramObjectARB(Shaders::getObjectProgram());
-      glUniform1iARB(Shaders::getObjectUniformImage(), 0);
-
-      // Colour/Tint/Etc.
-      Shaders::loadObjectUniformFromGraphicsObject(go);
-
-      // Alpha.
-      glUniform1fARB(Shaders::getObjectUniformAlpha(),
-                     alpha / 255.0f);
-
-      // Our final blending color has to be all white here.
-      using_shader = true;
-    } else {
-      // The shader takes care of the alpha for us, so we need to specify when
-      // not using it.
-      glColor4ub(255, 255, 255, alpha);
-    }
-
-    glBegin(GL_QUADS); {
-      glTexCoord2f(thisx1, thisy1);
-      glVertex2i(0, 0);
-      glTexCoord2f(thisx2, thisy1);
-      glVertex2i(width, 0);
-      glTexCoord2f(thisx2, thisy2);
-      glVertex2i(width, height);
-      glTexCoord2f(thisx1, thisy2);
-      glVertex2i(0, height);
-    }
-    glEnd();
-
-    if (using_shader) {
-      glUseProgramObjectARB(0);
-    }
-
-    glBlendFunc(GL_ONE, GL_ZERO);
+  float width = fdx2 - fdx1;
+  float height = fdy2 - fdy1;
+
+  // Rotate the texture around the point (origin + position + reporigin)
+  float x_rep = (width / 2.0f) + go.xRepOrigin();
+  float y_rep = (height / 2.0f) + go.yRepOrigin();
+  float centre_x = go.xOrigin() + fdx1 + x_rep;
+  float centre_y = go.yOrigin() + fdy1 + y_rep;
+
+  float angle = (float(go.rotation()) / 10) * M_PI / 180.0f;
+  float c = go.rotation() ? cos(angle) : 1.0f;
+  float s = go.rotation() ? sin(angle) : 0.0f;
+
+  // RealLive has its own complex shading/tinting system which we implement
+  // in a shader if available. It's costly enough that we make sure we need
+  // to use it.
+  bool using_shader =
+      (go.light() ||
+       go.tint() != RGBColour::Black() ||
+       go.colour() != RGBAColour::Clear() ||
+       go.mono() ||
+       go.invert()) &&
+      GLEW_ARB_fragment_shader && GLEW_ARB_multitexture;
+
+  const float corner_x[4] = { 0, width, width, 0 };
+  const float corner_y[4] = { 0, 0, height, height };
+  const float tex_x[4] = { thisx1, thisx2, thisx2, thisx1 };
+  const float tex_y[4] = { thisy1, thisy1, thisy2, thisy2 };
+
+  RenderQueue::Vertex vertices[4];
+  for (int i = 0; i < 4; ++i) {
+    float x = corner_x[i] - x_rep;
+    float y = corner_y[i] - y_rep;
+    RenderQueue::SetVertex(vertices[i],
+                           centre_x + c * x - s * y,
+                           centre_y + s * x + c * y,
+                           tex_x[i], tex_y[i], alpha);
+    if (using_shader)
+      RenderQueue::SetVertexEffects(vertices[i], go);
   }
-  glPopMatrix();
 
-  DebugShowGLErrors();
+  TextureAtlas::Touch(atlas_page_);
+  RenderQueue::AddQuad(texture_id_, blend, using_shader, vertices);
 }
 
 // -----------------------------------------------------------------------
@@ -32,6 +32,8 @@
 #include <boost/scoped_array.hpp>
 #include <SDL/SDL_opengl.h>
 
+#include "Systems/SDL/TextureAtlas.hpp"
+
 struct SDL_Surface;
 class SDLSurface;
 class GraphicsObject;
@@ -70,6 +72,15 @@ class Texture {
   int height() { return logical_height_; }
   GLuint textureId() { return texture_id_; }
 
+  // Video memory used by the (power of two sized) GL texture.
+  size_t memoryUsage() const {
+    return static_cast<size_t>(texture_width_) * texture_height_ * 4;
+  }
+
+  // Whether our space in a TextureAtlas page was given to someone else. The
+  // owner needs to build a new Texture before drawing again.
+  bool evicted() const { return in_atlas_ && !atlas_page_; }
+
   void renderToScreenAsObject(
     const GraphicsObject& go,
     const SDLSurface& surface,
@@ -85,6 +96,8 @@ class Texture {
                       const int opacity[4]);
 
  private:
+  friend class TextureAtlas;
+
   // Returns a shared buffer of at least size. This is not thread safe
   // or reenterant in the least; it is merely meant to prevent
   // allocations. This is the proper way to access s_upload_buffer,
@@ -118,6 +131,19 @@ class Texture {
 
   GLuint back_texture_id_;
 
+  // Set when we live in a TextureAtlas page instead of our own texture.
+  // |texture_id_| is then the page's texture, our image starts at
+  // (|atlas_x_|, |atlas_y_|) in it, and |atlas_page_| is NULL once evicted.
+  bool in_atlas_;
+  TextureAtlas::Page* atlas_page_;
+  int atlas_x_;
+  int atlas_y_;
+
+  // Size of the GL texture that texture coordinates are relative to: the
+  // page's size if we're in an atlas, otherwise our own.
+  unsigned int uv_width_;
+  unsigned int uv_height_;
+
   /// Is this texture upside down? (Because it's a screenshot, et cetera.)
   bool is_upside_down_;
 
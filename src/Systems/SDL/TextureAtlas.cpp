@@ -0,0 +1,228 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2013 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "GL/glew.h"
+
+#include "Systems/SDL/TextureAtlas.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "Systems/Base/Colour.hpp"
+#include "Systems/Base/Rect.hpp"
+#include "Systems/SDL/RenderQueue.hpp"
+#include "Systems/SDL/SDLUtils.hpp"
+#include "Systems/SDL/Texture.hpp"
+
+namespace {
+
+// Transparent pixels kept around each image so that linear filtering doesn't
+// pull in its neighbours.
+const int kPadding = 1;
+
+// Makes the padding around the |width| by |height| box at (|x|, |y|)
+// transparent, since something else may have been there before.
+void clearPadding(GLuint texture_id, int x, int y, int width, int height) {
+  std::vector<char> zeros(std::max(width, height) * kPadding * 4, 0);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, kPadding,
+                  GL_RGBA, GL_UNSIGNED_BYTE, &zeros[0]);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y + height - kPadding,
+                  width, kPadding, GL_RGBA, GL_UNSIGNED_BYTE, &zeros[0]);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, kPadding, height,
+                  GL_RGBA, GL_UNSIGNED_BYTE, &zeros[0]);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x + width - kPadding, y,
+                  kPadding, height, GL_RGBA, GL_UNSIGNED_BYTE, &zeros[0]);
+  DebugShowGLErrors();
+}
+
+}  // namespace
+
+boost::ptr_vector<TextureAtlas::Page> TextureAtlas::pages_;
+int TextureAtlas::frame_ = 0;
+
+// static
+bool TextureAtlas::Allocate(Texture* texture, int width, int height,
+                            Page** page, GLuint* texture_id, int* x, int* y) {
+  if (width > kMaxPackedSize || height > kMaxPackedSize)
+    return false;
+
+  int box_width = width + 2 * kPadding;
+  int box_height = height + 2 * kPadding;
+
+  Page* target = NULL;
+  for (boost::ptr_vector<Page>::iterator it = pages_.begin();
+       it != pages_.end() && !target; ++it) {
+    if (PackInto(*it, box_width, box_height, x, y))
+      target = &*it;
+  }
+
+  if (!target && pages_.size() < static_cast<size_t>(kMaxPages)) {
+    Page* new_page = new Page;
+    new_page->free_y = 0;
+    new_page->last_used_frame = frame_;
+
+    int size = PageSize();
+    glGenTextures(1, &new_page->texture_id);
+    glBindTexture(GL_TEXTURE_2D, new_page->texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    DebugShowGLErrors();
+
+    pages_.push_back(new_page);
+    if (PackInto(*new_page, box_width, box_height, x, y))
+      target = new_page;
+  }
+
+  if (!target) {
+    // Every page is full. Empty the one that has gone longest without being
+    // drawn from, unless that was this frame; throwing out something that is
+    // still on screen would just make us upload it again.
+    Page* oldest = NULL;
+    for (boost::ptr_vector<Page>::iterator it = pages_.begin();
+         it != pages_.end(); ++it) {
+      if (it->last_used_frame != frame_ &&
+          (!oldest || it->last_used_frame < oldest->last_used_frame))
+        oldest = &*it;
+    }
+
+    if (!oldest)
+      return false;
+
+    Clear(*oldest);
+    if (!PackInto(*oldest, box_width, box_height, x, y))
+      return false;
+    target = oldest;
+  }
+
+  clearPadding(target->texture_id, *x, *y, box_width, box_height);
+  *x += kPadding;
+  *y += kPadding;
+  *page = target;
+  *texture_id = target->texture_id;
+  target->residents.push_back(texture);
+  target->last_used_frame = frame_;
+  return true;
+}
+
+// static
+void TextureAtlas::Release(Page* page, Texture* texture) {
+  std::vector<Texture*>::iterator it =
+      std::find(page->residents.begin(), page->residents.end(), texture);
+  if (it != page->residents.end())
+    page->residents.erase(it);
+
+  // Shelves are only ever appended to, so the space comes back once the
+  // page is empty.
+  if (page->residents.empty()) {
+    page->shelves.clear();
+    page->free_y = 0;
+  }
+}
+
+// static
+void TextureAtlas::Touch(Page* page) {
+  if (page)
+    page->last_used_frame = frame_;
+}
+
+// static
+void TextureAtlas::NewFrame() {
+  frame_++;
+}
+
+// static
+void TextureAtlas::ResetContext() {
+  for (boost::ptr_vector<Page>::iterator it = pages_.begin();
+       it != pages_.end(); ++it) {
+    for (std::vector<Texture*>::iterator jt = it->residents.begin();
+         jt != it->residents.end(); ++jt) {
+      (*jt)->atlas_page_ = NULL;
+    }
+  }
+
+  // The GL textures went with the old context.
+  pages_.clear();
+}
+
+// static
+bool TextureAtlas::PackInto(Page& page, int width, int height,
+                            int* x, int* y) {
+  int size = PageSize();
+
+  // Use the shortest shelf that is tall enough, but don't waste a tall
+  // shelf on something less than half its height.
+  Shelf* best = NULL;
+  for (std::vector<Shelf>::iterator it = page.shelves.begin();
+       it != page.shelves.end(); ++it) {
+    if (it->height >= height && it->height <= height * 2 &&
+        it->used_width + width <= size &&
+        (!best || it->height < best->height))
+      best = &*it;
+  }
+
+  if (!best) {
+    if (page.free_y + height > size)
+      return false;
+
+    Shelf shelf;
+    shelf.y = page.free_y;
+    shelf.height = height;
+    shelf.used_width = 0;
+    page.shelves.push_back(shelf);
+    page.free_y += height;
+    best = &page.shelves.back();
+  }
+
+  *x = best->used_width;
+  *y = best->y;
+  best->used_width += width;
+  return true;
+}
+
+// static
+void TextureAtlas::Clear(Page& page) {
+  // Quads already queued must show what's on the page now.
+  RenderQueue::Flush();
+
+  for (std::vector<Texture*>::iterator it = page.residents.begin();
+       it != page.residents.end(); ++it) {
+    (*it)->atlas_page_ = NULL;
+  }
+  page.residents.clear();
+  page.shelves.clear();
+  page.free_y = 0;
+}
+
+// static
+int TextureAtlas::PageSize() {
+  return std::min(kPageSize, GetMaxTextureSize());
+}
@@ -0,0 +1,108 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2013 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_SDL_TEXTUREATLAS_HPP_
+#define SRC_SYSTEMS_SDL_TEXTUREATLAS_HPP_
+
+#include <SDL/SDL_opengl.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <vector>
+
+class Texture;
+
+// Packs small images (UI sprites, digits, cursor frames, button states) into
+// a few shared pages so they don't each need their own OpenGL texture. Since
+// RenderQueue batches by texture, sprites on the same page are usually drawn
+// together.
+//
+// Pages are packed in shelves. Space is given back when every texture on a
+// page has gone. When all pages are full, the page that was drawn from least
+// recently is emptied; the Textures that were on it report evicted() and
+// their SDLSurfaces upload them again the next time they're drawn.
+class TextureAtlas {
+ public:
+  // Images larger than this in either direction get their own texture.
+  static const int kMaxPackedSize = 256;
+
+  // Most VRAM we'll spend on pages is kMaxPages * kPageSize^2 * 4 bytes.
+  static const int kPageSize = 1024;
+  static const int kMaxPages = 4;
+
+  struct Page;
+
+  // Finds room for a |width| by |height| |texture|. On success, returns the
+  // page, its GL texture and where the image goes in it. Returns false when
+  // |texture| should have a texture of its own.
+  static bool Allocate(Texture* texture, int width, int height,
+                       Page** page, GLuint* texture_id, int* x, int* y);
+
+  // Gives back |texture|'s space on |page|.
+  static void Release(Page* page, Texture* texture);
+
+  // Records that |page| was drawn from this frame. |page| may be NULL.
+  static void Touch(Page* page);
+
+  // Called at the start of each frame. Pages drawn from this frame are never
+  // evicted.
+  static void NewFrame();
+
+  // Forgets every page after the OpenGL context has been recreated.
+  static void ResetContext();
+
+  // Width and height of every page.
+  static int PageSize();
+
+  // A row of images of about the same height.
+  struct Shelf {
+    int y, height;
+    int used_width;
+  };
+
+  struct Page {
+    GLuint texture_id;
+    std::vector<Shelf> shelves;
+
+    // Top of the space not yet given to a shelf.
+    int free_y;
+
+    std::vector<Texture*> residents;
+    int last_used_frame;
+  };
+
+ private:
+  // Tries to place a padded |width| by |height| box on |page|.
+  static bool PackInto(Page& page, int width, int height, int* x, int* y);
+
+  // Empties |page| and evicts everything on it.
+  static void Clear(Page& page);
+
+  static boost::ptr_vector<Page> pages_;
+  static int frame_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_TEXTUREATLAS_HPP_
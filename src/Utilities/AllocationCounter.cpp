@@ -0,0 +1,121 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "Utilities/AllocationCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#include <boost/detail/atomic_count.hpp>
+
+namespace {
+
+// Non-zero while counting. Every thread's operator new reads it, so it's an
+// atomic_count rather than a plain bool.
+boost::detail::atomic_count& enabledFlag() {
+  static boost::detail::atomic_count flag(0);
+  return flag;
+}
+
+// Allocations happen on other threads too.
+boost::detail::atomic_count& counter() {
+  static boost::detail::atomic_count count(0);
+  return count;
+}
+
+#if defined(RLVM_COUNT_ALLOCATIONS)
+void* countedAllocate(std::size_t size) {
+  if (enabledFlag() != 0)
+    ++counter();
+
+  if (size == 0)
+    size = 1;
+
+  void* p;
+  while ((p = std::malloc(size)) == 0) {
+    std::new_handler handler = std::set_new_handler(0);
+    std::set_new_handler(handler);
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+
+  return p;
+}
+#endif
+
+}  // namespace
+
+namespace allocation_counter {
+
+bool available() {
+#if defined(RLVM_COUNT_ALLOCATIONS)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void setEnabled(bool enabled) {
+  boost::detail::atomic_count& flag = enabledFlag();
+  if (enabled && flag == 0) {
+    counter();
+    ++flag;
+  } else if (!enabled && flag != 0) {
+    --flag;
+  }
+}
+
+bool enabled() {
+  return enabledFlag() != 0;
+}
+
+long count() {
+  return counter();
+}
+
+}  // namespace allocation_counter
+
+// -----------------------------------------------------------------------
+
+#if defined(RLVM_COUNT_ALLOCATIONS)
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+  return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) throw(std::bad_alloc) {
+  return countedAllocate(size);
+}
+
+void operator delete(void* p) throw() {
+  std::free(p);
+}
+
+void operator delete[](void* p) throw() {
+  std::free(p);
+}
+#endif  // RLVM_COUNT_ALLOCATIONS
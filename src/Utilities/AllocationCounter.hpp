@@ -0,0 +1,55 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_UTILITIES_ALLOCATIONCOUNTER_HPP_
+#define SRC_UTILITIES_ALLOCATIONCOUNTER_HPP_
+
+// A debugging aid that counts calls to the global operator new. Counting is
+// off by default; while it is off, the replacement allocator costs a single
+// branch per allocation. Used by RLMachine to attribute heap traffic to the
+// opcodes that caused it (see RLMachine::recordOpcodeAllocations()).
+//
+// The replacement operator new is only compiled in when building with
+// `scons --count-allocations` (which defines RLVM_COUNT_ALLOCATIONS). In any
+// other build, available() is false and count() never changes.
+namespace allocation_counter {
+
+// Whether this build replaces operator new and can count allocations.
+bool available();
+
+// Turns counting on or off. The count is not reset. Only the main thread
+// calls this; allocations on every thread are counted while it's on.
+void setEnabled(bool enabled);
+
+bool enabled();
+
+// The number of global operator new calls made while counting was enabled.
+long count();
+
+}  // namespace allocation_counter
+
+#endif  // SRC_UTILITIES_ALLOCATIONCOUNTER_HPP_
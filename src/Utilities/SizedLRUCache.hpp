@@ -0,0 +1,156 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SRC_UTILITIES_SIZEDLRUCACHE_HPP_
+#define SRC_UTILITIES_SIZEDLRUCACHE_HPP_
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <ostream>
+
+// An LRU cache bounded by the memory its entries use instead of by their
+// count. The caller supplies each entry's size when inserting it. Ten full
+// screen CGs and ten cursor icons cost wildly different amounts, which the
+// entry counted LRUCache in vendor/ can't express.
+//
+// Keeps hit, miss and eviction counters so the budget can be tuned.
+template<typename Key, typename Data>
+class SizedLRUCache {
+ public:
+  explicit SizedLRUCache(size_t max_bytes)
+      : bytes_(0), max_bytes_(max_bytes), hits_(0), misses_(0),
+        evictions_(0) {
+  }
+
+  // Changes the budget, evicting entries if we're now over it.
+  void set_max_bytes(size_t max_bytes) {
+    max_bytes_ = max_bytes;
+    evictToFit();
+  }
+
+  // Whether |key| is cached. Doesn't touch the entry or count towards the
+  // hit rate.
+  bool exists(const Key& key) const {
+    return index_.find(key) != index_.end();
+  }
+
+  // Returns the data for |key| and makes it the most recently used entry, or
+  // returns a default constructed Data if it isn't cached.
+  Data fetch(const Key& key) {
+    typename Index::iterator it = index_.find(key);
+    if (it == index_.end()) {
+      misses_++;
+      return Data();
+    }
+
+    hits_++;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->data;
+  }
+
+  // Inserts |data| as the most recently used entry, replacing any existing
+  // entry for |key|, and evicts the least recently used entries until we're
+  // back under budget. The new entry is never evicted by its own insertion,
+  // even if it alone is over budget, since the caller is about to use it.
+  void insert(const Key& key, const Data& data, size_t bytes) {
+    remove(key);
+
+    Entry entry;
+    entry.key = key;
+    entry.data = data;
+    entry.bytes = bytes;
+    entries_.push_front(entry);
+    index_.insert(std::make_pair(key, entries_.begin()));
+    bytes_ += bytes;
+
+    evictToFit();
+  }
+
+  void remove(const Key& key) {
+    typename Index::iterator it = index_.find(key);
+    if (it != index_.end()) {
+      bytes_ -= it->second->bytes;
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+  }
+
+  void clear() {
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+  }
+
+  size_t size() const { return entries_.size(); }
+  size_t bytes() const { return bytes_; }
+  size_t max_bytes() const { return max_bytes_; }
+
+  long hits() const { return hits_; }
+  long misses() const { return misses_; }
+  long evictions() const { return evictions_; }
+
+  // Writes a one line summary of the counters, prefixed with |name|.
+  void printStatistics(std::ostream& os, const char* name) const {
+    os << name << ": " << size() << " entries, " << bytes_ / 1024 << " of "
+       << max_bytes_ / 1024 << " KB; " << hits_ << " hits, " << misses_
+       << " misses, " << evictions_ << " evictions" << std::endl;
+  }
+
+ private:
+  struct Entry {
+    Key key;
+    Data data;
+    size_t bytes;
+  };
+
+  typedef std::list<Entry> Entries;
+  typedef std::map<Key, typename Entries::iterator> Index;
+
+  void evictToFit() {
+    while (bytes_ > max_bytes_ && entries_.size() > 1) {
+      const Entry& victim = entries_.back();
+      bytes_ -= victim.bytes;
+      index_.erase(victim.key);
+      entries_.pop_back();
+      evictions_++;
+    }
+  }
+
+  // Most recently used first.
+  Entries entries_;
+  Index index_;
+
+  size_t bytes_;
+  size_t max_bytes_;
+
+  long hits_;
+  long misses_;
+  long evictions_;
+};
+
+#endif  // SRC_UTILITIES_SIZEDLRUCACHE_HPP_
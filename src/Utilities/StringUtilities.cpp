@@ -67,8 +67,7 @@ string cp932toUTF8(const string& line, int transformation) {
   if (line.empty())
     return line;
 
-  std::wstring ws = cp932toUnicode(line, transformation);
-  return unicodeToUTF8(ws);
+  return Cp::instance(transformation).ConvertStringToUTF8(line);
 }
 
 bool isOpeningQuoteMark(int codepoint) {
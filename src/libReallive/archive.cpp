@@ -32,7 +32,9 @@
 // -----------------------------------------------------------------------
 
 #include "archive.h"
+#include "bytecode.h"
 #include "compression.h"
+#include "preloader.h"
 #include "string.h"
 
 #include <boost/algorithm/string.hpp>
@@ -48,13 +50,16 @@ namespace fs = boost::filesystem;
 namespace libReallive {
 
 Archive::Archive(const string& filename)
-  : name(filename), info(filename, Read), second_level_xor_key_(NULL) {
+  : resident_bytes_(0), memory_budget_(0), name(filename), info(filename, Read),
+    second_level_xor_key_(NULL) {
   readTOC();
   readOverrides();
 }
 
 Archive::Archive(const string& filename, const std::string& regname)
-    : name(filename),
+    : resident_bytes_(0),
+      memory_budget_(0),
+      name(filename),
       info(filename, Read),
       second_level_xor_key_(NULL),
       regname_(regname) {
@@ -82,6 +87,9 @@ Archive::Archive(const string& filename, const std::string& regname)
 }
 
 Archive::~Archive() {
+  // Stop the background parsers before we free anything they might touch.
+  preloader_.reset();
+
   for (accessed_t::iterator it = accessed.begin(); it != accessed.end(); ++it)
     delete it->second;
 }
@@ -120,14 +128,130 @@ void Archive::readOverrides() {
 
 Scenario*
 Archive::scenario(int index) {
-	accessed_t::const_iterator at = accessed.find(index);
-	if (at != accessed.end())
-    return at->second;
+  boost::mutex::scoped_lock lock(accessed_mutex_);
+  while (true) {
+    accessed_t::const_iterator at = accessed.find(index);
+    if (at != accessed.end()) {
+      touch(index);
+      return at->second;
+    }
+
+    // Somebody else is already parsing this; wait for them to finish.
+    if (in_progress_.find(index) == in_progress_.end())
+      break;
+    scenario_parsed_.wait(lock);
+  }
+
 	scenarios_t::const_iterator st = scenarios.find(index);
-	if (st != scenarios.end())
-    return accessed[index] =
-        new Scenario(st->second, index, regname_, second_level_xor_key_);
-	return NULL;
+	if (st == scenarios.end())
+    return NULL;
+
+  // Parse without holding the lock so other threads can work on other
+  // scenarios at the same time.
+  FilePos fp = st->second;
+  in_progress_.insert(index);
+  lock.unlock();
+
+  Scenario* parsed = NULL;
+  try {
+    parsed = new Scenario(fp, index, regname_, second_level_xor_key_);
+  } catch (...) {
+    lock.lock();
+    in_progress_.erase(index);
+    scenario_parsed_.notify_all();
+    throw;
+  }
+
+  lock.lock();
+  in_progress_.erase(index);
+  accessed[index] = parsed;
+  resident_bytes_ += parsed->memoryUsage();
+  touch(index);
+  scenario_parsed_.notify_all();
+  return parsed;
+}
+
+void Archive::touch(int index) {
+  std::map<int, std::list<int>::iterator>::iterator pos =
+      lru_positions_.find(index);
+  if (pos != lru_positions_.end()) {
+    lru_.splice(lru_.end(), lru_, pos->second);
+  } else {
+    lru_.push_back(index);
+    lru_positions_[index] = --lru_.end();
+  }
+}
+
+void Archive::enableBackgroundParsing(int num_threads) {
+  if (num_threads < 1)
+    num_threads = 1;
+
+  if (!preloader_ || preloader_->numThreads() != num_threads)
+    preloader_.reset(new ScenarioPreloader(*this, num_threads));
+}
+
+void Archive::prefetch(int index) {
+  if (!preloader_)
+    return;
+
+  {
+    boost::mutex::scoped_lock lock(accessed_mutex_);
+    if (accessed.find(index) != accessed.end() ||
+        in_progress_.find(index) != in_progress_.end() ||
+        scenarios.find(index) == scenarios.end())
+      return;
+  }
+
+  preloader_->enqueue(index, true);
+}
+
+void Archive::prefetchJumpTargets(int index) {
+  if (!preloader_)
+    return;
+
+  Scenario* seen = NULL;
+  {
+    boost::mutex::scoped_lock lock(accessed_mutex_);
+    if (!prefetch_scanned_.insert(index).second)
+      return;
+
+    accessed_t::const_iterator at = accessed.find(index);
+    if (at == accessed.end())
+      return;
+    seen = at->second;
+  }
+
+  // jump() and farcall() (and farcall_with()) in module 0:001 all take the
+  // target scenario as their first parameter. We can only do anything when
+  // that's a constant, which is encoded as "$\xff" followed by an int32.
+  for (Scenario::const_iterator it = seen->begin(); it != seen->end(); ++it) {
+    if (it->type() < Command)
+      continue;
+
+    const CommandElement& command = static_cast<const CommandElement&>(*it);
+    if (command.modtype() != 0 || command.module() != 1)
+      continue;
+
+    int opcode = command.opcode();
+    if ((opcode == 11 || opcode == 12 || opcode == 18) &&
+        command.param_count() > 0) {
+      string param = command.get_param(0);
+      if (param.size() == 6 && param[0] == '$' &&
+          static_cast<unsigned char>(param[1]) == 0xff) {
+        prefetch(read_i32(param.data() + 2));
+      }
+    }
+  }
+}
+
+void Archive::preparseAll() {
+  if (!preloader_)
+    return;
+
+  for (scenarios_t::const_iterator it = scenarios.begin();
+       it != scenarios.end(); ++it) {
+    preloader_->enqueue(it->first, false);
+  }
 }
 
 int Archive::getProbableEncodingType() const {
@@ -142,10 +266,53 @@ int Archive::getProbableEncodingType() const {
   return 0;
 }
 
+void Archive::setMemoryBudget(size_t bytes) {
+  boost::mutex::scoped_lock lock(accessed_mutex_);
+  memory_budget_ = bytes;
+}
+
+void Archive::evictUnused(const std::set<int>& in_use) {
+  boost::mutex::scoped_lock lock(accessed_mutex_);
+  if (memory_budget_ == 0)
+    return;
+
+  std::list<int>::iterator it = lru_.begin();
+  while (resident_bytes_ > memory_budget_ && it != lru_.end()) {
+    if (in_use.find(*it) != in_use.end()) {
+      ++it;
+      continue;
+    }
+
+    accessed_t::iterator at = accessed.find(*it);
+    resident_bytes_ -= at->second->memoryUsage();
+    delete at->second;
+    accessed.erase(at);
+    // A reparsed copy has to be scanned for jump targets again.
+    prefetch_scanned_.erase(*it);
+    lru_positions_.erase(*it);
+    it = lru_.erase(it);
+  }
+}
+
+size_t Archive::residentSize() const {
+  boost::mutex::scoped_lock lock(accessed_mutex_);
+  return resident_bytes_;
+}
+
+size_t Archive::residentCount() const {
+  boost::mutex::scoped_lock lock(accessed_mutex_);
+  return accessed.size();
+}
+
 void
 Archive::reset() {
+  boost::mutex::scoped_lock lock(accessed_mutex_);
 	for (accessed_t::iterator it = accessed.begin(); it != accessed.end(); ++it) delete it->second;
 	accessed.clear();
+  lru_.clear();
+  lru_positions_.clear();
+  resident_bytes_ = 0;
+  prefetch_scanned_.clear();
 }
 
 }
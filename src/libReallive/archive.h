@@ -39,6 +39,13 @@
 #include "filemap.h"
 
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <list>
+#include <map>
+#include <set>
 
 namespace libReallive {
 
@@ -46,6 +53,8 @@ namespace Compression {
 struct XorKey;
 }  // namespace Compression
 
+class ScenarioPreloader;
+
 /**
  * Interface to a loaded SEEN.TXT file.
  *
@@ -55,6 +64,43 @@ class Archive {
   typedef std::map<int, Scenario*> accessed_t;
   scenarios_t scenarios;
   accessed_t accessed;
+
+  // Scenarios can be parsed on background threads (see ScenarioPreloader),
+  // so |accessed| and |in_progress_| are only touched with |accessed_mutex_|
+  // held.
+  mutable boost::mutex accessed_mutex_;
+
+  // Signaled every time a scenario finishes parsing.
+  boost::condition_variable scenario_parsed_;
+
+  // SEEN numbers that some thread is currently parsing.
+  std::set<int> in_progress_;
+
+  // SEEN numbers whose jump targets have already been handed to the
+  // preloader.
+  std::set<int> prefetch_scanned_;
+
+  // Optional pool of background parsers.
+  boost::scoped_ptr<ScenarioPreloader> preloader_;
+
+  // Parsed scenarios, least recently requested first.
+  std::list<int> lru_;
+
+  // Where each index in |lru_| lives, so touch() can splice instead of
+  // searching the list.
+  std::map<int, std::list<int>::iterator> lru_positions_;
+
+  // Sum of Scenario::memoryUsage() over |accessed|.
+  size_t resident_bytes_;
+
+  // When non-zero, evictUnused() throws away scenarios until
+  // |resident_bytes_| fits in this many bytes.
+  size_t memory_budget_;
+
+  // Moves |index| to the most recently used end of |lru_|. Caller must hold
+  // |accessed_mutex_|.
+  void touch(int index);
+
   string name;
   Mapping info;
 
@@ -94,11 +140,54 @@ public:
   /**
    * Returns a specific scenario
    *
+   * Safe to call from any thread. If another thread is already parsing the
+   * requested scenario, waits for it instead of parsing it twice.
+   *
    * @param index The SEEN number to return
    * @return The coresponding Scenario if index exists, or NULL if it doesn't.
    */
   Scenario* scenario(int index);
 
+  /**
+   * Starts a pool of |num_threads| threads that parse scenarios in the
+   * background. Until this is called, prefetch() and preparseAll() do
+   * nothing and every scenario is parsed on first access.
+   */
+  void enableBackgroundParsing(int num_threads);
+
+  /// Queues a SEEN to be parsed in the background, if it isn't already.
+  void prefetch(int index);
+
+  /**
+   * Queues every scenario that SEEN |index| statically jump()s or farcall()s
+   * to with a constant scenario number. Each SEEN is only scanned once.
+   */
+  void prefetchJumpTargets(int index);
+
+  /// Queues every scenario in the archive to be parsed in the background.
+  void preparseAll();
+
+  /**
+   * Limits how much memory parsed scenarios may occupy. Zero (the default)
+   * means no limit. The limit is only enforced by evictUnused().
+   */
+  void setMemoryBudget(size_t bytes);
+  size_t memoryBudget() const { return memory_budget_; }
+
+  /**
+   * Deletes parsed scenarios, least recently used first, until we're back
+   * under the memory budget. Scenarios in |in_use| are never evicted; the
+   * caller must list every scenario it still holds a pointer or iterator
+   * into. Evicted scenarios are parsed again the next time they're asked for.
+   */
+  void evictUnused(const std::set<int>& in_use);
+
+  /// Estimated memory used by all currently parsed scenarios.
+  size_t residentSize() const;
+
+  /// Number of currently parsed scenarios.
+  size_t residentCount() const;
+
   // Does a quick pass through all scenarios in the archive, looking for any
   // with non-default encoding. This short circuits when it finds one.
   int getProbableEncodingType() const;
@@ -49,27 +49,26 @@ using namespace std;
 
 namespace libReallive {
 
-char BytecodeElement::entrypoint_marker = '@';
-
 CommandElement* BuildFunctionElement(const char* stream) {
   const char* ptr = stream;
   ptr += 8;
-  std::vector<string> params;
+  int num_params = 0;
+  const char* end = ptr;
   if (*ptr == '(') {
-    const char* end = ptr + 1;
+    end = ptr + 1;
     while (*end != ')') {
-      const size_t len = next_data(end);
-      params.push_back(string(end, len));
-      end += len;
+      end += next_data(end);
+      num_params++;
     }
   }
 
-  if (params.size() == 0)
+  if (num_params == 0)
     return new VoidFunctionElement(stream);
-  else if (params.size() == 1)
-    return new SingleArgFunctionElement(stream, params.front());
+  else if (num_params == 1)
+    return new SingleArgFunctionElement(stream, DataSpan(ptr + 1, end - ptr - 1));
   else
-    return new FunctionElement(stream, params);
+    return new FunctionElement(stream, DataSpan(ptr + 1, end - ptr - 1),
+                               num_params);
 }
 
 void PrintParameterString(std::ostream& oss,
@@ -101,7 +100,7 @@ void PrintParameterString(std::ostream& oss,
 // -----------------------------------------------------------------------
 
 ConstructionData::ConstructionData(size_t kt, pointer_t pt)
-  : kidoku_table(kt), null(pt) {}
+  : kidoku_table(kt), null(pt), entrypoint_marker('@') {}
 
 // -----------------------------------------------------------------------
 
@@ -191,7 +190,7 @@ BytecodeElement*
 BytecodeElement::read(const char* stream, const char* end,
                       ConstructionData& cdata) {
   const char c = *stream;
-  if (c == '!') entrypoint_marker = '!';
+  if (c == '!') cdata.entrypoint_marker = '!';
   switch (c) {
   case 0:
   case ',':  return new CommaElement;
@@ -200,7 +199,7 @@ BytecodeElement::read(const char* stream, const char* end,
   case '!':  return new MetaElement(&cdata, stream);
   case '$':  return new ExpressionElement(stream);
   case '#':  return read_function(stream, cdata);
-  default:   return new TextoutElement(stream, end);
+  default:   return new TextoutElement(stream, end, cdata);
   }
 }
 
@@ -293,7 +292,8 @@ MetaElement* MetaElement::clone() const { return new MetaElement(*this); }
 // TextoutElement
 // -----------------------------------------------------------------------
 
-TextoutElement::TextoutElement(const char* src, const char* file_end) {
+TextoutElement::TextoutElement(const char* src, const char* file_end,
+                               const ConstructionData& cdata) {
   const char* end = src;
   bool quoted = false;
   while (true && end < file_end) {
@@ -304,7 +304,7 @@ TextoutElement::TextoutElement(const char* src, const char* file_end) {
       if (*end == ',') ++end;
       quoted = *end == '"';
       if (!*end || *end == '#' || *end == '$' || *end == '\n' ||
-          *end == '@' || *end == entrypoint_marker)
+          *end == '@' || *end == cdata.entrypoint_marker)
         break;
     }
     if ((*end >= 0x81 && *end <= 0x9f) || (*end >= 0xe0 && *end <= 0xef))
@@ -312,7 +312,7 @@ TextoutElement::TextoutElement(const char* src, const char* file_end) {
     else
       ++end;
   }
-  repr.assign(src, end);
+  repr = DataSpan(src, end - src);
 }
 
 // -----------------------------------------------------------------------
@@ -335,7 +335,7 @@ const string
 TextoutElement::text() const {
   string rv;
   bool quoted = false;
-  string::const_iterator it = repr.begin();
+  const char* it = repr.begin();
   while (it != repr.end()) {
     if (*it == '"') {
       ++it;
@@ -378,15 +378,16 @@ ExpressionElement::ExpressionElement(const char* src) {
     end += 2;
     end += next_expr(end);
   }
-  repr.assign(src, end);
+  repr = DataSpan(src, end - src);
 }
 
 // -----------------------------------------------------------------------
 
-ExpressionElement::ExpressionElement(const long val) {
-  repr.resize(6, '$');
-  repr[1] = 0xff;
-  insert_i32(repr, 2, val);
+ExpressionElement::ExpressionElement(const long val)
+    : repr(constant_, sizeof(constant_)) {
+  constant_[0] = '$';
+  constant_[1] = 0xff;
+  insert_i32(constant_ + 2, val);
 }
 
 // -----------------------------------------------------------------------
@@ -406,7 +407,12 @@ const size_t ExpressionElement::length() const {
 // -----------------------------------------------------------------------
 
 ExpressionElement::ExpressionElement(const ExpressionElement& rhs)
-    : parsed_expression_(NULL) {
+    : BytecodeElement(rhs),
+      repr(rhs.repr),
+      parsed_expression_(NULL) {
+  memcpy(constant_, rhs.constant_, sizeof(constant_));
+  if (rhs.repr.data() == rhs.constant_)
+    repr = DataSpan(constant_, sizeof(constant_));
 }
 
 // -----------------------------------------------------------------------
@@ -418,7 +424,7 @@ ExpressionElement* ExpressionElement::clone() const {
 // -----------------------------------------------------------------------
 
 int ExpressionElement::valueOnly(RLMachine& machine) const {
-  const char* location = repr.c_str();
+  const char* location = repr.data();
   boost::scoped_ptr<ExpressionPiece> e(get_expression(location));
   return e->integerValue(machine);
 }
@@ -427,7 +433,7 @@ int ExpressionElement::valueOnly(RLMachine& machine) const {
 
 const ExpressionPiece& ExpressionElement::parsedExpression() const {
   if (parsed_expression_.get() == 0) {
-    const char* location = repr.c_str();
+    const char* location = repr.data();
     parsed_expression_.reset(get_assignment(location));
   }
 
@@ -444,7 +450,8 @@ void ExpressionElement::runOnMachine(RLMachine& machine) const {
 // CommandElement
 // -----------------------------------------------------------------------
 
-CommandElement::CommandElement(const char* src) {
+CommandElement::CommandElement(const char* src)
+    : cached_operation_(NULL), cached_generation_(0) {
   memcpy(command, src, 8);
 }
 
@@ -469,6 +476,14 @@ void CommandElement::print(std::ostream& oss) const {
 
 // -----------------------------------------------------------------------
 
+void CommandElement::getParameterSpans(ParameterSpans& spans) const {
+  size_t numberOfParameters = param_count();
+  for (size_t i = 0; i < numberOfParameters; ++i)
+    spans.push_back(get_param_span(i));
+}
+
+// -----------------------------------------------------------------------
+
 vector<string> CommandElement::getUnparsedParameters() const {
   vector<string> parameters;
   size_t numberOfParameters = param_count();
@@ -505,6 +520,14 @@ CommandElement::getParameters() const {
 
 // -----------------------------------------------------------------------
 
+void CommandElement::setCachedOperation(unsigned int generation,
+                                        RLOperation* op) const {
+  cached_operation_ = op;
+  cached_generation_ = generation;
+}
+
+// -----------------------------------------------------------------------
+
 void CommandElement::runOnMachine(RLMachine& machine) const {
   machine.executeCommand(*this);
 }
@@ -651,16 +674,23 @@ string SelectElement::get_param(int i) const {
 
 // -----------------------------------------------------------------------
 
+DataSpan SelectElement::get_param_span(int i) const {
+  return params[i].raw;
+}
+
+// -----------------------------------------------------------------------
+
 SelectElement* SelectElement::clone() const { return new SelectElement(*this); }
 
 // -----------------------------------------------------------------------
 // FunctionElement
 // -----------------------------------------------------------------------
 
-FunctionElement::FunctionElement(const char* src,
-                                 const std::vector<string>& params)
+FunctionElement::FunctionElement(const char* src, const DataSpan& params,
+                                 int num_params)
     : CommandElement(src),
-      params(params) {
+      params(params),
+      num_params(num_params) {
 }
 
 // -----------------------------------------------------------------------
@@ -671,13 +701,10 @@ const ElementType FunctionElement::type() const { return Function; }
 
 const size_t
 FunctionElement::length() const {
-  if (params.size() > 0) {
-    size_t rv(COMMAND_SIZE + 2);
-    for (std::vector<string>::const_iterator it = params.begin(); it != params.end(); ++it) rv += it->size();
-    return rv;
-  } else {
+  if (num_params > 0)
+    return COMMAND_SIZE + 2 + params.size();
+  else
     return COMMAND_SIZE;
-  }
 }
 
 // -----------------------------------------------------------------------
@@ -686,13 +713,14 @@ std::string FunctionElement::serializableData(RLMachine& machine) const {
   string rv;
   for (int i = 0; i < COMMAND_SIZE; ++i)
     rv.push_back(command[i]);
-  if (params.size() > 0) {
+  if (num_params > 0) {
     rv.push_back('(');
-    for (std::vector<string>::const_iterator it = params.begin();
-         it != params.end(); ++it) {
-      const char* data = it->c_str();
-      boost::scoped_ptr<ExpressionPiece> expression(get_data(data));
+    const char* data = params.data();
+    for (int i = 0; i < num_params; ++i) {
+      const char* piece = data;
+      boost::scoped_ptr<ExpressionPiece> expression(get_data(piece));
       rv.append(expression->serializedValue(machine));
+      data += next_data(data);
     }
     rv.push_back(')');
   }
@@ -702,8 +730,28 @@ std::string FunctionElement::serializableData(RLMachine& machine) const {
 
 // -----------------------------------------------------------------------
 
-const size_t FunctionElement::param_count() const { return params.size(); }
-string FunctionElement::get_param(int i) const { return params[i]; }
+const size_t FunctionElement::param_count() const { return num_params; }
+
+string FunctionElement::get_param(int i) const {
+  return get_param_span(i).str();
+}
+
+DataSpan FunctionElement::get_param_span(int i) const {
+  const char* data = params.data();
+  for (int j = 0; j < i; ++j)
+    data += next_data(data);
+  return DataSpan(data, next_data(data));
+}
+
+void FunctionElement::getParameterSpans(ParameterSpans& spans) const {
+  // Walk the parameters once instead of once per get_param_span() call.
+  const char* data = params.data();
+  for (int i = 0; i < num_params; ++i) {
+    size_t size = next_data(data);
+    spans.push_back(DataSpan(data, size));
+    data += size;
+  }
+}
 
 // -----------------------------------------------------------------------
 
@@ -738,6 +786,9 @@ std::string VoidFunctionElement::serializableData(RLMachine& machine) const {
 
 const size_t VoidFunctionElement::param_count() const { return 0; }
 string VoidFunctionElement::get_param(int i) const { return std::string(); }
+DataSpan VoidFunctionElement::get_param_span(int i) const {
+  return DataSpan();
+}
 
 VoidFunctionElement* VoidFunctionElement::clone() const {
   return new VoidFunctionElement(*this);
@@ -748,7 +799,7 @@ VoidFunctionElement* VoidFunctionElement::clone() const {
 // -----------------------------------------------------------------------
 
 SingleArgFunctionElement::SingleArgFunctionElement(const char* src,
-                                                   const std::string& arg)
+                                                   const DataSpan& arg)
     : CommandElement(src),
       arg_(arg) {
 }
@@ -771,7 +822,7 @@ std::string SingleArgFunctionElement::serializableData(
   for (int i = 0; i < COMMAND_SIZE; ++i)
     rv.push_back(command[i]);
   rv.push_back('(');
-  const char* data = arg_.c_str();
+  const char* data = arg_.data();
   boost::scoped_ptr<ExpressionPiece> expression(get_data(data));
   rv.append(expression->serializedValue(machine));
   rv.push_back(')');
@@ -782,7 +833,10 @@ std::string SingleArgFunctionElement::serializableData(
 
 const size_t SingleArgFunctionElement::param_count() const { return 1; }
 string SingleArgFunctionElement::get_param(int i) const {
-  return i == 0 ? arg_ : std::string();
+  return i == 0 ? arg_.str() : std::string();
+}
+DataSpan SingleArgFunctionElement::get_param_span(int i) const {
+  return i == 0 ? arg_ : DataSpan();
 }
 
 SingleArgFunctionElement* SingleArgFunctionElement::clone() const {
@@ -842,6 +896,10 @@ string GotoElement::get_param(int i) const {
   return std::string();
 }
 
+DataSpan GotoElement::get_param_span(int i) const {
+  return DataSpan();
+}
+
 const size_t GotoElement::length() const {
   return 12;
 }
@@ -868,15 +926,13 @@ pointer_t GotoElement::get_pointer(int i) const {
 
 GotoIfElement::GotoIfElement(const char* src, ConstructionData& cdata)
     : CommandElement(src) {
-  repr.assign(src, 8);
+  const char* start = src;
   src += 8;
 
   if (*src++ != '(') throw Error("GotoIfElement(): expected `('");
   int expr = next_expr(src);
-  repr.push_back('(');
-  repr.append(src, expr);
-  repr.push_back(')');
   src += expr;
+  repr = DataSpan(start, src + 1 - start);
   if (*src++ != ')') throw Error("GotoIfElement(): expected `)'");
 
   id_ = read_i32(src);
@@ -895,7 +951,12 @@ const size_t GotoIfElement::param_count() const {
 }
 
 string GotoIfElement::get_param(int i) const {
-  return i == 0 ? (repr.size() == 8 ? string() : repr.substr(9, repr.size() - 10)) : string();
+  return get_param_span(i).str();
+}
+
+DataSpan GotoIfElement::get_param_span(int i) const {
+  return i == 0 && repr.size() != 8 ? repr.subspan(9, repr.size() - 10)
+                                    : DataSpan();
 }
 
 const size_t GotoIfElement::length() const {
@@ -924,12 +985,8 @@ pointer_t GotoIfElement::get_pointer(int i) const {
 
 GotoCaseElement::GotoCaseElement(const char* src, ConstructionData& cdata)
     : PointerElement(src) {
-  repr.assign(src, 8);
-  src += 8;
-  // Condition
-  const int expr = next_expr(src);
-  repr.append(src, expr);
-  src += expr;
+  repr = DataSpan(src, 8 + next_expr(src + 8));
+  src += repr.size();
   // Cases
   if (*src++ != '{') throw Error("GotoCaseElement(): expected `{'");
   int i = argc();
@@ -974,7 +1031,11 @@ const size_t GotoCaseElement::param_count() const {
 }
 
 string GotoCaseElement::get_param(int i) const {
-  return i == 0 ? repr.substr(8, repr.size() - 8) : string();
+  return get_param_span(i).str();
+}
+
+DataSpan GotoCaseElement::get_param_span(int i) const {
+  return i == 0 ? repr.subspan(8, repr.size() - 8) : DataSpan();
 }
 
 // -----------------------------------------------------------------------
@@ -983,12 +1044,8 @@ string GotoCaseElement::get_param(int i) const {
 
 GotoOnElement::GotoOnElement(const char* src, ConstructionData& cdata)
     : PointerElement(src) {
-  repr.assign(src, 8);
-  src += 8;
-  // Condition
-  const int expr = next_expr(src);
-  repr.append(src, expr);
-  src += expr;
+  repr = DataSpan(src, 8 + next_expr(src + 8));
+  src += repr.size();
   // Pointers
   if (*src++ != '{') throw Error("GotoOnElement(): expected `{'");
   int i = argc();
@@ -1019,7 +1076,11 @@ const size_t GotoOnElement::param_count() const {
 }
 
 string GotoOnElement::get_param(int i) const {
-  return i == 0 ? repr.substr(8, repr.size() - 8) : string();
+  return get_param_span(i).str();
+}
+
+DataSpan GotoOnElement::get_param_span(int i) const {
+  return i == 0 ? repr.subspan(8, repr.size() - 8) : DataSpan();
 }
 
 
@@ -1086,6 +1147,10 @@ string GosubWithElement::get_param(int i) const {
   return params[i];
 }
 
+DataSpan GosubWithElement::get_param_span(int i) const {
+  return DataSpan(params[i].data(), params[i].size());
+}
+
 void GosubWithElement::set_pointers(ConstructionData& cdata) {
   ConstructionData::offsets_t::const_iterator it =
       cdata.offsets.find(id_);
@@ -36,17 +36,51 @@
 
 #include "defs.h"
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <stdint.h>
 
 #include "bytecode_fwd.h"
 
+class ParsedTextout;
 class RLMachine;
+class RLOperation;
 
 namespace libReallive {
 
 class CommandElement;
 
+// A run of bytes inside a buffer owned by someone else. Elements read out of a
+// Script refer to the decompressed bytecode that the Script keeps for its
+// whole lifetime instead of each copying their piece of it onto the heap.
+// Elements built directly from a caller's buffer (BuildFunctionElement(), for
+// example) must not outlive that buffer.
+class DataSpan {
+ public:
+  DataSpan() : data_(NULL), size_(0) {}
+  DataSpan(const char* data, size_t size) : data_(data), size_(size) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  string str() const { return string(data_, size_); }
+  string substr(size_t pos, size_t n) const { return string(data_ + pos, n); }
+  DataSpan subspan(size_t pos, size_t n) const {
+    return DataSpan(data_ + pos, n);
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+// The raw bytes of each of a command's parameters, in order.
+typedef std::vector<DataSpan> ParameterSpans;
+
 // Returns a representation of the non-special cased function.
 CommandElement* BuildFunctionElement(const char* stream);
 
@@ -59,6 +93,11 @@ struct ConstructionData {
   typedef std::map<unsigned long, pointer_t> offsets_t;
   offsets_t offsets;
 
+  // Set to '!' once the scenario being read turns out to mark its
+  // entrypoints that way; textout runs must stop at it. Kept per scenario
+  // rather than globally since scenarios are parsed on several threads.
+  char entrypoint_marker;
+
   friend class Script;
   ConstructionData(size_t kt, pointer_t pt);
   ~ConstructionData();
@@ -88,7 +127,6 @@ public:
 class BytecodeElement {
   friend class Script;
 protected:
-  static char entrypoint_marker;
   BytecodeElement(const BytecodeElement& c);
 public:
   virtual const ElementType type() const;
@@ -166,16 +204,30 @@ public:
 
 class TextoutElement : public BytecodeElement {
  private:
-  string repr;
+  DataSpan repr;
+
+  // The UTF-8 version of text(), as converted by the last RLMachine to
+  // display it. Scenario text never changes, so only the names in it need
+  // to be filled in again.
+  mutable boost::shared_ptr<ParsedTextout> parsed_text_;
+
  public:
   virtual const ElementType type() const;
   virtual void print(std::ostream& oss) const;
   virtual const size_t length() const;
   const string text() const;
-  TextoutElement(const char* src, const char* file_end);
+  TextoutElement(const char* src, const char* file_end,
+                 const ConstructionData& cdata);
   TextoutElement();
   TextoutElement* clone() const;
 
+  const boost::shared_ptr<ParsedTextout>& parsedText() const {
+    return parsed_text_;
+  }
+  void setParsedText(const boost::shared_ptr<ParsedTextout>& parsed) const {
+    parsed_text_ = parsed;
+  }
+
   /// Execute this bytecode instruction on this virtual machine
   virtual void runOnMachine(RLMachine& machine) const;
 };
@@ -188,7 +240,12 @@ class TextoutElement : public BytecodeElement {
  */
 class ExpressionElement : public BytecodeElement {
  private:
-  string repr;
+  // Points into the Script's bytecode, or at |constant_| for elements built
+  // from an integer.
+  DataSpan repr;
+
+  /// Storage for the bytecode of an integer constant built by hand.
+  char constant_[6];
 
   /// Storage for the parsed expression so we only have to calculate
   /// it once (and so we can return it by const reference)
@@ -228,6 +285,13 @@ class CommandElement : public BytecodeElement {
 
   mutable boost::ptr_vector<libReallive::ExpressionPiece> parsed_parameters_;
 
+  // The RLOperation that implements this command, as resolved by the last
+  // RLMachine to execute it, and the machine's dispatch generation at the
+  // time. Lets the machine skip the module and opcode map lookups on every
+  // execution after the first.
+  mutable RLOperation* cached_operation_;
+  mutable unsigned int cached_generation_;
+
  public:
   virtual const ElementType type() const;
   virtual void print(std::ostream& oss) const;
@@ -241,12 +305,27 @@ class CommandElement : public BytecodeElement {
   virtual const size_t param_count() const = 0;
   virtual string get_param(int) const = 0;
 
+  // Returns the raw bytes of parameter |i|, pointing into this element or the
+  // bytecode it was read from, so the parameter can be parsed without copying
+  // it.
+  virtual DataSpan get_param_span(int i) const = 0;
+
+  // Appends get_param_span() for every parameter to |spans|.
+  virtual void getParameterSpans(ParameterSpans& spans) const;
+
   std::vector<string> getUnparsedParameters() const;
   bool areParametersParsed() const;
 
   void setParsedParameters(boost::ptr_vector<libReallive::ExpressionPiece>& p) const;
   const boost::ptr_vector<libReallive::ExpressionPiece>& getParameters() const;
 
+  // Returns the cached RLOperation for this command if it was resolved
+  // against |generation|, NULL otherwise.
+  RLOperation* cachedOperation(unsigned int generation) const {
+    return cached_generation_ == generation ? cached_operation_ : NULL;
+  }
+  void setCachedOperation(unsigned int generation, RLOperation* op) const;
+
   // Methods that deal with pointers.
   virtual const size_t pointers_count() const { return 0; }
   virtual pointer_t get_pointer(int i) const { return pointer_t(); }
@@ -281,15 +360,18 @@ public:
     std::vector<Condition> cond_parsed;
     string cond_text;
     string text;
+    // The condition and text as they appear in the bytecode; the text
+    // immediately follows the condition.
+    DataSpan raw;
     int line;
     Param() : cond_text(), text(), line(0) {}
     Param(const char* tsrc, const size_t tlen, const int lnum)
-        : cond_text(), text(tsrc, tlen), line(lnum) {}
+        : cond_text(), text(tsrc, tlen), raw(tsrc, tlen), line(lnum) {}
     Param(const std::vector<Condition>& conditions,
           const char* csrc, const size_t clen,
           const char* tsrc, const size_t tlen, const int lnum)
         : cond_parsed(conditions), cond_text(csrc, clen), text(tsrc, tlen),
-          line(lnum) {}
+          raw(csrc, clen + tlen), line(lnum) {}
   };
   typedef std::vector<Param> params_t;
 private:
@@ -305,6 +387,7 @@ public:
 
   const size_t param_count() const;
   string get_param(int i) const;
+  DataSpan get_param_span(int i) const;
 
   const params_t& getRawParams() const { return params; }
 
@@ -313,16 +396,20 @@ public:
 };
 
 class FunctionElement : public CommandElement {
-  std::vector<string> params;
+  // The raw parameters, between (but not including) the parentheses.
+  DataSpan params;
+  int num_params;
 public:
   virtual const ElementType type() const;
-  FunctionElement(const char* src, const std::vector<string>& params);
+  FunctionElement(const char* src, const DataSpan& params, int num_params);
 
   virtual const size_t length() const;
   virtual string serializableData(RLMachine& machine) const;
 
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
+  virtual void getParameterSpans(ParameterSpans& spans) const;
 
   virtual FunctionElement* clone() const;
 };
@@ -337,24 +424,25 @@ public:
 
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
 
   virtual VoidFunctionElement* clone() const;
 };
 
 class SingleArgFunctionElement : public CommandElement {
  private:
-  std::string arg_;
+  DataSpan arg_;
 
  public:
   virtual const ElementType type() const;
-  SingleArgFunctionElement(const char* src,
-                           const std::string& arg);
+  SingleArgFunctionElement(const char* src, const DataSpan& arg);
 
   virtual const size_t length() const;
   virtual string serializableData(RLMachine& machine) const;
 
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
 
   virtual SingleArgFunctionElement* clone() const;
 };
@@ -385,6 +473,7 @@ class GotoElement : public CommandElement {
   // The pointer is not counted as a parameter.
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
   virtual const size_t length() const;
 
   virtual void set_pointers(ConstructionData& cdata);
@@ -396,7 +485,7 @@ class GotoIfElement : public CommandElement {
  private:
   unsigned long id_;
   pointer_t pointer_;
-  string repr;
+  DataSpan repr;
 
  public:
   virtual const ElementType type() const;
@@ -406,6 +495,7 @@ class GotoIfElement : public CommandElement {
   // The pointer is not counted as a parameter.
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
   virtual const size_t length() const;
 
   virtual void set_pointers(ConstructionData& cdata);
@@ -415,7 +505,7 @@ class GotoIfElement : public CommandElement {
 
 class GotoCaseElement : public PointerElement {
  private:
-  string repr;
+  DataSpan repr;
   std::vector<string> cases;
  public:
   virtual const ElementType type() const;
@@ -427,6 +517,7 @@ class GotoCaseElement : public PointerElement {
   // The cases are not counted as parameters.
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
 
   // Accessors for the cases
   const size_t case_count() const { return cases.size(); }
@@ -435,7 +526,7 @@ class GotoCaseElement : public PointerElement {
 
 class GotoOnElement : public PointerElement {
  private:
-  string repr;
+  DataSpan repr;
  public:
   virtual const ElementType type() const;
   virtual const size_t length() const;
@@ -446,6 +537,7 @@ class GotoOnElement : public PointerElement {
   // The pointers are not counted as parameters.
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
 };
 
 class GosubWithElement : public CommandElement {
@@ -465,6 +557,7 @@ class GosubWithElement : public CommandElement {
   // The pointer is not counted as a parameter.
   virtual const size_t param_count() const;
   virtual string get_param(int i) const;
+  virtual DataSpan get_param_span(int i) const;
 
   virtual void set_pointers(ConstructionData& cdata);
   virtual const size_t pointers_count() const;
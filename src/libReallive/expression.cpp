@@ -34,6 +34,7 @@
 
 #include "libReallive/expression.h"
 #include "libReallive/expression_pieces.h"
+#include "libReallive/expression_program.h"
 #include "libReallive/intmemref.h"
 #include "MachineBase/reference.hpp"
 #include "MachineBase/RLMachine.hpp"
@@ -519,6 +520,16 @@ const std::string& ExpressionPiece::getStringValue(RLMachine& machine) const {
       "ExpressionPiece::getStringValue() invalid on this object");
 }
 
+bool ExpressionPiece::compileTo(ExpressionProgram& program) const {
+  return false;
+}
+
+bool ExpressionPiece::compileAssignmentTo(ExpressionProgram& program,
+                                          char operation,
+                                          const ExpressionPiece& rhs) const {
+  return false;
+}
+
 IntReferenceIterator ExpressionPiece::getIntegerReferenceIterator(
     RLMachine& machine) const {
   throw libReallive::Error(
@@ -546,6 +557,26 @@ int StoreRegisterExpressionPiece::integerValue(RLMachine& machine) const {
   return machine.getStoreRegisterValue();
 }
 
+bool StoreRegisterExpressionPiece::compileTo(
+    ExpressionProgram& program) const {
+  program.addInstruction(ExpressionProgram::LOAD_STORE_REGISTER);
+  return true;
+}
+
+bool StoreRegisterExpressionPiece::compileAssignmentTo(
+    ExpressionProgram& program, char operation,
+    const ExpressionPiece& rhs) const {
+  if (operation != 30)
+    program.addInstruction(ExpressionProgram::LOAD_STORE_REGISTER);
+  if (!rhs.compileTo(program))
+    return false;
+  if (operation != 30 && !program.addOperator(operation))
+    return false;
+
+  program.addInstruction(ExpressionProgram::STORE_STORE_REGISTER);
+  return true;
+}
+
 std::string StoreRegisterExpressionPiece::serializedValue(
     RLMachine& machine) const {
   return IntToBytecode(machine.getStoreRegisterValue());
@@ -581,6 +612,11 @@ int IntegerConstant::integerValue(RLMachine& machine) const {
   return constant;
 }
 
+bool IntegerConstant::compileTo(ExpressionProgram& program) const {
+  program.addConstant(constant);
+  return true;
+}
+
 std::string IntegerConstant::serializedValue(RLMachine& machine) const {
   return IntToBytecode(constant);
 }
@@ -655,9 +691,50 @@ void MemoryReference::assignIntValue(RLMachine& machine, int rvalue) {
 }
 
 int MemoryReference::integerValue(RLMachine& machine) const {
+  const ExpressionProgram& program =
+      ExpressionProgram::cached(compiledProgram, *this);
+  if (program.valid())
+    return program.run(machine);
+
   return machine.getIntValue(IntMemRef(type, location->integerValue(machine)));
 }
 
+bool MemoryReference::compileTo(ExpressionProgram& program) const {
+  if (isStringLocation(type))
+    return false;
+
+  IntMemRef ref(type, 0);
+  return location->compileTo(program) &&
+      program.addMemoryAccess(ExpressionProgram::LOAD_MEMORY, ref.bank(),
+                              ref.type());
+}
+
+bool MemoryReference::compileAssignmentTo(ExpressionProgram& program,
+                                          char operation,
+                                          const ExpressionPiece& rhs) const {
+  if (isStringLocation(type))
+    return false;
+
+  // The location is computed once and duplicated to read the current value
+  // for compound assignments.
+  IntMemRef ref(type, 0);
+  if (!location->compileTo(program))
+    return false;
+  if (operation != 30) {
+    program.addInstruction(ExpressionProgram::DUPLICATE);
+    if (!program.addMemoryAccess(ExpressionProgram::LOAD_MEMORY, ref.bank(),
+                                 ref.type()))
+      return false;
+  }
+  if (!rhs.compileTo(program))
+    return false;
+  if (operation != 30 && !program.addOperator(operation))
+    return false;
+
+  return program.addMemoryAccess(ExpressionProgram::STORE_MEMORY, ref.bank(),
+                                 ref.type());
+}
+
 void MemoryReference::assignStringValue(RLMachine& machine,
                                         const std::string& rvalue) {
   return machine.setStringValue(type, location->integerValue(machine), rvalue);
@@ -759,9 +836,23 @@ int UniaryExpressionOperator::performOperationOn(int int_operand) const {
 }
 
 int UniaryExpressionOperator::integerValue(RLMachine& machine) const {
+  const ExpressionProgram& program =
+      ExpressionProgram::cached(compiledProgram, *this);
+  if (program.valid())
+    return program.run(machine);
+
   return performOperationOn(operand->integerValue(machine));
 }
 
+bool UniaryExpressionOperator::compileTo(ExpressionProgram& program) const {
+  if (!operand->compileTo(program))
+    return false;
+
+  if (operation == 0x01)
+    program.addInstruction(ExpressionProgram::NEGATE);
+  return true;
+}
+
 std::string UniaryExpressionOperator::serializedValue(
     RLMachine& machine) const {
   return IntToBytecode(integerValue(machine));
@@ -846,10 +937,21 @@ int BinaryExpressionOperator::performOperationOn(int lhs, int rhs) const {
 }
 
 int BinaryExpressionOperator::integerValue(RLMachine& machine) const {
+  const ExpressionProgram& program =
+      ExpressionProgram::cached(compiledProgram, *this);
+  if (program.valid())
+    return program.run(machine);
+
   return performOperationOn(leftOperand->integerValue(machine),
                             rightOperand->integerValue(machine));
 }
 
+bool BinaryExpressionOperator::compileTo(ExpressionProgram& program) const {
+  return leftOperand->compileTo(program) &&
+      rightOperand->compileTo(program) &&
+      program.addOperator(operation);
+}
+
 std::string BinaryExpressionOperator::serializedValue(
     RLMachine& machine) const {
   return IntToBytecode(integerValue(machine));
@@ -970,6 +1072,11 @@ bool AssignmentExpressionOperator::isAssignment() const {
 }
 
 int AssignmentExpressionOperator::integerValue(RLMachine& machine) const {
+  const ExpressionProgram& program =
+      ExpressionProgram::cached(compiledProgram, *this);
+  if (program.valid())
+    return program.run(machine);
+
   if (operation == 30) {
     int value = rightOperand->integerValue(machine);
     leftOperand->assignIntValue(machine, value);
@@ -987,6 +1094,11 @@ std::string AssignmentExpressionOperator::getDebugValue(
   return "<assignment>";
 }
 
+bool AssignmentExpressionOperator::compileTo(
+    ExpressionProgram& program) const {
+  return leftOperand->compileAssignmentTo(program, operation, *rightOperand);
+}
+
 ExpressionPiece* AssignmentExpressionOperator::clone() const {
   return new AssignmentExpressionOperator(operation, leftOperand->clone(),
                                           rightOperand->clone());
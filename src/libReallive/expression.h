@@ -52,6 +52,7 @@ size_t next_data(const char* src);
 
 // Parse expression functions
 class ExpressionPiece;
+class ExpressionProgram;
 ExpressionPiece* get_expr_token(const char*& src);
 ExpressionPiece* get_expr_term(const char*& src);
 ExpressionPiece* get_expr_arith(const char*& src);
@@ -119,6 +120,18 @@ public:
   virtual void assignStringValue(RLMachine& machine);
   virtual const std::string& getStringValue(RLMachine& machine) const;
 
+  /// Appends instructions computing integerValue() to |program|. Returns
+  /// false (the default) if this piece can't be compiled.
+  /// @see ExpressionProgram
+  virtual bool compileTo(ExpressionProgram& program) const;
+
+  /// Appends instructions that store |rhs| into the location this piece
+  /// references (for compound assignment |operation|s, after combining it
+  /// with the current value) and leave the stored value on the stack. Returns
+  /// false (the default) if this piece isn't an assignable integer.
+  virtual bool compileAssignmentTo(ExpressionProgram& program, char operation,
+                                   const ExpressionPiece& rhs) const;
+
   // A persistable version of this value. This method should return RealLive
   // bytecode equal to this ExpressionPiece with all references returned.
   virtual std::string serializedValue(RLMachine& machine) const = 0;
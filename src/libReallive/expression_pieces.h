@@ -51,6 +51,10 @@ public:
   /// Returns the store register value of the passed in machine
   virtual int integerValue(RLMachine& machine) const;
 
+  virtual bool compileTo(ExpressionProgram& program) const;
+  virtual bool compileAssignmentTo(ExpressionProgram& program, char operation,
+                                   const ExpressionPiece& rhs) const;
+
   virtual std::string serializedValue(RLMachine& machine) const;
   virtual std::string getDebugValue(RLMachine& machine) const;
   virtual std::string getDebugString() const;
@@ -74,6 +78,7 @@ public:
 
   /// Returns the constant value
   virtual int integerValue(RLMachine& machine) const;
+  virtual bool compileTo(ExpressionProgram& program) const;
   virtual std::string serializedValue(RLMachine& machine) const;
   virtual std::string getDebugValue(RLMachine& machine) const;
   virtual std::string getDebugString() const;
@@ -119,6 +124,9 @@ private:
    */
   boost::scoped_ptr<ExpressionPiece> location;
 
+  /// Lazily compiled version of integerValue().
+  mutable boost::scoped_ptr<ExpressionProgram> compiledProgram;
+
 public:
   MemoryReference(int type, ExpressionPiece* inLoc);
   ~MemoryReference();
@@ -128,6 +136,9 @@ public:
 
   virtual void assignIntValue(RLMachine& machine, int rvalue);
   virtual int integerValue(RLMachine& machine) const;
+  virtual bool compileTo(ExpressionProgram& program) const;
+  virtual bool compileAssignmentTo(ExpressionProgram& program, char operation,
+                                   const ExpressionPiece& rhs) const;
 
   virtual void assignStringValue(RLMachine& machine, const std::string& rvalue);
   virtual const std::string& getStringValue(RLMachine& machine) const;
@@ -155,6 +166,9 @@ private:
   /// Which operation we are to perform.
   char operation;
 
+  /// Lazily compiled version of integerValue().
+  mutable boost::scoped_ptr<ExpressionProgram> compiledProgram;
+
   /**
    * Performs operation on the passed in parameter, and returns the
    * value.
@@ -168,6 +182,7 @@ public:
   UniaryExpressionOperator(char inOperation, ExpressionPiece* inOperand);
   ~UniaryExpressionOperator();
   virtual int integerValue(RLMachine& machine) const;
+  virtual bool compileTo(ExpressionProgram& program) const;
   virtual std::string serializedValue(RLMachine& machine) const;
   virtual std::string getDebugValue(RLMachine& machine) const;
   virtual std::string getDebugString() const;
@@ -186,6 +201,9 @@ protected:
   /// The right operand for this expression
   boost::scoped_ptr<ExpressionPiece> rightOperand;
 
+  /// Lazily compiled version of integerValue().
+  mutable boost::scoped_ptr<ExpressionProgram> compiledProgram;
+
   /**
    * Performs operation on the two passed in operands.
    *
@@ -204,6 +222,7 @@ public:
                            ExpressionPiece* rhs);
   ~BinaryExpressionOperator();
   virtual int integerValue(RLMachine& machine) const;
+  virtual bool compileTo(ExpressionProgram& program) const;
   virtual std::string serializedValue(RLMachine& machine) const;
   virtual std::string getDebugValue(RLMachine& machine) const;
   virtual std::string getDebugString() const;
@@ -229,6 +248,7 @@ public:
    * since it acts as the execute.
    */
   virtual int integerValue(RLMachine& machine) const;
+  virtual bool compileTo(ExpressionProgram& program) const;
   // Deliberately has no serializedValue() implementation; uses
   // BinaryExpressionOperator's.
   virtual std::string getDebugValue(RLMachine& machine) const;
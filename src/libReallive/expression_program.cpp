@@ -0,0 +1,235 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "libReallive/expression_program.h"
+
+#include "libReallive/expression.h"
+#include "libReallive/intmemref.h"
+#include "MachineBase/Memory.hpp"
+#include "MachineBase/RLMachine.hpp"
+
+namespace libReallive {
+
+namespace {
+
+// Programs are evaluated on a fixed size stack. Expressions in real games are
+// nowhere near this deep; anything that is gets the tree walk instead.
+const int kMaxStackDepth = 32;
+
+// Reads |location| out of |bank| with the given access type. Mirrors
+// Memory::getIntValue(), which we defer to when the location is out of range
+// so that the usual error gets thrown.
+inline int loadInt(RLMachine& machine, int* bank, int bank_index, int access,
+                   int location) {
+  if (access == 0) {
+    if (static_cast<unsigned int>(location) < SIZE_OF_MEM_BANK)
+      return bank[location];
+  } else {
+    // Ab[]..Z8b[] pack 32 >> (access - 1) elements into each int.
+    int factor = 1 << (access - 1);
+    int elt_shift = 6 - access;
+    if (static_cast<unsigned int>(location) < (64000u / factor)) {
+      return (bank[location >> elt_shift] >>
+              ((location & ((1 << elt_shift) - 1)) * factor)) &
+          ((1 << factor) - 1);
+    }
+  }
+
+  return machine.getIntValue(IntMemRef(bank_index, access, location));
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// ExpressionProgram
+// -----------------------------------------------------------------------
+ExpressionProgram::ExpressionProgram(const ExpressionPiece& root)
+    : depth_(0),
+      max_depth_(0),
+      valid_(false) {
+  valid_ = root.compileTo(*this) && depth_ == 1 &&
+           max_depth_ <= kMaxStackDepth;
+  if (!valid_)
+    instructions_.clear();
+}
+
+ExpressionProgram::~ExpressionProgram() {}
+
+// static
+const ExpressionProgram& ExpressionProgram::cached(
+    boost::scoped_ptr<ExpressionProgram>& slot, const ExpressionPiece& root) {
+  if (!slot)
+    slot.reset(new ExpressionProgram(root));
+  return *slot;
+}
+
+int ExpressionProgram::run(RLMachine& machine) const {
+  Memory& memory = machine.memory();
+  int* banks[INTL_LOCATION + 1] = { NULL };
+
+  int stack[kMaxStackDepth];
+  int* top = stack;
+
+  for (std::vector<Instruction>::const_iterator it = instructions_.begin();
+       it != instructions_.end(); ++it) {
+    switch (it->op) {
+    case PUSH_CONSTANT:
+      *top++ = it->value;
+      break;
+    case LOAD_STORE_REGISTER:
+      *top++ = machine.getStoreRegisterValue();
+      break;
+    case STORE_STORE_REGISTER:
+      machine.setStoreRegister(top[-1]);
+      break;
+    case LOAD_MEMORY: {
+      int*& bank = banks[it->bank];
+      if (!bank)
+        bank = memory.intBank(it->bank);
+      top[-1] = loadInt(machine, bank, it->bank, it->access, top[-1]);
+      break;
+    }
+    case STORE_MEMORY:
+      // Writes go through Memory so that savepoint change tracking sees them.
+      --top;
+      machine.setIntValue(IntMemRef(it->bank, it->access, top[-1]), top[0]);
+      top[-1] = top[0];
+      break;
+    case DUPLICATE:
+      *top = top[-1];
+      ++top;
+      break;
+    case NEGATE:
+      top[-1] = -top[-1];
+      break;
+    default: {
+      --top;
+      int lhs = top[-1];
+      int rhs = top[0];
+      int result = 0;
+      switch (it->op) {
+      case ADD:              result = lhs + rhs; break;
+      case SUBTRACT:         result = lhs - rhs; break;
+      case MULTIPLY:         result = lhs * rhs; break;
+      case DIVIDE:           result = rhs != 0 ? lhs / rhs : lhs; break;
+      case MODULO:           result = rhs != 0 ? lhs % rhs : lhs; break;
+      case BIT_AND:          result = lhs & rhs; break;
+      case BIT_OR:           result = lhs | rhs; break;
+      case BIT_XOR:          result = lhs ^ rhs; break;
+      case SHIFT_LEFT:       result = lhs << rhs; break;
+      case SHIFT_RIGHT:      result = lhs >> rhs; break;
+      case EQUAL:            result = lhs == rhs; break;
+      case NOT_EQUAL:        result = lhs != rhs; break;
+      case LESS_OR_EQUAL:    result = lhs <= rhs; break;
+      case LESS:             result = lhs <  rhs; break;
+      case GREATER_OR_EQUAL: result = lhs >= rhs; break;
+      case GREATER:          result = lhs >  rhs; break;
+      case LOGICAL_AND:      result = lhs && rhs; break;
+      case LOGICAL_OR:       result = lhs || rhs; break;
+      }
+      top[-1] = result;
+      break;
+    }
+    }
+  }
+
+  return stack[0];
+}
+
+void ExpressionProgram::addConstant(int value) {
+  add(PUSH_CONSTANT, 0, 0, value);
+}
+
+void ExpressionProgram::addInstruction(Opcode op) {
+  add(op, 0, 0, 0);
+}
+
+bool ExpressionProgram::addMemoryAccess(Opcode op, int bank, int access) {
+  if (bank < 0 || bank > INTL_LOCATION || access < 0 || access > 4)
+    return false;
+
+  add(op, bank, access, 0);
+  return true;
+}
+
+bool ExpressionProgram::addOperator(char operation) {
+  // Operations 0-9 and 20-29 (their compound assignment forms) are the same
+  // arithmetic; see BinaryExpressionOperator::performOperationOn().
+  static const Opcode arithmetic[] = {
+    ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULO, BIT_AND, BIT_OR, BIT_XOR,
+    SHIFT_LEFT, SHIFT_RIGHT
+  };
+  static const Opcode comparisons[] = {
+    EQUAL, NOT_EQUAL, LESS_OR_EQUAL, LESS, GREATER_OR_EQUAL, GREATER
+  };
+
+  int op = operation;
+  if (op >= 0 && op <= 9)
+    addInstruction(arithmetic[op]);
+  else if (op >= 20 && op <= 29)
+    addInstruction(arithmetic[op - 20]);
+  else if (op >= 40 && op <= 45)
+    addInstruction(comparisons[op - 40]);
+  else if (op == 60)
+    addInstruction(LOGICAL_AND);
+  else if (op == 61)
+    addInstruction(LOGICAL_OR);
+  else
+    return false;
+
+  return true;
+}
+
+void ExpressionProgram::add(Opcode op, int bank, int access, int value) {
+  Instruction instruction;
+  instruction.op = op;
+  instruction.bank = bank;
+  instruction.access = access;
+  instruction.value = value;
+  instructions_.push_back(instruction);
+
+  switch (op) {
+  case PUSH_CONSTANT:
+  case LOAD_STORE_REGISTER:
+  case DUPLICATE:
+    depth_++;
+    break;
+  case STORE_STORE_REGISTER:
+  case LOAD_MEMORY:
+  case NEGATE:
+    break;
+  default:
+    // STORE_MEMORY and the binary operators pop two and push one.
+    depth_--;
+    break;
+  }
+
+  if (depth_ > max_depth_)
+    max_depth_ = depth_;
+}
+
+}  // namespace libReallive
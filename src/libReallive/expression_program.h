@@ -0,0 +1,125 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef EXPRESSION_PROGRAM_H
+#define EXPRESSION_PROGRAM_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <vector>
+
+class RLMachine;
+
+namespace libReallive {
+
+class ExpressionPiece;
+
+// An integer ExpressionPiece tree flattened into a postfix program for a small
+// stack machine. Evaluating an expression by walking the tree costs a virtual
+// call per node and an IntMemRef decode plus several calls into Memory per
+// memory reference; a program is a single loop over an instruction vector
+// that reads memory banks directly.
+//
+// Trees are compiled lazily, the first time their root is evaluated. Anything
+// that can't be compiled (string values, unknown operators, absurdly deep
+// expressions) leaves the program invalid and the caller walks the tree.
+class ExpressionProgram : public boost::noncopyable {
+ public:
+  enum Opcode {
+    PUSH_CONSTANT,
+    LOAD_STORE_REGISTER,
+    STORE_STORE_REGISTER,
+    LOAD_MEMORY,
+    STORE_MEMORY,
+    DUPLICATE,
+    NEGATE,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    BIT_AND,
+    BIT_OR,
+    BIT_XOR,
+    SHIFT_LEFT,
+    SHIFT_RIGHT,
+    EQUAL,
+    NOT_EQUAL,
+    LESS_OR_EQUAL,
+    LESS,
+    GREATER_OR_EQUAL,
+    GREATER,
+    LOGICAL_AND,
+    LOGICAL_OR
+  };
+
+  // Compiles |root|.
+  explicit ExpressionProgram(const ExpressionPiece& root);
+  ~ExpressionProgram();
+
+  // Returns the program cached in |slot|, compiling |root| into it first if
+  // this is the first time it has been asked for.
+  static const ExpressionProgram& cached(
+      boost::scoped_ptr<ExpressionProgram>& slot, const ExpressionPiece& root);
+
+  // Whether the whole tree compiled. run() must not be called otherwise.
+  bool valid() const { return valid_; }
+
+  // Evaluates the program against |machine|'s memory.
+  int run(RLMachine& machine) const;
+
+  // Emitters used by ExpressionPiece::compileTo(). The ones returning bool
+  // return false if their arguments can't be compiled.
+  void addConstant(int value);
+  void addInstruction(Opcode op);
+  bool addMemoryAccess(Opcode op, int bank, int access);
+  bool addOperator(char operation);
+
+ private:
+  struct Instruction {
+    unsigned char op;
+    unsigned char bank;
+    unsigned char access;
+    int value;
+  };
+
+  void add(Opcode op, int bank, int access, int value);
+
+  std::vector<Instruction> instructions_;
+
+  // Stack depth after the last emitted instruction, and the deepest the stack
+  // gets anywhere in the program.
+  int depth_;
+  int max_depth_;
+
+  bool valid_;
+};
+
+}  // namespace libReallive
+
+#endif
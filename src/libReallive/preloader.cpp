@@ -0,0 +1,94 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "preloader.h"
+
+#include <boost/bind.hpp>
+
+#include "archive.h"
+
+namespace libReallive {
+
+ScenarioPreloader::ScenarioPreloader(Archive& archive, int num_threads)
+    : archive_(archive),
+      num_threads_(num_threads),
+      stopping_(false) {
+  for (int i = 0; i < num_threads_; ++i)
+    workers_.create_thread(boost::bind(&ScenarioPreloader::workerLoop, this));
+}
+
+ScenarioPreloader::~ScenarioPreloader() {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+    queued_.clear();
+  }
+  work_available_.notify_all();
+  workers_.join_all();
+}
+
+void ScenarioPreloader::enqueue(int index, bool urgent) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (stopping_ || !queued_.insert(index).second)
+      return;
+
+    if (urgent)
+      queue_.push_front(index);
+    else
+      queue_.push_back(index);
+  }
+  work_available_.notify_one();
+}
+
+void ScenarioPreloader::workerLoop() {
+  while (true) {
+    int index;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!stopping_ && queue_.empty())
+        work_available_.wait(lock);
+
+      if (stopping_)
+        return;
+
+      index = queue_.front();
+      queue_.pop_front();
+      queued_.erase(index);
+    }
+
+    try {
+      archive_.scenario(index);
+    } catch (...) {
+      // The interpreter thread will hit the same error (and report it
+      // properly) if it ever needs this scenario.
+    }
+  }
+}
+
+}  // namespace libReallive
@@ -0,0 +1,85 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#ifndef PRELOADER_H
+#define PRELOADER_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <deque>
+#include <set>
+
+namespace libReallive {
+
+class Archive;
+
+// A pool of worker threads that parse scenarios out of an Archive ahead of
+// the interpreter needing them. Workers just call Archive::scenario(), which
+// does all the bookkeeping about which scenarios are already parsed or are
+// being parsed right now; a parse error in the background is swallowed so
+// that it is reported normally when the interpreter asks for the scenario.
+class ScenarioPreloader : public boost::noncopyable {
+ public:
+  ScenarioPreloader(Archive& archive, int num_threads);
+
+  // Stops all workers, waiting for any in progress parse to finish.
+  ~ScenarioPreloader();
+
+  // Queues SEEN |index| for parsing. |urgent| requests jump to the front of
+  // the queue; they're likely to be needed in the next few seconds, unlike
+  // the bulk requests from Archive::preparseAll().
+  void enqueue(int index, bool urgent);
+
+  int numThreads() const { return num_threads_; }
+
+ private:
+  // Main loop of each worker thread.
+  void workerLoop();
+
+  Archive& archive_;
+  int num_threads_;
+
+  // Guards everything below.
+  boost::mutex mutex_;
+  boost::condition_variable work_available_;
+
+  std::deque<int> queue_;
+
+  // The contents of |queue_|, so we don't queue the same SEEN twice.
+  std::set<int> queued_;
+
+  bool stopping_;
+
+  boost::thread_group workers_;
+};
+
+}  // namespace libReallive
+
+#endif
@@ -138,8 +138,10 @@ Script::Script(const Header& hdr, const char* data, const size_t length,
     }
   }
 
-  /// @todo Removed auto_ptr because of new[] / delete mismatch
-  char* uncompressed = new char[dlen];
+  // The elements we read below keep pointers into this buffer instead of
+  // copying their data out, so it's kept until the Script is destroyed.
+  this->data.reset(new char[dlen]);
+  char* uncompressed = this->data.get();
   Compression::decompress(data + read_i32(data + 0x20),
                           read_i32(data + 0x28),
                           uncompressed,
@@ -171,8 +173,6 @@ Script::Script(const Header& hdr, const char* data, const size_t length,
   for (pointer_t it = elts.begin(); it != elts.end(); ++it) {
     it->set_pointers(cdat);
   }
-
-  delete [] uncompressed;
 }
 
 const pointer_t Script::getEntrypoint(int entrypoint) const {
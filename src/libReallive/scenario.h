@@ -37,6 +37,8 @@
 #include "defs.h"
 #include "bytecode.h"
 
+#include <boost/scoped_array.hpp>
+
 namespace libReallive {
 
 namespace Compression {
@@ -81,6 +83,10 @@ public:
   const_iterator begin() const;
   const_iterator end() const;
   const size_t size() const;
+
+  // An estimate of how much memory this scenario occupies: its decompressed
+  // bytecode plus a fixed cost for each element.
+  const size_t memoryUsage() const;
 };
 
 // Inline definitions for Scenario
@@ -137,6 +143,13 @@ Scenario::size() const
   return script.elts.size();
 }
 
+inline const size_t
+Scenario::memoryUsage() const
+{
+  // Rough per-element cost: the element object plus its list node.
+  return script.lencache + script.elts.size() * 64;
+}
+
 }
 
 #endif
@@ -66,6 +66,10 @@ private:
   mutable bool uptodate;
   mutable size_t lencache;
 
+  // The decompressed bytecode. Elements in |elts| point into this buffer, so
+  // it lives exactly as long as they do.
+  boost::scoped_array<char> data;
+
   BytecodeList elts;
   bool strip;
 
@@ -35,7 +35,7 @@
 #include <boost/shared_ptr.hpp>
 
 TestTextSystem::TestTextSystem(System& system, Gameexe& gexe)
-    : TextSystem(system, gexe) {}
+    : TextSystem(system, gexe), glyphs_rendered_(0) {}
 
 TestTextSystem::~TestTextSystem() { }
 
@@ -61,8 +61,17 @@ class TestTextSystem : public TextSystem {
       const RGBColour* shadow_colour,
       int insertion_point_x,
       int insertion_point_y,
-      const boost::shared_ptr<Surface>& destination) { return Size(20, 20); }
+      const boost::shared_ptr<Surface>& destination) {
+    ++glyphs_rendered_;
+    return Size(20, 20);
+  }
   int charWidth(int size, uint16_t codepoint) { return 20; }
+
+  // How many glyphs have actually been drawn, as opposed to laid out.
+  int glyphsRendered() const { return glyphs_rendered_; }
+
+ private:
+  int glyphs_rendered_;
 };
 
 #endif  // TEST_TESTSYSTEM_TESTTEXTSYSTEM_HPP_
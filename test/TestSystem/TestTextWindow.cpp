@@ -70,10 +70,13 @@ void TestTextWindow::setFontColor(const std::vector<int>& colour_data) {
   TextWindow::setFontColor(colour_data);
 }
 
-bool TestTextWindow::character(const std::string& current,
-                               const std::string& next) {
-  bool ret = TextWindow::character(current, next);
-  // Must record after we've called superclass because character() can
+bool TestTextWindow::displayCharacter(const std::string& current,
+                                      int char_width,
+                                      std::string::const_iterator rest,
+                                      std::string::const_iterator rest_end) {
+  bool ret = TextWindow::displayCharacter(current, char_width, rest,
+                                          rest_end);
+  // Must record after we've called superclass because displayCharacter() can
   // linebreak.
   current_contents_ += current;
   return ret;
@@ -38,8 +38,6 @@ class TestTextWindow : public TextWindow {
 
   virtual void setFontColor(const std::vector<int>& colour_data);
 
-  virtual bool character(const std::string& current,
-                         const std::string& next);
   virtual int charWidth(uint16_t codepoint) const { return 0; }
 
   virtual boost::shared_ptr<Surface> textSurface();
@@ -62,6 +60,13 @@ class TestTextWindow : public TextWindow {
 
   virtual void addSelectionItem(const std::string& utf8str, int selection_id) {}
 
+ protected:
+  // Records each character as it is laid out, whether it arrived through
+  // character() or as part of a run passed to characters().
+  virtual bool displayCharacter(const std::string& current, int char_width,
+                                std::string::const_iterator rest,
+                                std::string::const_iterator rest_end);
+
  private:
   std::string current_contents_;
 
@@ -0,0 +1,107 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/cstdint.hpp>
+#include <vector>
+
+#include "Systems/Base/ColourTransforms.hpp"
+
+using boost::uint32_t;
+
+namespace {
+
+// Pixels with every channel, alpha included, set from a fixed pseudo random
+// sequence.
+std::vector<uint32_t> noise(size_t count) {
+  std::vector<uint32_t> pixels(count);
+  uint32_t state = 12345;
+  for (size_t i = 0; i < count; ++i) {
+    state = state * 1103515245 + 12345;
+    pixels[i] = state ^ (state >> 16);
+  }
+  return pixels;
+}
+
+const PixelLayout kARGB(16, 8, 0, 0x00ffffff);
+const PixelLayout kABGR(0, 8, 16, 0x00ffffff);
+
+// Runs |kernel| over rows of every width from 1 to 37 pixels, starting at
+// every offset from 0 to 3 so that the four pixel blocks are misaligned and
+// leave every size of tail. Compares the overload, which uses SSE2 where it
+// is available, against the one pixel at a time template.
+template<typename Kernel>
+void expectRowsMatchScalar(const PixelLayout& layout, const Kernel& kernel) {
+  const std::vector<uint32_t> input = noise(64);
+  for (int offset = 0; offset < 4; ++offset) {
+    for (int width = 1; width <= 37; ++width) {
+      std::vector<uint32_t> fast(input), scalar(input);
+      TransformRow(&fast[offset], width, layout, kernel);
+      TransformRow<Kernel>(&scalar[offset], width, layout, kernel);
+      ASSERT_EQ(scalar, fast) << "offset " << offset << ", width " << width;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ColourTransformsTest, InvertMatchesScalar) {
+  expectRowsMatchScalar(kARGB, InvertKernel());
+  expectRowsMatchScalar(kABGR, InvertKernel());
+}
+
+TEST(ColourTransformsTest, MonoMatchesScalar) {
+  expectRowsMatchScalar(kARGB, MonoKernel());
+  expectRowsMatchScalar(kABGR, MonoKernel());
+}
+
+// Every grey and the pure channels, where rounding and clamping matter most.
+TEST(ColourTransformsTest, MonoMatchesScalarOnEdgeColours) {
+  std::vector<uint32_t> input;
+  for (uint32_t i = 0; i < 256; ++i)
+    input.push_back(0x80000000 | (i << 16) | (i << 8) | i);
+  input.push_back(0xffff0000);
+  input.push_back(0xff00ff00);
+  input.push_back(0xff0000ff);
+
+  std::vector<uint32_t> fast(input), scalar(input);
+  MonoKernel kernel;
+  TransformRow(&fast[0], fast.size(), kARGB, kernel);
+  TransformRow<MonoKernel>(&scalar[0], scalar.size(), kARGB, kernel);
+  EXPECT_EQ(scalar, fast);
+
+  // Greys stay grey, and alpha is left alone.
+  EXPECT_EQ(0x80000000u, fast[0]);
+  EXPECT_EQ(0x80ffffffu, fast[255]);
+}
+
+TEST(ColourTransformsTest, InvertLeavesAlpha) {
+  uint32_t pixel = 0x7f102030;
+  TransformRow(&pixel, 1, kARGB, InvertKernel());
+  EXPECT_EQ(0x7fefdfcfu, pixel);
+}
@@ -31,6 +31,7 @@
 #include "MachineBase/RLMachine.hpp"
 #include "Effects/Effect.hpp"
 #include "Effects/BlindEffect.hpp"
+#include "Systems/Base/TextSystem.hpp"
 #include "TestSystem/MockSurface.hpp"
 #include "TestSystem/TestSystem.hpp"
 #include "TestSystem/TestEventSystem.hpp"
@@ -97,6 +98,25 @@ TEST_F(EffectTest, TestBase) {
   EXPECT_TRUE((*effect)(rlmachine)) << "We didn't quit?";
 }
 
+// Transitions started while skipping read text are never drawn; they finish
+// on their first frame.
+TEST_F(EffectTest, EffectBuiltWhileSkippingFinishesImmediately) {
+  shared_ptr<Surface> src(MockSurface::Create("src"));
+  shared_ptr<Surface> dst(MockSurface::Create("dst"));
+
+  system.text().setKidokuRead(1);
+  system.text().setSkipMode(1);
+  scoped_ptr<MockEffect> effect(
+    new MockEffect(rlmachine, src, dst, Size(640, 480), 100));
+
+  // Even if skipping stops before the effect runs.
+  system.text().setKidokuRead(0);
+
+  EXPECT_CALL(*effect, blitOriginalImage()).Times(0);
+  EXPECT_CALL(*effect, performEffectForTime(_, _)).Times(0);
+  EXPECT_TRUE((*effect)(rlmachine)) << "Effect drew a frame while skipping";
+}
+
 // -----------------------------------------------------------------------
 
 class MockBlitTopToBottom : public BlindTopToBottomEffect {
@@ -0,0 +1,151 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+// Microbenchmark for the codepage converters. Pulls every textout string out
+// of a SEEN.TXT and converts the lot to UTF-8, both through the wide string
+// path (Codepage::ConvertString()) and directly
+// (Codepage::ConvertStringToUTF8()).
+//
+// Usage: encodingBenchmark <path to SEEN.TXT> [encoding] [passes]
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Encodings/codepage.h"
+#include "libReallive/archive.h"
+#include "libReallive/bytecode.h"
+#include "libReallive/scenario.h"
+#include "utf8cpp/utf8.h"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+using libReallive::Archive;
+using libReallive::Scenario;
+using libReallive::TextoutElement;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Returns the total size in bytes of every textout in |archive|.
+static size_t collectText(Archive& archive, vector<string>& strings) {
+  size_t bytes = 0;
+  for (Archive::const_iterator it = archive.begin(); it != archive.end();
+       ++it) {
+    Scenario* scenario = archive.scenario(it->first);
+    if (!scenario)
+      continue;
+
+    for (Scenario::const_iterator jt = scenario->begin();
+         jt != scenario->end(); ++jt) {
+      const TextoutElement* textout =
+          dynamic_cast<const TextoutElement*>(&*jt);
+      if (textout) {
+        strings.push_back(textout->text());
+        bytes += strings.back().size();
+      }
+    }
+  }
+
+  return bytes;
+}
+
+static size_t convertThroughWideString(const Codepage& cp,
+                                       const vector<string>& strings) {
+  size_t out_bytes = 0;
+  for (vector<string>::const_iterator it = strings.begin();
+       it != strings.end(); ++it) {
+    std::wstring ws = cp.ConvertString(*it);
+    string out;
+    utf8::utf16to8(ws.begin(), ws.end(), std::back_inserter(out));
+    out_bytes += out.size();
+  }
+  return out_bytes;
+}
+
+static size_t convertDirectly(const Codepage& cp,
+                              const vector<string>& strings) {
+  size_t out_bytes = 0;
+  for (vector<string>::const_iterator it = strings.begin();
+       it != strings.end(); ++it) {
+    out_bytes += cp.ConvertStringToUTF8(*it).size();
+  }
+  return out_bytes;
+}
+
+static void report(const string& name, size_t in_bytes, int passes,
+                   const ptime& start, const ptime& end) {
+  double seconds = (end - start).total_microseconds() / 1000000.0;
+  double megabytes = in_bytes * passes / (1024.0 * 1024.0);
+  cout << name << ": " << seconds << "s, "
+       << (seconds > 0 ? megabytes / seconds : 0) << " MB/s" << endl;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <SEEN.TXT> [encoding] [passes]" << endl;
+    return 1;
+  }
+
+  int encoding = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 0;
+  int passes = argc > 3 ? boost::lexical_cast<int>(argv[3]) : 20;
+
+  Archive archive(argv[1]);
+  vector<string> strings;
+  size_t in_bytes = collectText(archive, strings);
+  cout << strings.size() << " textout strings, " << in_bytes << " bytes"
+       << endl;
+
+  const Codepage& cp = Cp::instance(encoding);
+  size_t wide_bytes = 0, direct_bytes = 0;
+
+  ptime start = microsec_clock::universal_time();
+  for (int i = 0; i < passes; ++i)
+    wide_bytes = convertThroughWideString(cp, strings);
+  ptime end = microsec_clock::universal_time();
+  report("ConvertString + utf16to8", in_bytes, passes, start, end);
+
+  start = microsec_clock::universal_time();
+  for (int i = 0; i < passes; ++i)
+    direct_bytes = convertDirectly(cp, strings);
+  end = microsec_clock::universal_time();
+  report("ConvertStringToUTF8", in_bytes, passes, start, end);
+
+  if (wide_bytes != direct_bytes) {
+    cerr << "Output sizes differ: " << wide_bytes << " vs " << direct_bytes
+         << endl;
+    return 1;
+  }
+
+  return 0;
+}
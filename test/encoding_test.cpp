@@ -0,0 +1,136 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "Encodings/codepage.h"
+#include "utf8cpp/utf8.h"
+
+using std::string;
+
+// Strings that mix long ASCII runs (to cross the sixteen byte and machine
+// word blocks in the ASCII scan) with multibyte characters at different
+// alignments.
+static string mixedText(const string& multibyte) {
+  string out;
+  for (int i = 0; i < 20; ++i) {
+    out += string(i, 'a');
+    out += multibyte;
+  }
+  out += "The quick brown fox jumps over the lazy dog.";
+  return out;
+}
+
+// Every override of ConvertStringToUTF8() must give exactly what the
+// original per-character path through ConvertString() gives, including
+// throwing on characters the codepage has no mapping for.
+static void expectSameAsWidePath(int codepage, const string& input) {
+  Codepage& cp = Cp::instance(codepage);
+  string expected;
+  try {
+    expected = cp.Codepage::ConvertStringToUTF8(input);
+  } catch (const utf8::invalid_code_point&) {
+    EXPECT_THROW(cp.ConvertStringToUTF8(input), utf8::invalid_code_point)
+        << "codepage " << codepage;
+    return;
+  }
+
+  EXPECT_EQ(expected, cp.ConvertStringToUTF8(input))
+      << "codepage " << codepage;
+}
+
+TEST(EncodingTest, Ascii) {
+  const string text =
+      "Plain 7-bit text that is long enough for several blocks, "
+      "with punctuation: []{}()<>!?";
+  for (int codepage = 0; codepage <= 3; ++codepage) {
+    expectSameAsWidePath(codepage, "");
+    expectSameAsWidePath(codepage, "x");
+    expectSameAsWidePath(codepage, text);
+    EXPECT_EQ(text, Cp::instance(codepage).ConvertStringToUTF8(text));
+  }
+}
+
+TEST(EncodingTest, Cp932) {
+  // Hiragana, kanji, a full-width space and half-width katakana.
+  const string japanese = "\x82\xa0\x82\xa2\x8a\xbf\x8e\x9a\x81\x40\xb1\xb2";
+  expectSameAsWidePath(0, japanese);
+  expectSameAsWidePath(0, mixedText(japanese));
+
+  // Lead bytes followed by bytes that aren't valid trail bytes, and pairs
+  // with no mapping.
+  expectSameAsWidePath(0, mixedText("\x81\x20\x9f\x7f\xef\xfc\x85\x40"));
+}
+
+TEST(EncodingTest, Cp936) {
+  // "Chinese" in GBK, plus an ideographic full stop.
+  const string chinese = "\xd6\xd0\xce\xc4\xa1\xa3";
+  expectSameAsWidePath(1, chinese);
+  expectSameAsWidePath(1, mixedText(chinese));
+
+  // Pairs outside the mapped ranges.
+  expectSameAsWidePath(1, mixedText("\x81\x20\xfe\xff\xa2\xa0"));
+}
+
+TEST(EncodingTest, Cp949) {
+  // "Korean" in Hangul, plus a hanja.
+  const string korean = "\xc7\xd1\xb1\xb9\xbe\xee\xca\xa1";
+  expectSameAsWidePath(3, korean);
+  expectSameAsWidePath(3, mixedText(korean));
+
+  // Pairs outside the mapped ranges.
+  expectSameAsWidePath(3, mixedText("\x81\x20\xc9\xa1\xfe\xff"));
+}
+
+TEST(EncodingTest, Cp1252) {
+  // Accented letters, curly quotes, the euro sign and the bytes that
+  // Windows-1252 leaves undefined.
+  const string western = "\xe9\xe8\xfc\x93quoted\x94\x80\x81\x8d\x8f\x90\x9d";
+  expectSameAsWidePath(2, western);
+  expectSameAsWidePath(2, mixedText(western));
+
+  // Every byte Windows-1252 defines, and then every byte at all.
+  string defined, every_byte;
+  for (int c = 1; c < 256; ++c) {
+    every_byte += static_cast<char>(c);
+    if (c != 0x81 && c != 0x8d && c != 0x8f && c != 0x90 && c != 0x9d)
+      defined += static_cast<char>(c);
+  }
+  expectSameAsWidePath(2, defined);
+  expectSameAsWidePath(2, every_byte);
+}
+
+TEST(EncodingTest, TruncatedMultibyteCharacter) {
+  // A lead byte with nothing after it. The wide path reads past the end
+  // of the string here, so only check that the direct conversion keeps
+  // the text before it and stops.
+  EXPECT_EQ("abc", Cp::instance(1).ConvertStringToUTF8("abc\xd6"));
+  EXPECT_EQ("abc", Cp::instance(3).ConvertStringToUTF8("abc\xc7"));
+  EXPECT_EQ(0u, Cp::instance(0).ConvertStringToUTF8("abc\x82").find("abc"));
+}
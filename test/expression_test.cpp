@@ -30,8 +30,11 @@
 #include "MachineBase/RLMachine.hpp"
 #include "Modules/Module_Jmp.hpp"
 #include "TestSystem/TestSystem.hpp"
+#include "Utilities/Exception.hpp"
 #include "libReallive/archive.h"
 #include "libReallive/expression.h"
+#include "libReallive/expression_pieces.h"
+#include "libReallive/expression_program.h"
 #include "libReallive/intmemref.h"
 
 #include "testUtils.hpp"
@@ -131,3 +134,60 @@ TEST(ExpressionTest, PreviousErrors) {
 }
 
 
+
+// Builds expression trees by hand and checks that the compiled programs that
+// now evaluate them agree with the values the tree walk used to produce,
+// including bit-packed banks, the store register and compound assignment.
+TEST(ExpressionTest, CompiledPrograms) {
+  TestSystem system;
+  libReallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  RLMachine rlmachine(system, arc);
+
+  rlmachine.setIntValue(IntMemRef('A', 0), 5);
+  rlmachine.setIntValue(IntMemRef('B', "b", 8), 1);
+  rlmachine.setStoreRegister(3);
+
+  // intBb[intA[0] + 3] * -store
+  BinaryExpressionOperator product(
+      2,
+      new MemoryReference(27, new BinaryExpressionOperator(
+          0, new MemoryReference(0, new IntegerConstant(0)),
+          new IntegerConstant(3))),
+      new UniaryExpressionOperator(1, new StoreRegisterExpressionPiece));
+  EXPECT_TRUE(ExpressionProgram(product).valid());
+  EXPECT_EQ(-3, product.integerValue(rlmachine));
+
+  // intA[1] += 10 / intA[0]
+  AssignmentExpressionOperator add_assign(
+      20, new MemoryReference(0, new IntegerConstant(1)),
+      new BinaryExpressionOperator(
+          3, new IntegerConstant(10),
+          new MemoryReference(0, new IntegerConstant(0))));
+  EXPECT_TRUE(ExpressionProgram(add_assign).valid());
+  EXPECT_EQ(2, add_assign.integerValue(rlmachine));
+  EXPECT_EQ(4, add_assign.integerValue(rlmachine));
+  EXPECT_EQ(4, rlmachine.getIntValue(IntMemRef('A', 1)));
+
+  // store = intA[0] == 5 && intA[1] >= 4
+  AssignmentExpressionOperator store_assign(
+      30, new StoreRegisterExpressionPiece,
+      new BinaryExpressionOperator(
+          60,
+          new BinaryExpressionOperator(
+              40, new MemoryReference(0, new IntegerConstant(0)),
+              new IntegerConstant(5)),
+          new BinaryExpressionOperator(
+              44, new MemoryReference(0, new IntegerConstant(1)),
+              new IntegerConstant(4))));
+  EXPECT_EQ(1, store_assign.integerValue(rlmachine));
+  EXPECT_EQ(1, rlmachine.getStoreRegisterValue());
+
+  // Out of range accesses still throw the usual error.
+  MemoryReference out_of_range(0, new IntegerConstant(2000));
+  EXPECT_THROW(out_of_range.integerValue(rlmachine), rlvm::Exception);
+
+  // Strings can't be compiled.
+  MemoryReference string_ref(STRS_LOCATION, new IntegerConstant(0));
+  EXPECT_FALSE(ExpressionProgram(string_ref).valid());
+}
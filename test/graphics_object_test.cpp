@@ -250,4 +250,36 @@ TEST_F(GraphicsObjectTest, GetObjectData) {
   EXPECT_EQ(data, &obj.objectData());
 }
 
+// Only changes that can move an object in or out of the sorted render list,
+// or reorder it, should make GraphicsSystem rebuild that list.
+TEST_F(GraphicsObjectTest, RenderListGeneration) {
+  GraphicsObject obj;
+  unsigned int generation = GraphicsObject::renderListGeneration();
+
+  obj.setX(20);
+  obj.setAlpha(128);
+  EXPECT_EQ(generation, GraphicsObject::renderListGeneration())
+      << "Moving and fading don't reorder anything";
+
+  obj.setZOrder(5);
+  EXPECT_NE(generation, GraphicsObject::renderListGeneration());
+  generation = GraphicsObject::renderListGeneration();
+
+  obj.setZOrder(5);
+  obj.setVisible(0);
+  EXPECT_EQ(generation, GraphicsObject::renderListGeneration())
+      << "Setting the same values again is not a change";
+
+  obj.setVisible(1);
+  EXPECT_NE(generation, GraphicsObject::renderListGeneration());
+  generation = GraphicsObject::renderListGeneration();
+
+  obj.setObjectData(new MockGraphicsObjectData);
+  EXPECT_NE(generation, GraphicsObject::renderListGeneration());
+  generation = GraphicsObject::renderListGeneration();
+
+  obj.clearObject();
+  EXPECT_NE(generation, GraphicsObject::renderListGeneration());
+}
+
 // TODO: Use the above mock to test more of the insides of GraphicsObject...
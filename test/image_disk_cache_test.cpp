@@ -0,0 +1,172 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+
+#include "Systems/Base/ImageDiskCache.hpp"
+
+namespace fs = boost::filesystem;
+
+class ImageDiskCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    root_ = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(root_);
+    source_ = root_ / "bg01.g00";
+    writeSource(source_, "original");
+
+    metadata_.size = Size(2, 1);
+    metadata_.is_mask = true;
+    Surface::GrpRect rect;
+    rect.rect = Rect::REC(0, 0, 1, 1);
+    rect.originX = 3;
+    rect.originY = 4;
+    metadata_.region_table.push_back(rect);
+  }
+
+  virtual void TearDown() {
+    fs::remove_all(root_);
+  }
+
+  void writeSource(const fs::path& path, const std::string& contents) {
+    std::ofstream out(path.string().c_str());
+    out << contents;
+  }
+
+  fs::path root_;
+  fs::path source_;
+  ImageDiskCache::Metadata metadata_;
+};
+
+static const char kPixels[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+TEST_F(ImageDiskCacheTest, RoundTrip) {
+  ImageDiskCache cache(root_ / "cache", 1024 * 1024);
+  ImageDiskCache::Metadata loaded;
+  EXPECT_EQ(NULL, cache.load(source_, loaded));
+
+  cache.store(source_, metadata_, kPixels);
+
+  // A second cache on the same directory sees what the first one stored.
+  ImageDiskCache reopened(root_ / "cache", 1024 * 1024);
+  char* pixels = reopened.load(source_, loaded);
+  ASSERT_TRUE(pixels);
+  EXPECT_EQ(0, memcmp(kPixels, pixels, sizeof(kPixels)));
+  free(pixels);
+
+  EXPECT_EQ(Size(2, 1), loaded.size);
+  EXPECT_TRUE(loaded.is_mask);
+  ASSERT_EQ(1u, loaded.region_table.size());
+  EXPECT_EQ(Rect::REC(0, 0, 1, 1), loaded.region_table[0].rect);
+  EXPECT_EQ(3, loaded.region_table[0].originX);
+  EXPECT_EQ(4, loaded.region_table[0].originY);
+}
+
+TEST_F(ImageDiskCacheTest, ChangedSourceMisses) {
+  ImageDiskCache cache(root_ / "cache", 1024 * 1024);
+  cache.store(source_, metadata_, kPixels);
+
+  writeSource(source_, "patched by a fan translation");
+  fs::last_write_time(source_, fs::last_write_time(source_) + 10);
+
+  ImageDiskCache::Metadata loaded;
+  EXPECT_EQ(NULL, cache.load(source_, loaded));
+}
+
+// The entry's file name is only a hash, so load() must also check the size
+// and modification time recorded inside it.
+TEST_F(ImageDiskCacheTest, MismatchedHeaderMisses) {
+  ImageDiskCache cache(root_ / "cache", 1024 * 1024);
+  cache.store(source_, metadata_, kPixels);
+
+  fs::directory_iterator it(root_ / "cache");
+  fs::path entry = it->path();
+
+  // Overwrite the stored size (just after the magic), then the stored
+  // modification time (just after the size).
+  const std::streamoff fields[] = { 8, 16 };
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+    std::fstream file(entry.string().c_str(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    boost::int64_t original;
+    file.seekg(fields[i]);
+    file.read(reinterpret_cast<char*>(&original), sizeof(original));
+
+    boost::int64_t changed = original + 1;
+    file.seekp(fields[i]);
+    file.write(reinterpret_cast<const char*>(&changed), sizeof(changed));
+    file.flush();
+
+    ImageDiskCache::Metadata loaded;
+    EXPECT_EQ(NULL, cache.load(source_, loaded)) << "field at " << fields[i];
+
+    file.seekp(fields[i]);
+    file.write(reinterpret_cast<const char*>(&original), sizeof(original));
+  }
+
+  ImageDiskCache::Metadata loaded;
+  char* pixels = cache.load(source_, loaded);
+  EXPECT_TRUE(pixels);
+  free(pixels);
+}
+
+TEST_F(ImageDiskCacheTest, EvictsOldestEntries) {
+  fs::path other = root_ / "bg02.g00";
+  writeSource(other, "other");
+
+  // Find out how big one entry is, then make room for only one of them.
+  boost::uintmax_t entry_size = 0;
+  {
+    ImageDiskCache sizing(root_ / "sizing", 1024 * 1024);
+    sizing.store(source_, metadata_, kPixels);
+    fs::directory_iterator it(root_ / "sizing");
+    entry_size = fs::file_size(it->path());
+  }
+
+  ImageDiskCache cache(root_ / "cache", entry_size * 3 / 2);
+  cache.store(source_, metadata_, kPixels);
+
+  // Modification times only have a resolution of a second, so age the first
+  // entry by hand.
+  fs::directory_iterator it(root_ / "cache");
+  fs::last_write_time(it->path(), std::time(NULL) - 60);
+
+  cache.store(other, metadata_, kPixels);
+
+  ImageDiskCache::Metadata loaded;
+  EXPECT_EQ(NULL, cache.load(source_, loaded));
+  char* pixels = cache.load(other, loaded);
+  EXPECT_TRUE(pixels);
+  free(pixels);
+}
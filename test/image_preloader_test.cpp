@@ -0,0 +1,101 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "Systems/Base/ImagePreloader.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+class FakeImage : public DecodedImage {
+ public:
+  explicit FakeImage(const std::string& name) : name(name) {}
+  std::string name;
+};
+
+boost::mutex decoded_count_mutex;
+int decoded_count = 0;
+
+DecodedImage* decodeFake(const fs::path& path) {
+  boost::mutex::scoped_lock lock(decoded_count_mutex);
+  decoded_count++;
+  if (path.string() == "broken.g00")
+    throw std::runtime_error("Corrupt file");
+  return new FakeImage(path.string());
+}
+
+// Blocks until the worker has been through |count| images in total.
+void waitForDecodes(int count) {
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(decoded_count_mutex);
+      if (decoded_count >= count)
+        return;
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+}
+
+}  // namespace
+
+TEST(ImagePreloaderTest, ReturnsQueuedImages) {
+  ImagePreloader preloader(&decodeFake);
+  int start = decoded_count;
+  preloader.enqueue("BG01", fs::path("bg01.g00"));
+  preloader.enqueue("BG02", fs::path("bg02.g00"));
+  waitForDecodes(start + 2);
+
+  std::auto_ptr<DecodedImage> image = preloader.take("BG02");
+  ASSERT_TRUE(image.get());
+  EXPECT_EQ("bg02.g00", static_cast<FakeImage*>(image.get())->name);
+
+  image = preloader.take("BG01");
+  ASSERT_TRUE(image.get());
+  EXPECT_EQ("bg01.g00", static_cast<FakeImage*>(image.get())->name);
+
+  // Each decoded image is handed out once.
+  EXPECT_FALSE(preloader.take("BG01").get());
+}
+
+TEST(ImagePreloaderTest, UnknownAndBrokenImagesReturnNull) {
+  ImagePreloader preloader(&decodeFake);
+  int start = decoded_count;
+  preloader.enqueue("BROKEN", fs::path("broken.g00"));
+  waitForDecodes(start + 1);
+
+  EXPECT_FALSE(preloader.take("NEVERQUEUED").get());
+  EXPECT_FALSE(preloader.take("BROKEN").get());
+}
@@ -588,6 +588,27 @@ TEST(LargeJmpTest, jumpTest) {
 
 // -----------------------------------------------------------------------
 
+// Same as jumpTest, but with a memory budget so small that seen00001 must be
+// evicted once we've jumped out of it.
+TEST(LargeJmpTest, jumpWithMemoryBudget) {
+  for (int i = 1; i < 4; ++i) {
+    libReallive::Archive arc(locateTestCase("Module_Jmp_SEEN/jumpTest.TXT"));
+    arc.setMemoryBudget(1);
+    TestSystem system;
+    RLMachine rlmachine(system, arc);
+    rlmachine.attachModule(new JmpModule);
+    rlmachine.setIntValue(IntMemRef('B', 0), i);
+    rlmachine.executeUntilHalted();
+
+    EXPECT_EQ(i, rlmachine.getIntValue(IntMemRef('A', 0)))
+        << "We jumped somewhere unexpected on a bad value!";
+    EXPECT_EQ(1u, arc.residentCount())
+        << "Scenario we jumped out of wasn't evicted";
+  }
+}
+
+// -----------------------------------------------------------------------
+
 /**
  *
  * @code
@@ -631,6 +652,31 @@ TEST(LargeJmpTest, farcall) {
 
 // -----------------------------------------------------------------------
 
+// Same as the farcall test, except that seen00002 is parsed by background
+// threads while the machine runs.
+TEST(LargeJmpTest, farcallWithBackgroundParsing) {
+  for (int i = 1; i < 4; ++i) {
+    libReallive::Archive arc(
+        locateTestCase("Module_Jmp_SEEN/farcallTest_0.TXT"));
+    arc.enableBackgroundParsing(2);
+    arc.preparseAll();
+    TestSystem system;
+    RLMachine rlmachine(system, arc);
+    rlmachine.attachModule(new JmpModule);
+    rlmachine.setIntValue(IntMemRef('B', 0), i);
+    rlmachine.executeUntilHalted();
+
+    EXPECT_EQ(1, rlmachine.getIntValue(IntMemRef('A', 0)))
+        << "Precondition not set! (!?!?!?!)";
+    EXPECT_EQ(i, rlmachine.getIntValue(IntMemRef('A', 1)))
+        << "We jumped somewhere unexpected on a bad value!";
+    EXPECT_EQ(1, rlmachine.getIntValue(IntMemRef('A', 2)))
+        << "Postcondition not set! (We didn't return correctly!)";
+  }
+}
+
+// -----------------------------------------------------------------------
+
 /**
  *
  * @code
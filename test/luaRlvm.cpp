@@ -25,15 +25,21 @@
 //
 // -----------------------------------------------------------------------
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 
+#if !defined(RLVM_HEADLESS)
 // We include this here because SDL is retarded and works by #define
 // main(inat argc, char* agrv[]). Loosers.
 #include <SDL/SDL.h>
+#endif
 
 #include "MachineBase/GameHacks.hpp"
 #include "MachineBase/RLMachine.hpp"
@@ -45,18 +51,40 @@
 #include "Systems/Base/GraphicsSystem.hpp"
 #include "Systems/Base/SoundSystem.hpp"
 #include "Systems/Base/SystemError.hpp"
-#include "Systems/SDL/SDLSystem.hpp"
 #include "Utilities/Exception.hpp"
 #include "Utilities/File.hpp"
 #include "Utilities/findFontFile.h"
 #include "libReallive/gameexe.h"
 #include "libReallive/reallive.h"
 
+// luaRlvmHeadless is this file built on the null systems from the test suite:
+// nothing is drawn or played, waits and effects finish immediately, and the
+// instructions and wall time spent in each SEEN are printed on exit.
+#if defined(RLVM_HEADLESS)
+#include "TestSystem/TestSystem.hpp"
+#else
+#include "Systems/SDL/SDLSystem.hpp"
+#endif
+
 using namespace std;
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
+using boost::posix_time::microsec_clock;
+using boost::posix_time::ptime;
+
+// Instructions executed and wall time spent in one SEEN during a headless
+// run.
+struct SeenTiming {
+  SeenTiming() : instructions(0), microseconds(0) {}
+
+  long long instructions;
+  long long microseconds;
+};
+
+typedef std::map<int, SeenTiming> SeenTimings;
+
 // -----------------------------------------------------------------------
 
 void printVersionInformation() {
@@ -96,6 +124,33 @@ void printUsage(const string& name, po::options_description& opts) {
 
 // -----------------------------------------------------------------------
 
+void printSeenTimings(const SeenTimings& timings) {
+  SeenTiming total;
+  cerr << endl << " SEEN  Instructions   Wall ms   Instructions/s" << endl;
+  for (SeenTimings::const_iterator it = timings.begin(); it != timings.end();
+       ++it) {
+    const SeenTiming& timing = it->second;
+    cerr << setw(5) << it->first
+         << setw(14) << timing.instructions
+         << setw(10) << timing.microseconds / 1000
+         << setw(17) << (timing.microseconds ?
+                         timing.instructions * 1000000 / timing.microseconds :
+                         0)
+         << endl;
+
+    total.instructions += timing.instructions;
+    total.microseconds += timing.microseconds;
+  }
+
+  cerr << "Total" << setw(14) << total.instructions
+       << setw(10) << total.microseconds / 1000
+       << setw(17) << (total.microseconds ?
+                       total.instructions * 1000000 / total.microseconds : 0)
+       << endl;
+}
+
+// -----------------------------------------------------------------------
+
 int main(int argc, char* argv[]) {
   srand(time(NULL));
 
@@ -213,17 +268,28 @@ int main(int argc, char* argv[]) {
     // wants us to do.
     ScriptWorld world;
 
-    SDLSystem sdlSystem(gameexe);
+#if defined(RLVM_HEADLESS)
+    const bool headless = true;
+    boost::scoped_ptr<System> system(new TestSystem(gameexePath.string()));
+    system->gameexe()("__GAMEPATH") = gamerootPath.string();
+    if (vm.count("memory"))
+      system->gameexe()("MEMORY") = 1;
+#else
+    const bool headless = false;
+    boost::scoped_ptr<System> system(new SDLSystem(gameexe));
+#endif
+
     libReallive::Archive arc(seenPath.string(), gameexe("REGNAME"));
 
-    ScriptMachine rlmachine(world, sdlSystem, arc);
+    ScriptMachine rlmachine(world, *system, arc);
     addAllModules(rlmachine);
     addGameHacks(rlmachine);
     world.initializeMachine(rlmachine);
     world.loadToplevelFile(scriptLocation.string());
 
-    // Make sure we go as fast as possible:
-    sdlSystem.setForceFastForward();
+    // Make sure we go as fast as possible. This also makes every wait,
+    // effect and textout finish on its first tick.
+    system->setForceFastForward();
 
     if (vm.count("undefined-opcodes"))
       rlmachine.setPrintUndefinedOpcodes(true);
@@ -249,13 +315,36 @@ int main(int argc, char* argv[]) {
       Sys_load()(rlmachine, vm["load-save"].as<int>());
     }
 
+    SeenTimings timings;
+    int current_seen = rlmachine.sceneNumber();
+    ptime seen_start = microsec_clock::universal_time();
+
     while (!rlmachine.halted()) {
       // Give SDL a chance to respond to events, redraw the screen,
       // etc.
-      sdlSystem.run(rlmachine);
+      system->run(rlmachine);
 
       // Run the rlmachine through another instruction
       rlmachine.executeNextInstruction();
+
+      if (headless) {
+        timings[current_seen].instructions++;
+
+        // Only look at the clock when we change SEENs.
+        if (!rlmachine.halted() && rlmachine.sceneNumber() != current_seen) {
+          ptime now = microsec_clock::universal_time();
+          timings[current_seen].microseconds +=
+              (now - seen_start).total_microseconds();
+          seen_start = now;
+          current_seen = rlmachine.sceneNumber();
+        }
+      }
+    }
+
+    if (headless) {
+      timings[current_seen].microseconds +=
+          (microsec_clock::universal_time() - seen_start).total_microseconds();
+      printSeenTimings(timings);
     }
 
     Serialization::saveGlobalMemory(rlmachine);
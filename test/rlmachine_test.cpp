@@ -29,16 +29,23 @@
 
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <iostream>
+#include <sstream>
 #include <utility>
 #include <string>
 #include <vector>
 
+#include "MachineBase/LongOperation.hpp"
 #include "MachineBase/Memory.hpp"
+#include "MachineBase/OpcodeLog.hpp"
 #include "MachineBase/RLMachine.hpp"
+#include "MachineBase/RLModule.hpp"
+#include "MachineBase/RLOperation.hpp"
 #include "MachineBase/Serialization.hpp"
 #include "Modules/Module_Str.hpp"
 #include "Utilities/Exception.hpp"
+#include "libReallive/bytecode.h"
 #include "libReallive/intmemref.h"
 #include "testUtils.hpp"
 
@@ -91,12 +98,113 @@ class RLMachineTest : public FullSystemTest {
   }
 };
 
+// An operation that counts how many times it was dispatched.
+struct CountingOperation : public RLOp_Void_Void {
+  int& count_;
+  explicit CountingOperation(int& count) : count_(count) {}
+
+  virtual bool advanceInstructionPointer() { return false; }
+  virtual void operator()(RLMachine& machine) { count_++; }
+};
+
+class CountingModule : public RLModule {
+ public:
+  explicit CountingModule(int& count) : RLModule("Counting", 0, 200) {
+    addOpcode(0, 0, "count", new CountingOperation(count));
+  }
+};
+
 TEST_F(RLMachineTest, RejectsDoubleAttachs) {
   rlmachine.attachModule(new StrModule);
   EXPECT_THROW({rlmachine.attachModule(new StrModule); },
                rlvm::Exception);
 }
 
+// Tests that the operation a CommandElement resolves to is cached per machine,
+// and isn't reused by a different machine executing the same element.
+TEST_F(RLMachineTest, CachesResolvedOperation) {
+  string repr;
+  repr.resize(8, 0);
+  repr[0] = '#';
+  repr[2] = 200;
+  repr += "()";
+  boost::scoped_ptr<CommandElement> element(
+      BuildFunctionElement(repr.c_str()));
+
+  int first_count = 0;
+  rlmachine.attachModule(new CountingModule(first_count));
+  rlmachine.executeCommand(*element);
+  rlmachine.executeCommand(*element);
+  EXPECT_EQ(2, first_count);
+
+  int second_count = 0;
+  RLMachine other_machine(system, arc);
+  other_machine.attachModule(new CountingModule(second_count));
+  other_machine.executeCommand(*element);
+  EXPECT_EQ(2, first_count);
+  EXPECT_EQ(1, second_count);
+}
+
+// A LongOperation that counts its ticks and finishes after |ticks_to_run|.
+class CountingLongOperation : public LongOperation {
+ public:
+  CountingLongOperation(int& count, int ticks_to_run)
+      : count_(count), ticks_to_run_(ticks_to_run) {}
+
+  virtual bool operator()(RLMachine& machine) {
+    return ++count_ >= ticks_to_run_;
+  }
+
+ private:
+  int& count_;
+  int ticks_to_run_;
+};
+
+// A time slice hands control back as soon as a LongOperation needs the rest of
+// the system to run between its ticks.
+TEST_F(RLMachineTest, InstructionSliceStopsAtLongOperation) {
+  int bottom_count = 0;
+  int top_count = 0;
+  rlmachine.pushLongOperation(new CountingLongOperation(bottom_count, 100));
+  rlmachine.pushLongOperation(new CountingLongOperation(top_count, 1));
+
+  // The top operation finishes, which leaves another LongOperation on top.
+  rlmachine.executeInstructionSlice(1000);
+  EXPECT_EQ(1, top_count);
+  EXPECT_EQ(0, bottom_count);
+
+  rlmachine.executeInstructionSlice(1000);
+  EXPECT_EQ(1, bottom_count);
+}
+
+// A refresh in manual mode sets forceWait(), which ends the slice so the next
+// tick can sleep.
+TEST_F(RLMachineTest, InstructionSliceStopsForForceWait) {
+  libReallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  RLMachine machine(system, arc);
+  system.setForceWait(true);
+
+  machine.executeInstructionSlice(1000);
+  EXPECT_FALSE(machine.halted()) << "Stopped after the first instruction";
+  EXPECT_TRUE(system.forceWait()) << "Left for the tick to act on";
+}
+
+// Ticks don't sleep while fast forwarding, so forceWait() mustn't cut the
+// slice down to a single instruction.
+TEST_F(RLMachineTest, InstructionSliceIgnoresForceWaitWhenFastForwarding) {
+  libReallive::Archive arc(
+      locateTestCase("ExpressionTest_SEEN/basicOperators.TXT"));
+  RLMachine machine(system, arc);
+  system.setForceFastForward();
+  system.setForceWait(true);
+
+  machine.executeInstructionSlice(1000);
+  EXPECT_TRUE(machine.halted()) << "The whole scenario ran in one slice";
+  EXPECT_EQ(3, machine.getIntValue(IntMemRef('A', 1)));
+  EXPECT_FALSE(system.forceWait());
+}
+
 TEST_F(RLMachineTest, ReturnFromFarcallMismatch) {
   EXPECT_THROW({rlmachine.returnFromFarcall(); },
                rlvm::Exception);
@@ -286,3 +394,20 @@ TEST_F(RLMachineTest, SerializationOfSavepointValues) {
     verifyStrMemoryCountingFrom(loadMachine, STRS_LOCATION, 0);
   }
 }
+
+// Profiled calls accumulate total and worst case time per name, and the
+// collapsed stack output is one "frames total" line per name.
+TEST(OpcodeLogTest, RecordsCallTimes) {
+  OpcodeLog log;
+  log.recordCall("SEEN0001;foo", 30, 1);
+  log.recordCall("SEEN0001;foo", 50, 2);
+  log.recordCall("SEEN0001;bar", 5, 0);
+
+  EXPECT_EQ(80, log.totalTime("SEEN0001;foo"));
+  EXPECT_EQ(50, log.maxTime("SEEN0001;foo"));
+  EXPECT_EQ(3, log.allocations("SEEN0001;foo"));
+
+  ostringstream oss;
+  log.writeCollapsedStacks(oss);
+  EXPECT_EQ("SEEN0001;bar 5\nSEEN0001;foo 80\n", oss.str());
+}
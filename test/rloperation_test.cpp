@@ -27,6 +27,7 @@
 #include "gtest/gtest.h"
 
 #include "MachineBase/RLMachine.hpp"
+#include "MachineBase/RLModule.hpp"
 #include "MachineBase/RLOperation.hpp"
 #include "MachineBase/RLOperation/Argc_T.hpp"
 #include "MachineBase/RLOperation/Complex_T.hpp"
@@ -34,6 +35,7 @@
 #include "MachineBase/RLOperation/References.hpp"
 #include "TestSystem/TestSystem.hpp"
 #include "libReallive/archive.h"
+#include "libReallive/bytecode.h"
 #include "libReallive/expression.h"
 #include "libReallive/intmemref.h"
 
@@ -45,6 +47,7 @@
 #include <vector>
 #include <boost/assign/list_of.hpp>
 #include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 
 using boost::assign::list_of;
 
@@ -54,6 +57,16 @@ using namespace libReallive;
 
 // -----------------------------------------------------------------------
 
+// Points a span at each string in |input|.
+ParameterSpans spansOf(const vector<string>& input) {
+  ParameterSpans spans;
+  for (vector<string>::const_iterator it = input.begin(); it != input.end();
+       ++it) {
+    spans.push_back(DataSpan(it->data(), it->size()));
+  }
+  return spans;
+}
+
 template<class T>
 void runDataTest(T& t, RLMachine& machine, const vector<string>& input) {
   ExpressionPiecesVector expression_pieces;
@@ -61,7 +74,7 @@ void runDataTest(T& t, RLMachine& machine, const vector<string>& input) {
   transform(input.begin(), input.end(), back_inserter(binary_strings),
             bind(&printableToParsableString, _1));
 
-  t.parseParameters(binary_strings, expression_pieces);
+  t.parseParameters(spansOf(binary_strings), expression_pieces);
   t.dispatch(machine, expression_pieces);
 }
 
@@ -147,8 +160,8 @@ struct StringcStringcCapturer
       : one_(one), two_(two) {
   }
 
-  virtual void operator()(RLMachine& machine, std::string in_one,
-                          std::string in_two) {
+  virtual void operator()(RLMachine& machine, const std::string& in_one,
+                          const std::string& in_two) {
     one_ = in_one;
     two_ = in_two;
   }
@@ -163,7 +176,7 @@ TEST_F(RLOperationTest, TestStringConstant_T) {
       list_of("\"string one\"")
       ("\"string two\"");
   ExpressionPiecesVector expression_pieces;
-  capturer.parseParameters(unparsed, expression_pieces);
+  capturer.parseParameters(spansOf(unparsed), expression_pieces);
   capturer.dispatch(rlmachine, expression_pieces);
 
   EXPECT_EQ("string one", one);
@@ -172,6 +185,32 @@ TEST_F(RLOperationTest, TestStringConstant_T) {
 
 // -----------------------------------------------------------------------
 
+// Captures the address of the string an operation was handed.
+struct StringcAddressCapturer : public RLOp_Void_1<StrConstant_T> {
+  const std::string*& out_;
+  explicit StringcAddressCapturer(const std::string*& out) : out_(out) {}
+
+  virtual void operator()(RLMachine& machine, const std::string& in) {
+    out_ = &in;
+  }
+};
+
+// Tests that a StrConstant_T read from string memory is passed by reference
+// instead of being copied.
+TEST_F(RLOperationTest, TestStringConstant_TIsNotCopied) {
+  rlmachine.setStringValue(STRS_LOCATION, 5, "string two");
+
+  const std::string* address = NULL;
+  StringcAddressCapturer capturer(address);
+
+  vector<string> unparsed = list_of("$ 12 [ $ FF 05 00 00 00 ]");
+  runDataTest(capturer, rlmachine, unparsed);
+
+  EXPECT_EQ(&rlmachine.getStringValue(STRS_LOCATION, 5), address);
+}
+
+// -----------------------------------------------------------------------
+
 // Tests that we can parse an StrReference_T.
 struct StrRefStrRefCapturer
     : public RLOp_Void_2<StrReference_T, StrReference_T> {
@@ -301,3 +340,90 @@ TEST_F(RLOperationTest, TestComplex2_T) {
   EXPECT_EQ(3, three);
   EXPECT_EQ(4, four);
 }
+
+// -----------------------------------------------------------------------
+
+// Captures the address of the string in a complex parameter.
+struct ComplexStringAddressCapturer
+    : public RLOp_Void_1<Complex2_T<StrConstant_T, IntConstant_T> > {
+  const std::string*& out_;
+  explicit ComplexStringAddressCapturer(const std::string*& out)
+      : out_(out) {}
+
+  virtual void operator()(
+      RLMachine& machine,
+      Complex2_T<StrConstant_T, IntConstant_T>::type in) {
+    out_ = &in.get<0>().str();
+  }
+};
+
+// Tests that a complex parameter refers to string memory instead of holding
+// a copy of the string.
+TEST_F(RLOperationTest, TestComplex2_TStringIsNotCopied) {
+  rlmachine.setStringValue(STRS_LOCATION, 5, "string two");
+
+  const std::string* address = NULL;
+  ComplexStringAddressCapturer capturer(address);
+
+  vector<string> unparsed =
+      list_of("( $ 12 [ $ FF 05 00 00 00 ] $ FF 02 00 00 00 )");
+  runDataTest(capturer, rlmachine, unparsed);
+
+  EXPECT_EQ(&rlmachine.getStringValue(STRS_LOCATION, 5), address);
+}
+
+// -----------------------------------------------------------------------
+
+struct IntcStringcCapturer
+    : public RLOp_Void_2<IntConstant_T, StrConstant_T> {
+  int& one_;
+  std::string& two_;
+
+  IntcStringcCapturer(int& one, std::string& two) : one_(one), two_(two) {}
+
+  virtual bool advanceInstructionPointer() { return false; }
+  virtual void operator()(RLMachine& machine, int in_one,
+                          const std::string& in_two) {
+    one_ = in_one;
+    two_ = in_two;
+  }
+};
+
+class CaptureModule : public RLModule {
+ public:
+  CaptureModule(int& one, std::string& two) : RLModule("Capture", 0, 200) {
+    addOpcode(0, 0, "capture", new IntcStringcCapturer(one, two));
+  }
+};
+
+// Tests that a command's parameters are parsed straight out of the bytes the
+// element was built from.
+TEST_F(RLOperationTest, ParsesParametersFromElementBytes) {
+  string repr;
+  repr.resize(8, 0);
+  repr[0] = '#';
+  repr[2] = 200;
+  repr[5] = 2;
+  repr += "(";
+  repr += printableToParsableString("$ FF 07 00 00 00");
+  repr += "\"string\"";
+  repr += ")";
+  boost::scoped_ptr<CommandElement> element(
+      BuildFunctionElement(repr.c_str()));
+
+  ParameterSpans spans;
+  element->getParameterSpans(spans);
+  ASSERT_EQ(2u, spans.size());
+  EXPECT_EQ(repr.c_str() + 9, spans[0].data());
+  EXPECT_EQ(6u, spans[0].size());
+  EXPECT_EQ(repr.c_str() + 15, spans[1].data());
+  EXPECT_EQ(element->get_param(1), spans[1].str());
+
+  int one = -1;
+  std::string two = "empty";
+  rlmachine.attachModule(new CaptureModule(one, two));
+  rlmachine.executeCommand(*element);
+
+  EXPECT_EQ(7, one);
+  EXPECT_EQ("string", two);
+}
@@ -0,0 +1,240 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2011 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/cstdint.hpp>
+#include <vector>
+
+#include "Systems/Base/SoftwareCompositor.hpp"
+
+using boost::uint32_t;
+
+namespace {
+
+// An image in the compositor's own 0xAARRGGBB layout.
+class TestImage {
+ public:
+  TestImage(int width, int height, uint32_t fill)
+      : width_(width), height_(height), pixels_(width * height, fill),
+        generation_(1) {
+  }
+
+  void set(int x, int y, uint32_t pixel) {
+    pixels_[y * width_ + x] = pixel;
+    ++generation_;
+  }
+
+  CompositorSource source() const {
+    CompositorSource source;
+    source.pixels = &pixels_[0];
+    source.pitch = width_;
+    source.size = Size(width_, height_);
+    source.generation = generation_;
+    return source;
+  }
+
+  Rect rect() const { return Rect::REC(0, 0, width_, height_); }
+
+ private:
+  int width_, height_;
+  std::vector<uint32_t> pixels_;
+  boost::uint64_t generation_;
+};
+
+uint32_t pixelAt(const SoftwareCompositor& compositor, int x, int y) {
+  return compositor.pixels()[y * compositor.size().width() + x];
+}
+
+void drawPlain(SoftwareCompositor& compositor, const TestImage& image,
+               const Rect& dst, int alpha, int composite_mode) {
+  compositor.drawObject(image.source(), image.rect(), dst, alpha,
+                        composite_mode, 0, Point(), CompositorEffects());
+}
+
+}  // namespace
+
+TEST(SoftwareCompositorTest, CopiesOpaqueObjects) {
+  SoftwareCompositor compositor(Size(8, 8), 1);
+  TestImage image(2, 2, 0xFF102030);
+  image.set(1, 1, 0xFFFFFFFF);
+
+  compositor.beginFrame(Point(0, 0));
+  drawPlain(compositor, image, Rect::REC(3, 4, 2, 2), 255, 0);
+  compositor.endFrame();
+
+  EXPECT_EQ(0xFF000000u, pixelAt(compositor, 2, 4));
+  EXPECT_EQ(0xFF102030u, pixelAt(compositor, 3, 4));
+  EXPECT_EQ(0xFF102030u, pixelAt(compositor, 4, 4));
+  EXPECT_EQ(0xFFFFFFFFu, pixelAt(compositor, 4, 5));
+  EXPECT_EQ(0xFF000000u, pixelAt(compositor, 5, 5));
+}
+
+TEST(SoftwareCompositorTest, BlendsByCompositeMode) {
+  SoftwareCompositor compositor(Size(4, 1), 1);
+  TestImage background(4, 1, 0xFF808080);
+  TestImage red(1, 1, 0xFFFF0000);
+  TestImage translucent(1, 1, 0x80FF0000);
+
+  compositor.beginFrame(Point(0, 0));
+  drawPlain(compositor, background, background.rect(), 255, 0);
+  drawPlain(compositor, red, Rect::REC(0, 0, 1, 1), 128, 0);
+  drawPlain(compositor, translucent, Rect::REC(1, 0, 1, 1), 255, 0);
+  drawPlain(compositor, red, Rect::REC(2, 0, 1, 1), 255, 1);
+  compositor.endFrame();
+
+  EXPECT_EQ(0xFFC04040u, pixelAt(compositor, 0, 0));
+  EXPECT_EQ(0xFFC04040u, pixelAt(compositor, 1, 0));
+  EXPECT_EQ(0xFFFF8080u, pixelAt(compositor, 2, 0));
+  EXPECT_EQ(0xFF808080u, pixelAt(compositor, 3, 0));
+}
+
+TEST(SoftwareCompositorTest, AppliesObjectEffects) {
+  SoftwareCompositor compositor(Size(3, 1), 1);
+  TestImage image(1, 1, 0xFFFF0000);
+
+  CompositorEffects mono;
+  mono.mono = 255;
+  CompositorEffects invert;
+  invert.invert = 255;
+  CompositorEffects colour;
+  colour.colour = RGBAColour(0, 0, 255, 255);
+
+  compositor.beginFrame(Point(0, 0));
+  compositor.drawObject(image.source(), image.rect(), Rect::REC(0, 0, 1, 1),
+                        255, 0, 0, Point(), mono);
+  compositor.drawObject(image.source(), image.rect(), Rect::REC(1, 0, 1, 1),
+                        255, 0, 0, Point(), invert);
+  compositor.drawObject(image.source(), image.rect(), Rect::REC(2, 0, 1, 1),
+                        255, 0, 0, Point(), colour);
+  compositor.endFrame();
+
+  EXPECT_EQ(0xFF4C4C4Cu, pixelAt(compositor, 0, 0));
+  EXPECT_EQ(0xFF00FFFFu, pixelAt(compositor, 1, 0));
+  EXPECT_EQ(0xFF0000FFu, pixelAt(compositor, 2, 0));
+}
+
+TEST(SoftwareCompositorTest, ScalesAndRotates) {
+  SoftwareCompositor compositor(Size(4, 4), 1);
+  TestImage image(2, 1, 0xFF0000FF);
+  image.set(1, 0, 0xFF00FF00);
+
+  // Doubled in size, then turned upside down around its centre.
+  compositor.beginFrame(Point(0, 0));
+  compositor.drawObject(image.source(), image.rect(), Rect::REC(0, 0, 4, 2),
+                        255, 0, 1800, Point(), CompositorEffects());
+  compositor.endFrame();
+
+  EXPECT_EQ(0xFF00FF00u, pixelAt(compositor, 0, 0));
+  EXPECT_EQ(0xFF00FF00u, pixelAt(compositor, 1, 1));
+  EXPECT_EQ(0xFF0000FFu, pixelAt(compositor, 2, 0));
+  EXPECT_EQ(0xFF0000FFu, pixelAt(compositor, 3, 1));
+  EXPECT_EQ(0xFF000000u, pixelAt(compositor, 0, 2));
+}
+
+TEST(SoftwareCompositorTest, SkipsUnchangedTiles) {
+  const int tile = SoftwareCompositor::kTileSize;
+  SoftwareCompositor compositor(Size(tile * 2, tile), 1);
+  TestImage left(tile, tile, 0xFF112233);
+  TestImage right(tile, tile, 0xFF445566);
+
+  std::vector<Rect> changed;
+  for (int frame = 0; frame < 3; ++frame) {
+    if (frame == 2)
+      right.set(0, 0, 0xFFFFFFFF);
+
+    compositor.beginFrame(Point(0, 0));
+    drawPlain(compositor, left, Rect::REC(0, 0, tile, tile), 255, 0);
+    drawPlain(compositor, right, Rect::REC(tile, 0, tile, tile), 255, 0);
+    compositor.endFrame();
+
+    changed.clear();
+    compositor.takeChangedTiles(changed);
+    if (frame == 0) {
+      EXPECT_EQ(2, compositor.tilesDrawnLastFrame());
+      EXPECT_EQ(2u, changed.size());
+    } else if (frame == 1) {
+      EXPECT_EQ(0, compositor.tilesDrawnLastFrame());
+      EXPECT_TRUE(changed.empty());
+    } else {
+      EXPECT_EQ(1, compositor.tilesDrawnLastFrame());
+      ASSERT_EQ(1u, changed.size());
+      EXPECT_EQ(Rect::REC(tile, 0, tile, tile), changed[0]);
+    }
+  }
+
+  EXPECT_EQ(0xFF112233u, pixelAt(compositor, 0, 0));
+  EXPECT_EQ(0xFFFFFFFFu, pixelAt(compositor, tile, 0));
+  EXPECT_EQ(0xFF445566u, pixelAt(compositor, tile + 1, 0));
+}
+
+TEST(SoftwareCompositorTest, FlushesBeforeSourcesChange) {
+  SoftwareCompositor compositor(Size(2, 1), 1);
+  TestImage image(1, 1, 0xFF00FF00);
+
+  compositor.beginFrame(Point(0, 0));
+  drawPlain(compositor, image, Rect::REC(0, 0, 1, 1), 255, 0);
+  compositor.sourceChanging(image.source().pixels);
+  image.set(0, 0, 0xFFFF0000);
+  drawPlain(compositor, image, Rect::REC(1, 0, 1, 1), 255, 0);
+  compositor.endFrame();
+
+  EXPECT_EQ(0xFF00FF00u, pixelAt(compositor, 0, 0));
+  EXPECT_EQ(0xFFFF0000u, pixelAt(compositor, 1, 0));
+}
+
+TEST(SoftwareCompositorTest, ThreadsDrawTheSameFrame) {
+  const int tile = SoftwareCompositor::kTileSize;
+  Size screen(tile * 5 + 7, tile * 3 + 3);
+  SoftwareCompositor single(screen, 1);
+  SoftwareCompositor threaded(screen, 4);
+
+  TestImage image(37, 23, 0x80336699);
+  for (int i = 0; i < 23; ++i)
+    image.set(i, i, 0xFFFFFFFF - i);
+
+  SoftwareCompositor* compositors[] = { &single, &threaded };
+  for (int c = 0; c < 2; ++c) {
+    compositors[c]->beginFrame(Point(3, -2));
+    for (int i = 0; i < 20; ++i) {
+      compositors[c]->drawObject(
+          image.source(), image.rect(),
+          Rect::REC(i * 17, i * 9, 37 + i * 5, 23 + i * 3),
+          255 - i * 7, i % 2, i * 150, Point(i, -i), CompositorEffects());
+    }
+    compositors[c]->endFrame();
+  }
+
+  int mismatches = 0;
+  for (int y = 0; y < screen.height(); ++y) {
+    for (int x = 0; x < screen.width(); ++x) {
+      if (pixelAt(single, x, y) != pixelAt(threaded, x, y))
+        ++mismatches;
+    }
+  }
+  EXPECT_EQ(0, mismatches);
+}
@@ -28,11 +28,15 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
+#include "MachineBase/Memory.hpp"
 #include "MachineBase/RLMachine.hpp"
 #include "LongOperations/TextoutLongOperation.hpp"
 #include "TestSystem/TestSystem.hpp"
 #include "TestSystem/MockTextWindow.hpp"
+#include "Systems/Base/GraphicsSystem.hpp"
+#include "Systems/Base/Surface.hpp"
 #include "Systems/Base/TextPage.hpp"
+#include "Systems/Base/TextSystem.hpp"
 #include "libReallive/archive.h"
 
 #include "testUtils.hpp"
@@ -113,6 +117,98 @@ TEST_F(TextSystemTest, PrintEmptyString) {
   EXPECT_EQ("", getTextWindow(0).currentContents());
 }
 
+// Measuring a line gives one width per codepoint, not per byte.
+TEST_F(TextSystemTest, CharWidthsMeasuresEachCodepoint) {
+  vector<int> widths;
+  // "A" followed by two hiragana.
+  int total = system.text().charWidths(
+      20, "A\xe3\x81\x82\xe3\x81\x84", widths);
+  ASSERT_EQ(3u, widths.size());
+  EXPECT_EQ(20, widths[0]);
+  EXPECT_EQ(60, total);
+}
+
+// Names are spliced into the cached conversion, so changing a name changes
+// the next rendering of the same text.
+TEST_F(TextSystemTest, ParsedTextoutFillsInNames) {
+  // The placeholder for name A, a space and a hiragana "a", in CP932.
+  ParsedTextout parsed("\x81\x96\x82\x60 \x82\xa0", 0);
+
+  rlmachine.memory().setName(0, "Bob");
+  EXPECT_EQ("Bob \xe3\x81\x82", parsed.render(rlmachine.memory()));
+
+  rlmachine.memory().setName(0, "Ann");
+  EXPECT_EQ("Ann \xe3\x81\x82", parsed.render(rlmachine.memory()));
+}
+
+// Skipping read text stops drawing until we reach a selection or unread text.
+TEST_F(TextSystemTest, SkippingReadTextSuppressesRendering) {
+  TextSystem& text = system.text();
+  EXPECT_FALSE(text.renderingSuppressed());
+
+  text.setKidokuRead(1);
+  text.setSkipMode(1);
+  EXPECT_TRUE(text.renderingSuppressed());
+
+  text.setInSelectionMode(true);
+  EXPECT_FALSE(text.renderingSuppressed());
+  text.setInSelectionMode(false);
+  EXPECT_TRUE(text.renderingSuppressed());
+
+  text.setKidokuRead(0);
+  EXPECT_FALSE(text.skipMode());
+  EXPECT_FALSE(text.renderingSuppressed());
+}
+
+// Text written while skipping is laid out but not drawn; once we reach
+// unread text, the window is cleared and the page replayed onto it.
+TEST_F(TextSystemTest, DeferredTextIsReplayedWhenSkippingStops) {
+  TextSystem& text = system.text();
+  text.setKidokuRead(1);
+  text.setSkipMode(1);
+
+  writeString("Skipped.", true);
+  EXPECT_EQ(0, getTextSystem().glyphsRendered());
+  EXPECT_EQ("Skipped.", getTextWindow(0).currentContents());
+
+  // Selections stop skipping too, but don't replay twice.
+  text.setInSelectionMode(true);
+  EXPECT_EQ(8, getTextSystem().glyphsRendered());
+  EXPECT_EQ("Skipped.", getTextWindow(0).currentContents());
+  text.setInSelectionMode(false);
+  text.setKidokuRead(0);
+  EXPECT_EQ(8, getTextSystem().glyphsRendered());
+}
+
+TEST_F(TextSystemTest, UnsuppressedTextIsNotReplayed) {
+  writeString("Drawn.", true);
+  EXPECT_EQ(6, getTextSystem().glyphsRendered());
+
+  system.text().setKidokuRead(1);
+  system.text().setSkipMode(1);
+  system.text().setKidokuRead(0);
+  EXPECT_EQ(6, getTextSystem().glyphsRendered());
+  EXPECT_EQ("Drawn.", getTextWindow(0).currentContents());
+}
+
+// While skipping, nothing is composited; callers that want a copy of the
+// screen get a reused black frame instead.
+TEST_F(TextSystemTest, RenderToSurfaceReturnsSkippedFrame) {
+  GraphicsSystem& graphics = system.graphics();
+  EXPECT_FALSE(graphics.renderToSurface())
+      << "The test system's endFrameToSurface() is used when not skipping";
+
+  system.text().setKidokuRead(1);
+  system.text().setSkipMode(1);
+  boost::shared_ptr<Surface> frame = graphics.renderToSurface();
+  ASSERT_TRUE(frame);
+  EXPECT_EQ(graphics.screenSize(), frame->size());
+  EXPECT_EQ(frame, graphics.renderToSurface()) << "The frame is reused";
+
+  system.text().setKidokuRead(0);
+  EXPECT_FALSE(graphics.renderToSurface());
+}
+
 TEST_F(TextSystemTest, BackLogFunctionality) {
   TextSystem& text = rlmachine.system().text();
 
@@ -262,3 +262,43 @@ TEST_F(TextWindowTest, MultipleKinsokuCharacters) {
             "\xe3\x81\x82\xe3\x81\x82\xe3\x81\x82\xe3\x81\x82\xe3\x81\x82\x0a"
             "\xe3\x81\x82\xe3\x80\x82\xe3\x80\x8d");
 }
+
+// Laying out a whole run with characters() must break lines, place names and
+// apply the kinsoku rules exactly as feeding the same text to character() one
+// character at a time does.
+TEST_F(TextWindowTest, RunLayoutMatchesPerCharacterLayout) {
+  kanonLikeTextbox();
+
+  std::vector<std::string> texts;
+  for (int count = 18; count <= 21; ++count) {
+    std::string str = kOpenQuote;
+    for (int i = 0; i < count; ++i)
+      str += kHiraganaA;
+    texts.push_back(str + kCloseQuote);
+    texts.push_back(str + kPeriod + kCloseQuote);
+  }
+
+  // Wraps twice, with kinsoku characters at both line ends.
+  std::string long_text = kOpenQuote;
+  for (int i = 0; i < 40; ++i)
+    long_text += kHiraganaA;
+  texts.push_back(long_text + kPeriod + kPeriod + kCloseQuote);
+
+  for (std::vector<std::string>::const_iterator it = texts.begin();
+       it != texts.end(); ++it) {
+    const std::string& str = *it;
+
+    TestTextWindow by_character(system, 0);
+    by_character.setName(kGirl, kOpenQuote);
+    printTextToFunction(
+        bind(&TextWindow::character, ref(by_character), _1, _2), str, "");
+
+    TestTextWindow by_run(system, 0);
+    by_run.setName(kGirl, kOpenQuote);
+    EXPECT_EQ(str.size(), by_run.characters(str, 0, str.size()));
+
+    EXPECT_EQ(by_character.currentContents(), by_run.currentContents());
+    EXPECT_EQ(by_character.insertionPointX(), by_run.insertionPointX());
+    EXPECT_EQ(by_character.insertionPointY(), by_run.insertionPointY());
+  }
+}
@@ -27,7 +27,9 @@
 #include "gtest/gtest.h"
 
 #include "Systems/Base/Rect.hpp"
+#include "Utilities/AllocationCounter.hpp"
 #include "Utilities/Graphics.hpp"
+#include "Utilities/SizedLRUCache.hpp"
 #include "libReallive/gameexe.h"
 
 TEST(UtilitiesTest, ClipDestination_Superset) {
@@ -64,3 +66,48 @@ TEST(UtilitiesTest, ScreenSizeModKey) {
   me.parseLine("#SCREENSIZE_MOD=999,800,600");
   EXPECT_EQ(Size(800, 600), getScreenSize(me));
 }
+
+TEST(UtilitiesTest, AllocationCounter) {
+  long before = allocation_counter::count();
+  delete new int(5);
+  EXPECT_EQ(before, allocation_counter::count());
+
+  allocation_counter::setEnabled(true);
+  delete new int(5);
+  delete[] new char[10];
+  allocation_counter::setEnabled(false);
+
+  // Only a `scons --count-allocations` build replaces operator new.
+  long expected = allocation_counter::available() ? before + 2 : before;
+  EXPECT_EQ(expected, allocation_counter::count());
+}
+
+TEST(UtilitiesTest, SizedLRUCacheEvictsByBytes) {
+  SizedLRUCache<std::string, int> cache(100);
+  cache.insert("a", 1, 40);
+  cache.insert("b", 2, 40);
+  EXPECT_EQ(80u, cache.bytes());
+
+  // Touch "a" so that "b" is the least recently used.
+  EXPECT_EQ(1, cache.fetch("a"));
+  cache.insert("c", 3, 40);
+  EXPECT_TRUE(cache.exists("a"));
+  EXPECT_FALSE(cache.exists("b"));
+  EXPECT_TRUE(cache.exists("c"));
+  EXPECT_EQ(80u, cache.bytes());
+
+  // Reinserting replaces the old size.
+  cache.insert("c", 3, 10);
+  EXPECT_EQ(50u, cache.bytes());
+
+  // An entry bigger than the whole budget pushes everything else out, but
+  // stays itself.
+  cache.insert("huge", 4, 500);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(4, cache.fetch("huge"));
+
+  EXPECT_EQ(0, cache.fetch("b"));
+  EXPECT_EQ(2, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+  EXPECT_EQ(3, cache.evictions());
+}